@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "machine.h"
+#include "loader.h"
+#include "dump.h"
+#include "batch.h"
+
+#define MAXNAMELEN 1024
+
+/* The jobs of a worker.  The worker takes jobs from the bottom and idle
+ * workers steal them from the top, so a thief and the owner only meet on
+ * the last job.
+ */
+typedef struct
+{
+    int * jobs;
+    int top;
+    int bottom;
+    pthread_mutex_t lock;
+} queueType;
+
+//everything the workers of one batch share
+typedef struct
+{
+    jobType * jobs;
+    queueType * queues;
+    int threads;
+    unsigned long long memSize;
+    configType config;
+    char * outDir;
+    const engineType * engine;
+} batchType;
+
+typedef struct
+{
+    batchType * batch;
+    int id;
+} workerType;
+
+//prototypes of functions only called within this file
+static void * worker(void * arg);
+static int nextJob(batchType * batch, int id);
+static int takeBottom(queueType * queue);
+static int takeTop(queueType * queue);
+static void runJob(machineType * machine, jobType * job, char * outDir, const engineType * engine);
+static FILE * openOutput(jobType * job, char * outDir);
+static void writeBatchCounters(batchType * batch, int count);
+static void writeBatchFolded(batchType * batch, int count);
+static double now();
+//end prototypes
+
+/* Function Name: readManifest
+ * Purpose:       Adds the files named in a manifest, one per line, to a list
+ *                of files.  Blank lines are skipped.
+ *
+ * Parameters:    fileName - name of the manifest
+ *                files - list to add to, may be NULL
+ *                count - number of files in the list
+ * Returns:       the list, which is allocated even if the manifest names no
+ *                files, NULL if the manifest couldn't be read
+ * Modifies:      count
+ */
+char ** readManifest(char * fileName, char ** files, int * count)
+{
+    char line[MAXNAMELEN];
+    FILE * f = fopen(fileName, "r");
+    if(f == NULL) return NULL;
+
+    if(files == NULL) files = malloc(sizeof(char *));
+    while(files != NULL && fgets(line, MAXNAMELEN, f) != NULL){
+        line[strcspn(line, "\r\n")] = '\0';
+        if(line[0] == '\0') continue;
+
+        files = realloc(files, (*count + 1) * sizeof(char *));
+        if(files == NULL) break;
+        files[*count] = strdup(line);
+        (*count)++;
+    }
+    fclose(f);
+    return files;
+}
+
+/* Function Name: runBatch
+ * Purpose:       Simulates a list of programs on a pool of threads.  The
+ *                dumps and clock cycles of each program are written to
+ *                <outDir>/<program>.dump or, without an outDir, to stdout
+ *                one program after the other in the order they were listed.
+ *                The time each program took is reported on stderr.
+ *
+ * Parameters:    files - names of the .yo files
+ *                count - number of files
+ *                threads - number of threads to simulate on
+ *                memSize - bytes of memory each program may address
+ *                config - options of the pipeline
+ *                outDir - directory for the output files, may be NULL
+ *                engine - engine the programs are simulated with
+ * Returns:       number of programs that failed to load
+ * Modifies:      -
+ */
+int runBatch(char ** files, int count, int threads, unsigned long long memSize,
+             const configType * config, char * outDir, const engineType * engine)
+{
+    int i, failed = 0;
+    double start = now();
+    batchType batch;
+    pthread_t * ids;
+    workerType * workers;
+
+    if(threads > count) threads = count;
+    if(threads < 1) threads = 1;
+
+    batch.jobs = calloc(count, sizeof(jobType));
+    batch.queues = calloc(threads, sizeof(queueType));
+    batch.threads = threads;
+    batch.memSize = memSize;
+    batch.config = *config;
+    batch.outDir = outDir;
+    batch.engine = engine;
+    ids = calloc(threads, sizeof(pthread_t));
+    workers = calloc(threads, sizeof(workerType));
+    if(batch.jobs == NULL || batch.queues == NULL || ids == NULL || workers == NULL){
+        fprintf(stderr, "Unable to allocate the batch\n");
+        exit(1);
+    }
+
+    //deal the jobs out to the workers
+    for(i = 0; i < threads; i++){
+        batch.queues[i].jobs = malloc((count / threads + 1) * sizeof(int));
+        pthread_mutex_init(&batch.queues[i].lock, NULL);
+    }
+    for(i = 0; i < count; i++){
+        queueType * queue = &batch.queues[i % threads];
+        batch.jobs[i].fileName = files[i];
+        queue->jobs[queue->bottom++] = i;
+    }
+
+    for(i = 0; i < threads; i++){
+        workers[i].batch = &batch;
+        workers[i].id = i;
+        pthread_create(&ids[i], NULL, worker, &workers[i]);
+    }
+    for(i = 0; i < threads; i++) pthread_join(ids[i], NULL);
+
+    //demultiplex the buffered output
+    for(i = 0; i < count; i++){
+        if(batch.jobs[i].buffer == NULL) continue;
+        printf("==> %s <==\n", batch.jobs[i].fileName);
+        fwrite(batch.jobs[i].buffer, 1, batch.jobs[i].bufferSize, stdout);
+        printf("\n");
+        free(batch.jobs[i].buffer);
+    }
+    fflush(stdout);
+    if(config->countersFile != NULL) writeBatchCounters(&batch, count);
+    if(config->foldedFile != NULL) writeBatchFolded(&batch, count);
+
+    for(i = 0; i < count; i++){
+        jobType * job = &batch.jobs[i];
+        if(job->loaded)
+            fprintf(stderr, "%s: %llu %s, %.3f ms\n", job->fileName,
+                    job->count, engine->counted, job->seconds * 1000);
+        else
+            fprintf(stderr, "%s: failed to load, %.3f ms\n", job->fileName,
+                    job->seconds * 1000);
+        if(!job->loaded) failed++;
+    }
+    fprintf(stderr, "%d programs on %d threads in %.3f ms\n", count, threads,
+            (now() - start) * 1000);
+
+    for(i = 0; i < threads; i++){
+        free(batch.queues[i].jobs);
+        pthread_mutex_destroy(&batch.queues[i].lock);
+    }
+    free(batch.jobs);
+    free(batch.queues);
+    free(ids);
+    free(workers);
+    return failed;
+}
+
+/* Function Name: worker
+ * Purpose:       Runs jobs on one machine until there are none left
+ *
+ * Parameters:    arg - the workerType of the thread
+ * Returns:       NULL
+ * Modifies:      the jobs that were run
+ */
+static void * worker(void * arg)
+{
+    workerType * self = arg;
+    batchType * batch = self->batch;
+    int job;
+
+    machineType * machine = newMachine();
+    if(machine == NULL || !setMemorySize(machine, batch->memSize)){
+        fprintf(stderr, "Unable to allocate the machine\n");
+        exit(1);
+    }
+    machine->config = batch->config;
+
+    while((job = nextJob(batch, self->id)) != -1){
+        initializeMachine(machine);
+        runJob(machine, &batch->jobs[job], batch->outDir, batch->engine);
+    }
+    freeMachine(machine);
+    return NULL;
+}
+
+/* Function Name: nextJob
+ * Purpose:       Takes the next job of a worker, stealing one from the
+ *                other workers once its own are done
+ *
+ * Parameters:    batch - the batch being run
+ *                id - the worker
+ * Returns:       index of the job, -1 if all jobs have been taken
+ * Modifies:      the queues of the batch
+ */
+static int nextJob(batchType * batch, int id)
+{
+    int i, job = takeBottom(&batch->queues[id]);
+
+    for(i = 1; job == -1 && i < batch->threads; i++)
+        job = takeTop(&batch->queues[(id + i) % batch->threads]);
+    return job;
+}
+
+/* Function Name: takeBottom
+ * Purpose:       Takes the most recently added job of a queue
+ *
+ * Parameters:    queue - queue to take from
+ * Returns:       index of the job, -1 if the queue is empty
+ * Modifies:      queue
+ */
+static int takeBottom(queueType * queue)
+{
+    int job = -1;
+
+    pthread_mutex_lock(&queue->lock);
+    if(queue->top < queue->bottom) job = queue->jobs[--queue->bottom];
+    pthread_mutex_unlock(&queue->lock);
+    return job;
+}
+
+/* Function Name: takeTop
+ * Purpose:       Takes the oldest job of a queue
+ *
+ * Parameters:    queue - queue to take from
+ * Returns:       index of the job, -1 if the queue is empty
+ * Modifies:      queue
+ */
+static int takeTop(queueType * queue)
+{
+    int job = -1;
+
+    pthread_mutex_lock(&queue->lock);
+    if(queue->top < queue->bottom) job = queue->jobs[queue->top++];
+    pthread_mutex_unlock(&queue->lock);
+    return job;
+}
+
+/* Function Name: runJob
+ * Purpose:       Loads and simulates one program the same way yess does
+ *                for a single program
+ *
+ * Parameters:    machine - cleared machine to simulate on
+ *                job - the program
+ *                outDir - directory for the output file, may be NULL
+ *                engine - engine the program is simulated with
+ * Returns:       -
+ * Modifies:      machine, job
+ */
+static void runJob(machineType * machine, jobType * job, char * outDir, const engineType * engine)
+{
+    double start = now();
+
+    machine->out = openOutput(job, outDir);
+    if(machine->out == NULL){
+        job->loaded = FALSE;
+        job->seconds = now() - start;
+        return;
+    }
+
+    job->loaded = !loadFile(machine, job->fileName);
+    if(job->loaded){
+        job->count = engine->run(machine);
+        fprintf(machine->out, "\nTotal %s = %llu\n", engine->counted, job->count);
+        reportStatistics(machine);
+        if(machine->config.countersFile != NULL){
+            FILE * counters = open_memstream(&job->counters, &job->countersSize);
+            if(counters != NULL){
+                writeCounters(machine, job->fileName, counters);
+                fclose(counters);
+            }
+        }
+        if(machine->config.foldedFile != NULL){
+            FILE * folded = open_memstream(&job->folded, &job->foldedSize);
+            if(folded != NULL){
+                writeFolded(machine, job->fileName, folded);
+                fclose(folded);
+            }
+        }
+    }
+    else dumpMemory(machine);
+
+    fclose(machine->out);
+    machine->out = stdout;
+    job->seconds = now() - start;
+}
+
+/* Function Name: openOutput
+ * Purpose:       Opens the stream the output of a job is written to
+ *
+ * Parameters:    job - the job
+ *                outDir - directory for the output file, NULL to buffer
+ *                         the output in memory
+ * Returns:       the stream, NULL if it couldn't be opened
+ * Modifies:      job
+ */
+static FILE * openOutput(jobType * job, char * outDir)
+{
+    char name[MAXNAMELEN];
+    char * base, * extension;
+    FILE * out;
+
+    if(outDir == NULL) return open_memstream(&job->buffer, &job->bufferSize);
+
+    base = strrchr(job->fileName, '/');
+    base = (base == NULL) ? job->fileName : base + 1;
+    extension = strrchr(base, '.');
+    if(extension == NULL) extension = base + strlen(base);
+    snprintf(name, MAXNAMELEN, "%s/%.*s.dump", outDir, (int) (extension - base), base);
+
+    out = fopen(name, "w");
+    if(out == NULL) fprintf(stderr, "Unable to open %s\n", name);
+    return out;
+}
+
+/* Function Name: writeBatchCounters
+ * Purpose:       Writes the counters of the programs of a batch to the file
+ *                the configuration gives, as a JSON array in the order the
+ *                programs were given
+ *
+ * Parameters:    batch - the batch that was run
+ *                count - number of jobs in the batch
+ * Returns:       -
+ * Modifies:      the jobs, their counters are released
+ */
+static void writeBatchCounters(batchType * batch, int count)
+{
+    bool toStdout = strcmp(batch->config.countersFile, "-") == 0;
+    FILE * out = toStdout ? stdout : fopen(batch->config.countersFile, "w");
+    bool first = TRUE;
+    int i;
+
+    if(out == NULL) fprintf(stderr, "Unable to open %s\n", batch->config.countersFile);
+    else fprintf(out, "[");
+    for(i = 0; i < count; i++){
+        jobType * job = &batch->jobs[i];
+        if(job->counters == NULL) continue;
+        if(out != NULL){
+            fprintf(out, "%s\n", first ? "" : ",");
+            fwrite(job->counters, 1, job->countersSize, out);
+            first = FALSE;
+        }
+        free(job->counters);
+    }
+    if(out == NULL) return;
+    fprintf(out, "\n]\n");
+    if(toStdout) fflush(out);
+    else fclose(out);
+}
+
+/* Function Name: writeBatchFolded
+ * Purpose:       Writes the call paths of the programs of a batch to the file
+ *                the configuration gives, each path starting with its program
+ *
+ * Parameters:    batch - the batch that was run
+ *                count - number of jobs in the batch
+ * Returns:       -
+ * Modifies:      the jobs, their call paths are released
+ */
+static void writeBatchFolded(batchType * batch, int count)
+{
+    bool toStdout = strcmp(batch->config.foldedFile, "-") == 0;
+    FILE * out = toStdout ? stdout : fopen(batch->config.foldedFile, "w");
+    int i;
+
+    if(out == NULL) fprintf(stderr, "Unable to open %s\n", batch->config.foldedFile);
+    for(i = 0; i < count; i++){
+        jobType * job = &batch->jobs[i];
+        if(job->folded == NULL) continue;
+        if(out != NULL) fwrite(job->folded, 1, job->foldedSize, out);
+        free(job->folded);
+    }
+    if(out == NULL) return;
+    if(toStdout) fflush(out);
+    else fclose(out);
+}
+
+/* Function Name: now
+ * Purpose:       Reads a clock for timing the jobs
+ *
+ * Parameters:    -
+ * Returns:       seconds since an arbitrary point
+ * Modifies:      -
+ */
+static double now()
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
@@ -0,0 +1,34 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+//most threads a batch can be simulated on
+#define MAXTHREADS 1024
+
+//a program simulated in batch mode
+typedef struct
+{
+    char * fileName;
+
+    //output of the program when it isn't written to its own file
+    char * buffer;
+    size_t bufferSize;
+
+    //counters of the pipeline as JSON, when the configuration asks for them
+    char * counters;
+    size_t countersSize;
+
+    //call paths as folded stacks, when the configuration asks for them
+    char * folded;
+    size_t foldedSize;
+
+    bool loaded;
+    unsigned long long count; //clock cycles or instructions, depending on the engine
+    double seconds;
+} jobType;
+
+//prototypes
+char ** readManifest(char * fileName, char ** files, int * count);
+int runBatch(char ** files, int count, int threads, unsigned long long memSize,
+             const configType * config, char * outDir, const engineType * engine);
+
+#endif
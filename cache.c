@@ -0,0 +1,516 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "tools.h"
+
+/*
+ * Cache.c - models the timing of the L1 instruction and data caches of the
+ * pipeline.  The caches only keep tags, the program's bytes are always read
+ * from and written to memory, so a cache can only change how many cycles a
+ * program takes and never what it does.  The fetch stage asks fetchDelay
+ * about each instruction it passes to decode and the memory stage asks
+ * dataDelay about each access, both get the extra cycles to wait.
+ *
+ * With DRAM the lines a cache fills and the stores it writes through are
+ * requests to the DRAM instead of taking the miss latency, and the stage
+ * also waits until fetchReady or dataReady.  Writing back a dirty line
+ * doesn't make anyone wait.  Without a cache every access is a request.
+ *
+ * The store buffer writes its stores through the data cache with storeDelay
+ * and storeReady, alongside the loads of the memory stage.
+ *
+ * The prefetcher fills lines with prefetchLine.  A prefetched line is in the
+ * cache at once but its fill takes the miss latency or its DRAM request, and
+ * the first access of the line waits for whatever is left of it.
+ */
+
+//names of the replacement policies on the command line, indexed by REPL...
+static const char * names[REPLPOLICIES] = {"lru", "plru", "random"};
+
+//prototypes of functions only called within this file
+static bool startCache(cacheType * cache, const cacheConfigType * config);
+static int accessCache(machineType * machine, cacheType * cache, const cacheConfigType * config,
+                       unsigned int address, unsigned int bytes, bool write, unsigned int waiting[2]);
+static int accessLine(machineType * machine, cacheType * cache, const cacheConfigType * config,
+                      unsigned int line, bool write, unsigned int * ticket);
+static int evictLine(machineType * machine, cacheType * cache, const cacheConfigType * config,
+                     cacheLineType * victim);
+static int usePrefetch(machineType * machine, cacheLineType * line, unsigned int * ticket);
+static bool cacheReady(machineType * machine, unsigned int waiting[2]);
+static int chooseVictim(cacheType * cache, const cacheConfigType * config, unsigned int set);
+static void touchLine(cacheType * cache, const cacheConfigType * config, unsigned int set, int way);
+static void reportCache(machineType * machine, const char * name, cacheType * cache,
+                        const cacheConfigType * config);
+//end prototypes
+
+/* Function Name: findReplacement
+ * Purpose:       Looks up a replacement policy by name
+ *
+ * Parameters:    name - name of the policy
+ * Returns:       REPL... of the policy, -1 if there isn't one with that name
+ * Modifies:      -
+ */
+int findReplacement(char * name)
+{
+    int i;
+
+    for(i = 0; i < REPLPOLICIES; i++)
+        if(strcmp(names[i], name) == 0) return i;
+    return -1;
+}
+
+/* Function Name: validCache
+ * Purpose:       Checks that the shape of a cache can be simulated
+ *
+ * Parameters:    config - shape of the cache
+ * Returns:       TRUE if the size, ways and line size are powers of two that
+ *                make at least one set and the latency is in range
+ * Modifies:      -
+ */
+bool validCache(const cacheConfigType * config)
+{
+    if(config->size <= 0 || config->ways <= 0 || config->lineSize < 4) return FALSE;
+    if((config->size & (config->size - 1)) != 0 || (config->ways & (config->ways - 1)) != 0 ||
+       (config->lineSize & (config->lineSize - 1)) != 0) return FALSE;
+
+    //the PLRU bits of a set fit in an unsigned int
+    if(config->ways > 32 || config->size < config->ways * config->lineSize) return FALSE;
+    return config->missLatency >= 0 && config->missLatency <= MAXMISSLATENCY;
+}
+
+/* Function Name: clearCaches
+ * Purpose:       Releases the caches of a machine
+ *
+ * Parameters:    machine - machine whose caches are released
+ * Returns:       -
+ * Modifies:      machine->icache, machine->dcache
+ */
+void clearCaches(machineType * machine)
+{
+    free(machine->icache.lines);
+    free(machine->icache.trees);
+    free(machine->dcache.lines);
+    free(machine->dcache.trees);
+    memset(&machine->icache, 0, sizeof(machine->icache));
+    memset(&machine->dcache, 0, sizeof(machine->dcache));
+}
+
+/* Function Name: startCaches
+ * Purpose:       Makes empty caches of the configured shapes for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       TRUE if the caches could be allocated, FALSE otherwise
+ * Modifies:      machine->icache, machine->dcache
+ */
+bool startCaches(machineType * machine)
+{
+    clearCaches(machine);
+    return startCache(&machine->icache, &machine->config.icache) &&
+           startCache(&machine->dcache, &machine->config.dcache);
+}
+
+/* Function Name: fetchDelay
+ * Purpose:       Reads an instruction through the instruction cache
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the instruction
+ *                bytes - length of the instruction
+ * Returns:       extra cycles the fetch takes
+ * Modifies:      machine->icache
+ */
+int fetchDelay(machineType * machine, unsigned int address, unsigned int bytes)
+{
+    if(machine->config.icache.size == 0 && machine->config.dram.banks == 0) return 0;
+    return accessCache(machine, &machine->icache, &machine->config.icache, address, bytes, FALSE,
+                       machine->icache.waiting);
+}
+
+/* Function Name: dataDelay
+ * Purpose:       Reads or writes a word through the data cache
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word
+ *                write - TRUE for a store
+ * Returns:       extra cycles the access takes
+ * Modifies:      machine->dcache
+ */
+int dataDelay(machineType * machine, unsigned int address, bool write)
+{
+    if(machine->config.dcache.size == 0 && machine->config.dram.banks == 0) return 0;
+    return accessCache(machine, &machine->dcache, &machine->config.dcache, address, 4, write,
+                       machine->dcache.waiting);
+}
+
+/* Function Name: storeDelay
+ * Purpose:       Writes a word of the store buffer through the data cache
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word
+ * Returns:       extra cycles the store takes
+ * Modifies:      machine->dcache
+ */
+int storeDelay(machineType * machine, unsigned int address)
+{
+    if(machine->config.dcache.size == 0 && machine->config.dram.banks == 0) return 0;
+    return accessCache(machine, &machine->dcache, &machine->config.dcache, address, 4, TRUE,
+                       machine->dcache.storing);
+}
+
+/* Function Name: prefetchLine
+ * Purpose:       Fills the line of an address in the data cache ahead of the
+ *                loads that the prefetcher expects to read it
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - an address in the line
+ * Returns:       -
+ * Modifies:      machine->dcache, machine->prefetcher
+ */
+void prefetchLine(machineType * machine, unsigned int address)
+{
+    cacheType * cache = &machine->dcache;
+    const cacheConfigType * config = &machine->config.dcache;
+    unsigned int line = address >> cache->lineBits;
+    unsigned int set = line & (cache->sets - 1);
+    cacheLineType * lines = &cache->lines[set * config->ways];
+    int way;
+
+    for(way = 0; way < config->ways; way++){
+        if(lines[way].valid && lines[way].line == line){
+            machine->prefetcher.redundant++;
+            return;
+        }
+    }
+
+    //nobody waits for the writeback of the victim
+    cache->clock++;
+    way = chooseVictim(cache, config, set);
+    evictLine(machine, cache, config, &lines[way]);
+    lines[way].line = line;
+    lines[way].valid = TRUE;
+    lines[way].dirty = FALSE;
+    lines[way].prefetched = TRUE;
+    lines[way].ticket = 0;
+    lines[way].ready = 0;
+    if(machine->config.dram.banks != 0) lines[way].ticket = dramRequest(machine, line << cache->lineBits, FALSE);
+    else lines[way].ready = machine->cycles + config->missLatency;
+    touchLine(cache, config, set, way);
+    machine->prefetcher.issued++;
+}
+
+/* Function Name: fetchReady
+ * Purpose:       Checks whether the DRAM requests of the last instruction read
+ *                through the instruction cache are finished
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       TRUE if the instruction can go on to decode, FALSE otherwise
+ * Modifies:      -
+ */
+bool fetchReady(machineType * machine)
+{
+    return cacheReady(machine, machine->icache.waiting);
+}
+
+/* Function Name: dataReady
+ * Purpose:       Checks whether the DRAM requests of the last access through
+ *                the data cache are finished
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       TRUE if the access is done, FALSE otherwise
+ * Modifies:      -
+ */
+bool dataReady(machineType * machine)
+{
+    return cacheReady(machine, machine->dcache.waiting);
+}
+
+/* Function Name: storeReady
+ * Purpose:       Checks whether the DRAM requests of the last store the store
+ *                buffer wrote through the data cache are finished
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       TRUE if the store is done, FALSE otherwise
+ * Modifies:      -
+ */
+bool storeReady(machineType * machine)
+{
+    return cacheReady(machine, machine->dcache.storing);
+}
+
+/* Function Name: reportCaches
+ * Purpose:       Writes the counters of the caches a machine has
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportCaches(machineType * machine)
+{
+    if(machine->config.icache.size != 0)
+        reportCache(machine, "Instruction", &machine->icache, &machine->config.icache);
+    if(machine->config.dcache.size != 0)
+        reportCache(machine, "Data", &machine->dcache, &machine->config.dcache);
+}
+
+/* Function Name: startCache
+ * Purpose:       Allocates the lines of an empty cache
+ *
+ * Parameters:    cache - cache to start
+ *                config - its shape, a size of 0 for no cache
+ * Returns:       TRUE if the cache could be allocated, FALSE otherwise
+ * Modifies:      cache
+ */
+static bool startCache(cacheType * cache, const cacheConfigType * config)
+{
+    if(config->size == 0) return TRUE;
+
+    cache->sets = config->size / (config->ways * config->lineSize);
+    for(cache->lineBits = 0; (1 << cache->lineBits) < config->lineSize; cache->lineBits++);
+    cache->lines = calloc(cache->sets * config->ways, sizeof(cacheLineType));
+    cache->trees = calloc(cache->sets, sizeof(unsigned int));
+    cache->seed = 0x2545f491;
+    return cache->lines != NULL && cache->trees != NULL;
+}
+
+/* Function Name: accessCache
+ * Purpose:       Accesses the lines that bytes at an address lie in
+ *
+ * Parameters:    machine - machine being simulated
+ *                cache - cache accessed
+ *                config - its shape, a size of 0 to send the access to the DRAM
+ *                address - address of the first byte
+ *                bytes - number of bytes
+ *                write - TRUE for a store
+ *                waiting - gets the DRAM requests the access waits for
+ * Returns:       extra cycles the access takes
+ * Modifies:      cache, waiting
+ */
+static int accessCache(machineType * machine, cacheType * cache, const cacheConfigType * config,
+                       unsigned int address, unsigned int bytes, bool write, unsigned int waiting[2])
+{
+    waiting[0] = waiting[1] = 0;
+    if(config->size == 0){
+        waiting[0] = dramRequest(machine, address, write);
+        return 0;
+    }
+
+    unsigned int first = address >> cache->lineBits;
+    unsigned int last = (address + bytes - 1) >> cache->lineBits;
+    int delay = accessLine(machine, cache, config, first, write, &waiting[0]);
+
+    //an access across two lines waits for the slower one
+    if(last != first){
+        int second = accessLine(machine, cache, config, last, write, &waiting[1]);
+        if(second > delay) delay = second;
+    }
+    return delay;
+}
+
+/* Function Name: accessLine
+ * Purpose:       Accesses a line, filling it on a miss unless it is a store to
+ *                a write-through cache
+ *
+ * Parameters:    machine - machine being simulated
+ *                cache - cache accessed
+ *                config - its shape
+ *                line - address of the line >> line bits
+ *                write - TRUE for a store
+ *                ticket - gets the DRAM request the access waits for, if any
+ * Returns:       extra cycles the access takes
+ * Modifies:      cache, ticket
+ */
+static int accessLine(machineType * machine, cacheType * cache, const cacheConfigType * config,
+                      unsigned int line, bool write, unsigned int * ticket)
+{
+    unsigned int set = line & (cache->sets - 1);
+    cacheLineType * lines = &cache->lines[set * config->ways];
+    bool dram = machine->config.dram.banks != 0;
+    int delay = 0;
+    int way;
+
+    //a write-through store goes on to memory whether it hits or not
+    if(write && !config->writeBack){
+        if(dram) *ticket = dramRequest(machine, line << cache->lineBits, TRUE);
+        else delay = config->missLatency;
+    }
+
+    cache->clock++;
+    for(way = 0; way < config->ways; way++){
+        if(lines[way].valid && lines[way].line == line){
+            cache->hits++;
+            if(write && config->writeBack) lines[way].dirty = TRUE;
+            if(lines[way].prefetched) delay += usePrefetch(machine, &lines[way], ticket);
+            touchLine(cache, config, set, way);
+            return delay;
+        }
+    }
+
+    cache->misses++;
+    if(write && !config->writeBack) return delay;
+
+    //the victim is written back before the line is read
+    way = chooseVictim(cache, config, set);
+    delay += evictLine(machine, cache, config, &lines[way]);
+    lines[way].line = line;
+    lines[way].valid = TRUE;
+    lines[way].dirty = write;
+    lines[way].prefetched = FALSE;
+    lines[way].ticket = 0;
+    lines[way].ready = 0;
+    touchLine(cache, config, set, way);
+    if(dram){
+        *ticket = dramRequest(machine, line << cache->lineBits, FALSE);
+        return delay;
+    }
+    return delay + config->missLatency;
+}
+
+/* Function Name: evictLine
+ * Purpose:       Evicts a line from a cache, writing it back if it is dirty
+ *
+ * Parameters:    machine - machine being simulated
+ *                cache - cache the line is in
+ *                config - its shape
+ *                victim - the line, which may be invalid
+ * Returns:       extra cycles the writeback takes
+ * Modifies:      cache, machine->prefetcher
+ */
+static int evictLine(machineType * machine, cacheType * cache, const cacheConfigType * config,
+                     cacheLineType * victim)
+{
+    if(!victim->valid) return 0;
+    cache->evictions++;
+    if(victim->prefetched) machine->prefetcher.useless++;
+    if(!victim->dirty) return 0;
+
+    cache->writebacks++;
+    if(machine->config.dram.banks == 0) return config->missLatency;
+    dramRequest(machine, victim->line << cache->lineBits, TRUE);
+    return 0;
+}
+
+/* Function Name: usePrefetch
+ * Purpose:       Counts the first access of a prefetched line, which waits for
+ *                the line if its fill isn't done
+ *
+ * Parameters:    machine - machine being simulated
+ *                line - the line
+ *                ticket - gets the DRAM request of the fill if the access waits for it
+ * Returns:       extra cycles the access waits without DRAM
+ * Modifies:      line, machine->prefetcher, ticket
+ */
+static int usePrefetch(machineType * machine, cacheLineType * line, unsigned int * ticket)
+{
+    prefetcherType * prefetcher = &machine->prefetcher;
+    int wait = 0;
+
+    line->prefetched = FALSE;
+    prefetcher->useful++;
+    if(line->ticket != 0 && !dramDone(machine, line->ticket)){
+        prefetcher->late++;
+        if(*ticket == 0) *ticket = line->ticket;
+    }else if(line->ready > machine->cycles){
+        prefetcher->late++;
+        wait = line->ready - machine->cycles;
+        prefetcher->lateCycles += wait;
+    }
+    return wait;
+}
+
+/* Function Name: cacheReady
+ * Purpose:       Checks whether the DRAM requests an access waits for are finished
+ *
+ * Parameters:    machine - machine being simulated
+ *                waiting - the requests, 0 for none
+ * Returns:       TRUE if they are, or if there weren't any
+ * Modifies:      -
+ */
+static bool cacheReady(machineType * machine, unsigned int waiting[2])
+{
+    return (waiting[0] == 0 || dramDone(machine, waiting[0])) &&
+           (waiting[1] == 0 || dramDone(machine, waiting[1]));
+}
+
+/* Function Name: chooseVictim
+ * Purpose:       Chooses the way of a set a new line goes in
+ *
+ * Parameters:    cache - cache missed in
+ *                config - its shape
+ *                set - set of the line
+ * Returns:       an invalid way if there is one, otherwise the way the
+ *                replacement policy chooses
+ * Modifies:      the random seed
+ */
+static int chooseVictim(cacheType * cache, const cacheConfigType * config, unsigned int set)
+{
+    cacheLineType * lines = &cache->lines[set * config->ways];
+    unsigned int node = 1;
+    int way, victim = 0;
+
+    for(way = 0; way < config->ways; way++)
+        if(!lines[way].valid) return way;
+
+    switch(config->replacement){
+        case REPLPLRU:
+            //follow the bits down the tree, each points at the half used less recently
+            while(node < (unsigned int) config->ways)
+                node = 2 * node + ((cache->trees[set] >> (node - 1)) & 1);
+            return node - config->ways;
+        case REPLRANDOM:
+            cache->seed ^= cache->seed << 13;
+            cache->seed ^= cache->seed >> 17;
+            cache->seed ^= cache->seed << 5;
+            return cache->seed & (config->ways - 1);
+        default:
+            for(way = 1; way < config->ways; way++)
+                if(lines[way].used < lines[victim].used) victim = way;
+            return victim;
+    }
+}
+
+/* Function Name: touchLine
+ * Purpose:       Records that a way of a set was just used
+ *
+ * Parameters:    cache - cache accessed
+ *                config - its shape
+ *                set - set of the line
+ *                way - way of the line
+ * Returns:       -
+ * Modifies:      the LRU clock of the line and the PLRU bits of the set
+ */
+static void touchLine(cacheType * cache, const cacheConfigType * config, unsigned int set, int way)
+{
+    unsigned int node = config->ways + way;
+
+    cache->lines[set * config->ways + way].used = cache->clock;
+
+    //point every node on the way up at the other half
+    for(; node > 1; node /= 2){
+        unsigned int bit = 1 << (node / 2 - 1);
+        if(node & 1) cache->trees[set] &= ~bit;
+        else cache->trees[set] |= bit;
+    }
+}
+
+/* Function Name: reportCache
+ * Purpose:       Writes the shape and counters of a cache
+ *
+ * Parameters:    machine - machine that ran the program
+ *                name - which cache it is
+ *                cache - the cache
+ *                config - its shape
+ * Returns:       -
+ * Modifies:      -
+ */
+static void reportCache(machineType * machine, const char * name, cacheType * cache,
+                        const cacheConfigType * config)
+{
+    unsigned long long accesses = cache->hits + cache->misses;
+
+    fprintf(machine->out, "\n%s cache = %d bytes %d ways %d byte lines %s %s miss latency = %d\n", name,
+            config->size, config->ways, config->lineSize, names[config->replacement],
+            config->writeBack ? "write-back" : "write-through", config->missLatency);
+    fprintf(machine->out, "Accesses = %llu hits = %llu misses = %llu evictions = %llu writebacks = %llu "
+            "hit rate = %.2f%%\n", accesses, cache->hits, cache->misses, cache->evictions, cache->writebacks,
+            accesses == 0 ? 100.0 : 100.0 * cache->hits / accesses);
+}
@@ -0,0 +1,65 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+//replacement policies of a cache
+#define REPLLRU 0             //least recently used
+#define REPLPLRU 1            //tree pseudo-LRU
+#define REPLRANDOM 2          //a random way
+#define REPLPOLICIES 3
+
+//largest miss latency that can be asked for
+#define MAXMISSLATENCY 1000
+
+//shape and timing of a cache, kept with the rest of the configuration
+typedef struct
+{
+    int size;                 //bytes of data, 0 for no cache
+    int ways;
+    int lineSize;             //bytes
+    int replacement;          //REPL...
+    bool writeBack;           //FALSE for write-through without allocating on a store miss
+    int missLatency;          //extra cycles of a miss, of a write-through store and of writing back a line,
+                              //unless they go to the DRAM
+} cacheConfigType;
+
+//a line of a cache, only the tag is kept, the data stays in memory
+typedef struct
+{
+    unsigned int line;        //address >> line bits
+    unsigned long long used;  //clock of the last access, for LRU
+    bool valid;
+    bool dirty;
+    bool prefetched;          //TRUE until the first access of a line the prefetcher filled
+    unsigned int ticket;      //DRAM request filling a prefetched line
+    unsigned long long ready; //cycle the fill of a prefetched line is done without DRAM
+} cacheLineType;
+
+//state of a cache of a machine
+typedef struct
+{
+    cacheLineType * lines;    //ways lines of set 0, then of set 1, ...
+    unsigned int * trees;     //PLRU bits of each set, bit n is node n + 1 of the tree
+    unsigned int sets;
+    unsigned int lineBits;
+    unsigned long long clock;
+    unsigned int seed;        //of the random replacement
+    unsigned int waiting[2];  //DRAM requests the last access waits for, 0 for none
+    unsigned int storing[2];  //DRAM requests the last store of the store buffer waits for
+
+    unsigned long long hits, misses, evictions, writebacks;
+} cacheType;
+
+//prototypes
+int findReplacement(char * name);
+bool validCache(const cacheConfigType * config);
+void clearCaches(machineType * machine);
+bool startCaches(machineType * machine);
+int fetchDelay(machineType * machine, unsigned int address, unsigned int bytes);
+int dataDelay(machineType * machine, unsigned int address, bool write);
+bool fetchReady(machineType * machine);
+bool dataReady(machineType * machine);
+int storeDelay(machineType * machine, unsigned int address);
+void prefetchLine(machineType * machine, unsigned int address);
+bool storeReady(machineType * machine);
+void reportCaches(machineType * machine);
+#endif
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "instructions.h"
+
+/*
+ * CallGraph.c - keeps a shadow call stack of the program from the calls
+ * and rets that retire in the writeback stage, so only the instructions
+ * the program really ran are seen.  A function starts at the instruction
+ * that retires after a call and ends at its ret.
+ *
+ * The stack is kept as the tree of every call path the program has had,
+ * and each instruction that retires is charged to the path running, with
+ * the cycles from the instruction before it retiring to it retiring.  A
+ * function's exclusive cycles and instructions are those of the paths that
+ * end in it, its inclusive ones those of the paths it is anywhere on,
+ * counted once however deep it recursed.  The paths are written in the
+ * folded stack format flame graphs are drawn from, one line per path with
+ * the functions separated by ';' and the cycles after a space.
+ *
+ * Functions are named by the label at their address in the source of the
+ * .yo file, or by the address if there isn't one.
+ */
+
+//a function of the program, for the report
+typedef struct
+{
+    unsigned int address;
+    int depth;                //times it is on the path being visited
+    unsigned long long calls;
+    unsigned long long cycles, instructions;              //exclusive
+    unsigned long long allCycles, allInstructions;        //inclusive
+} functionType;
+
+//prototypes of functions only called within this file
+static int addNode(callGraphType * graph, unsigned int address, int parent);
+static void enterFunction(callGraphType * graph, unsigned int address);
+static void nameFunction(machineType * machine, unsigned int address, char * name, int size);
+static int findFunction(functionType * functions, int * slots, int size, int * count, unsigned int address);
+static int compareInclusive(const void * first, const void * second);
+//end prototypes
+
+/* Function Name: startCallGraph
+ * Purpose:       Empties the call stack for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->callGraph
+ */
+void startCallGraph(machineType * machine)
+{
+    callGraphType * graph = &machine->callGraph;
+
+    graph->count = 0;
+    graph->current = -1;
+    graph->called = FALSE;
+    graph->lost = 0;
+    graph->retiredAt = 0;
+}
+
+/* Function Name: clearCallGraph
+ * Purpose:       Releases the call paths
+ *
+ * Parameters:    machine - machine to clear
+ * Returns:       -
+ * Modifies:      machine->callGraph
+ */
+void clearCallGraph(machineType * machine)
+{
+    free(machine->callGraph.nodes);
+    machine->callGraph.nodes = NULL;
+    machine->callGraph.size = 0;
+    startCallGraph(machine);
+}
+
+/* Function Name: retireCall
+ * Purpose:       Charges an instruction that reached writeback to the
+ *                function running, and follows the calls and rets
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the instruction
+ *                icode - its icode
+ * Returns:       -
+ * Modifies:      machine->callGraph
+ */
+void retireCall(machineType * machine, unsigned int pc, unsigned int icode)
+{
+    callGraphType * graph = &machine->callGraph;
+    callNodeType * node;
+
+    //it retires in the cycle being simulated, machine->cycles counts the ones before it
+    unsigned long long cycles = machine->cycles + 1 - graph->retiredAt;
+    graph->retiredAt = machine->cycles + 1;
+
+    //the first instruction starts the path everything else is called from
+    if(graph->current == -1){
+        graph->current = addNode(graph, pc, -1);
+        if(graph->current == -1) return;
+    }else if(graph->called) enterFunction(graph, pc);
+    graph->called = FALSE;
+
+    node = &graph->nodes[graph->current];
+    node->cycles += cycles;
+    node->instructions++;
+
+    //a ret with nothing to return to stays in the first function
+    if(icode == ICALL) graph->called = TRUE;
+    else if(icode == IRET){
+        if(graph->lost > 0) graph->lost--;
+        else if(node->parent != -1) graph->current = node->parent;
+    }
+}
+
+/* Function Name: reportCallGraph
+ * Purpose:       Writes the cycles and instructions of each function,
+ *                inclusive and exclusive, if the configuration asks for them
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportCallGraph(machineType * machine)
+{
+    callGraphType * graph = &machine->callGraph;
+    unsigned long long * cycles, * instructions;
+    functionType * functions;
+    int * ids, * slots;
+    int i, size, count = 0, node;
+    char name[64];
+
+    if(machine->config.foldedFile == NULL || graph->count == 0) return;
+    for(size = 64; size < 2 * graph->count; size *= 2);
+    functions = calloc(graph->count, sizeof(functionType));
+    ids = malloc(graph->count * sizeof(int));
+    slots = malloc(size * sizeof(int));
+    cycles = calloc(graph->count, sizeof(unsigned long long));
+    instructions = calloc(graph->count, sizeof(unsigned long long));
+    if(functions == NULL || ids == NULL || slots == NULL || cycles == NULL || instructions == NULL){
+        fprintf(machine->out, "\nUnable to allocate the call graph report\n");
+        free(functions);
+        free(ids);
+        free(slots);
+        free(cycles);
+        free(instructions);
+        return;
+    }
+
+    //the exclusive counts of each function, and the counts of each path and all the
+    //paths it leads to, a path always comes after the one it was called from
+    for(i = 0; i < size; i++) slots[i] = -1;
+    for(i = 0; i < graph->count; i++){
+        callNodeType * path = &graph->nodes[i];
+        functionType * function;
+
+        ids[i] = findFunction(functions, slots, size, &count, path->address);
+        function = &functions[ids[i]];
+        function->calls += path->calls;
+        function->cycles += path->cycles;
+        function->instructions += path->instructions;
+        cycles[i] = path->cycles;
+        instructions[i] = path->instructions;
+    }
+    for(i = graph->count - 1; i > 0; i--){
+        cycles[graph->nodes[i].parent] += cycles[i];
+        instructions[graph->nodes[i].parent] += instructions[i];
+    }
+
+    //walk the paths depth first, a function gets the counts of a path unless it is on
+    //the path to it already
+    node = 0;
+    while(node != -1){
+        functionType * function = &functions[ids[node]];
+        if(function->depth++ == 0){
+            function->allCycles += cycles[node];
+            function->allInstructions += instructions[node];
+        }
+        if(graph->nodes[node].child != -1){
+            node = graph->nodes[node].child;
+            continue;
+        }
+        while(node != -1){
+            functions[ids[node]].depth--;
+            if(graph->nodes[node].sibling != -1){
+                node = graph->nodes[node].sibling;
+                break;
+            }
+            node = graph->nodes[node].parent;
+        }
+    }
+
+    qsort(functions, count, sizeof(functionType), compareInclusive);
+    fprintf(machine->out, "\nCall graph = %d functions %d call paths, inclusive of the functions they call\n",
+            count, graph->count);
+    fprintf(machine->out, "%-24s %10s %14s %14s %14s %14s\n", "Function", "Calls", "Cycles", "Self cycles",
+            "Instructions", "Self instrs");
+    for(i = 0; i < count; i++){
+        functionType * function = &functions[i];
+        nameFunction(machine, function->address, name, sizeof(name));
+        fprintf(machine->out, "%-24s %10llu %14llu %14llu %14llu %14llu\n", name, function->calls,
+                function->allCycles, function->cycles, function->allInstructions, function->instructions);
+    }
+
+    free(functions);
+    free(ids);
+    free(slots);
+    free(cycles);
+    free(instructions);
+}
+
+/* Function Name: writeFolded
+ * Purpose:       Writes the call paths with the cycles charged to them in the
+ *                folded stack format, one line per path
+ *
+ * Parameters:    machine - machine that ran the program
+ *                prefix - frame put before every path, NULL for none
+ *                out - stream to write to
+ * Returns:       -
+ * Modifies:      -
+ */
+void writeFolded(machineType * machine, char * prefix, FILE * out)
+{
+    callGraphType * graph = &machine->callGraph;
+    int * path = malloc(graph->count * sizeof(int));
+    int i, depth, node;
+    char name[64];
+
+    if(path == NULL) return;
+    for(i = 0; i < graph->count; i++){
+        if(graph->nodes[i].cycles == 0) continue;
+        depth = 0;
+        for(node = i; node != -1; node = graph->nodes[node].parent) path[depth++] = node;
+
+        if(prefix != NULL) fprintf(out, "%s;", prefix);
+        while(depth-- > 0){
+            nameFunction(machine, graph->nodes[path[depth]].address, name, sizeof(name));
+            fprintf(out, "%s%c", name, depth == 0 ? ' ' : ';');
+        }
+        fprintf(out, "%llu\n", graph->nodes[i].cycles);
+    }
+    free(path);
+}
+
+/* Function Name: addNode
+ * Purpose:       Adds a call path
+ *
+ * Parameters:    graph - call graph of the machine
+ *                address - address of the function it ends in
+ *                parent - path it was called from, -1 for none
+ * Returns:       index of the path, -1 if it couldn't be added
+ * Modifies:      graph
+ */
+static int addNode(callGraphType * graph, unsigned int address, int parent)
+{
+    callNodeType * node;
+
+    if(graph->count == graph->size){
+        int size = graph->size == 0 ? 64 : graph->size * 2;
+        callNodeType * nodes;
+        if(size > MAXCALLNODES) return -1;
+        nodes = realloc(graph->nodes, size * sizeof(callNodeType));
+        if(nodes == NULL) return -1;
+        graph->nodes = nodes;
+        graph->size = size;
+    }
+
+    node = &graph->nodes[graph->count];
+    memset(node, 0, sizeof(callNodeType));
+    node->address = address;
+    node->parent = parent;
+    node->child = -1;
+    node->sibling = -1;
+    node->calls = 1;
+    if(parent != -1){
+        node->sibling = graph->nodes[parent].child;
+        graph->nodes[parent].child = graph->count;
+    }
+    return graph->count++;
+}
+
+/* Function Name: enterFunction
+ * Purpose:       Moves down the call path to a function just called
+ *
+ * Parameters:    graph - call graph of the machine
+ *                address - address of the function
+ * Returns:       -
+ * Modifies:      graph
+ */
+static void enterFunction(callGraphType * graph, unsigned int address)
+{
+    int node;
+
+    //once a call is lost so are the calls it makes
+    if(graph->lost > 0){
+        graph->lost++;
+        return;
+    }
+
+    for(node = graph->nodes[graph->current].child; node != -1; node = graph->nodes[node].sibling)
+        if(graph->nodes[node].address == address) break;
+    if(node != -1) graph->nodes[node].calls++;
+    else node = addNode(graph, address, graph->current);
+
+    if(node == -1) graph->lost++;
+    else graph->current = node;
+}
+
+/* Function Name: nameFunction
+ * Purpose:       Names a function by its label, or its address if it has none
+ *
+ * Parameters:    machine - machine that ran the program
+ *                address - address of the function
+ *                name - gets the name
+ *                size - bytes name can hold
+ * Returns:       -
+ * Modifies:      name
+ */
+static void nameFunction(machineType * machine, unsigned int address, char * name, int size)
+{
+    if(!findLabel(machine, address, name, size)) snprintf(name, size, "0x%03x", address);
+}
+
+/* Function Name: findFunction
+ * Purpose:       Finds the function at an address, adding it if it's new
+ *
+ * Parameters:    functions - the functions found so far
+ *                slots - hash of the addresses, the index of each function or -1
+ *                size - slots in the hash, a power of two larger than the functions
+ *                count - number of functions found so far
+ *                address - address of the function
+ * Returns:       index of the function
+ * Modifies:      functions, slots, count
+ */
+static int findFunction(functionType * functions, int * slots, int size, int * count, unsigned int address)
+{
+    unsigned int i = address & (size - 1);
+
+    while(slots[i] != -1 && functions[slots[i]].address != address) i = (i + 1) & (size - 1);
+    if(slots[i] == -1){
+        slots[i] = (*count)++;
+        functions[slots[i]].address = address;
+    }
+    return slots[i];
+}
+
+/* Function Name: compareInclusive
+ * Purpose:       Orders functions by their inclusive cycles for qsort, most
+ *                first and then by address
+ *
+ * Parameters:    first, second - pointers to the functions
+ * Returns:       negative, zero or positive as first goes before, with or
+ *                after second
+ * Modifies:      -
+ */
+static int compareInclusive(const void * first, const void * second)
+{
+    const functionType * a = first;
+    const functionType * b = second;
+
+    if(a->allCycles != b->allCycles) return a->allCycles > b->allCycles ? -1 : 1;
+    return (a->address > b->address) - (a->address < b->address);
+}
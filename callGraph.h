@@ -0,0 +1,37 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+//most call paths the call graph keeps, deeper calls are charged to the path they were made from
+#define MAXCALLNODES (1 << 20)
+
+//a call path, the functions called from the first instruction down to one function
+typedef struct
+{
+    unsigned int address;     //of the function, the first instruction that retired in it
+    int parent;               //index of the path it was called from, -1 for the first
+    int child;                //first path it called, -1 for none
+    int sibling;              //next path its parent called, -1 for none
+    unsigned long long calls;
+    unsigned long long cycles;            //charged to the function itself on this path
+    unsigned long long instructions;
+} callNodeType;
+
+//shadow call stack of a machine, kept as the tree of the call paths it has had
+typedef struct
+{
+    callNodeType * nodes;     //the first is the path of the first instruction
+    int count;
+    int size;
+    int current;              //path of the function running, -1 before the first instruction
+    bool called;              //TRUE if a call just retired, the next instruction starts a function
+    unsigned int lost;        //calls too deep to keep a path for that haven't returned
+    unsigned long long retiredAt;         //clock cycles when the last instruction retired
+} callGraphType;
+
+//prototypes
+void startCallGraph(machineType * machine);
+void clearCallGraph(machineType * machine);
+void retireCall(machineType * machine, unsigned int pc, unsigned int icode);
+void reportCallGraph(machineType * machine);
+void writeFolded(machineType * machine, char * prefix, FILE * out);
+#endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <string.h>
+#include "machine.h"
+#include "instructions.h"
+
+/*
+ * Counters.c - counts what the pipeline did with each clock cycle: the
+ * instructions it retired, by icode, and the cycles each pipeline register
+ * was stalled or bubbled, by the cause.  The stages count their own stalls
+ * and bubbles where they make them, writeback counts what retires.  A bubble
+ * carries the pc NOPC, so the nops a program has are told apart from the
+ * nops the pipeline inserts.  With a profile each count is also charged
+ * to an instruction of the program, and a trace records it with the cycle.
+ *
+ * The counters are read through getCounters and getCPI, and writeCounters
+ * writes them as a JSON object.
+ */
+
+//names of the registers and the causes, indexed by STAGE... and CAUSE...
+static const char * stageNames[STAGES] = {"F", "D", "E", "M", "W"};
+static const char * causeNames[CAUSES] = {"load-use", "ret", "mispredict", "exception", "ret-miss", "fetch",
+                                          "execute", "memory"};
+
+//names of the icodes of the instructions, the three icodes after IDUMP retire as invalid
+static const char * icodeNames[IDUMP + 1] = {"halt", "nop", "rrmovl", "irmovl", "rmmovl", "mrmovl", "opl", "jxx",
+                                             "call", "ret", "pushl", "popl", "dump"};
+
+//prototypes of functions only called within this file
+static void writeCauses(unsigned long long counts[STAGES][CAUSES], FILE * out);
+//end prototypes
+
+/* Function Name: causeName
+ * Purpose:       Names the cause of a stall or a bubble
+ *
+ * Parameters:    cause - CAUSE... of it
+ * Returns:       the name
+ * Modifies:      -
+ */
+const char * causeName(int cause)
+{
+    return causeNames[cause];
+}
+
+/* Function Name: icodeName
+ * Purpose:       Names the instruction of an icode
+ *
+ * Parameters:    icode - the icode
+ * Returns:       the name, invalid for the icodes that aren't instructions
+ * Modifies:      -
+ */
+const char * icodeName(unsigned int icode)
+{
+    return icode <= IDUMP ? icodeNames[icode] : "invalid";
+}
+
+/* Function Name: startCounters
+ * Purpose:       Zeroes the counters for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->counters
+ */
+void startCounters(machineType * machine)
+{
+    memset(&machine->counters, 0, sizeof(machine->counters));
+}
+
+/* Function Name: getCounters
+ * Purpose:       Gives the counters of the program the pipeline ran
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       the counters, with the clock cycles in machine->cycles
+ * Modifies:      -
+ */
+const countersType * getCounters(machineType * machine)
+{
+    return &machine->counters;
+}
+
+/* Function Name: getCPI
+ * Purpose:       Works out the clock cycles per retired instruction
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       the CPI, 0 if nothing retired
+ * Modifies:      -
+ */
+double getCPI(machineType * machine)
+{
+    if(machine->counters.retired == 0) return 0.0;
+    return (double) machine->cycles / machine->counters.retired;
+}
+
+/* Function Name: countStall
+ * Purpose:       Counts a cycle a pipeline register kept its instruction
+ *
+ * Parameters:    machine - machine being simulated
+ *                stage - STAGE... of the register
+ *                cause - CAUSE... of the stall
+ * Returns:       -
+ * Modifies:      machine->counters, machine->profile, machine->trace
+ */
+void countStall(machineType * machine, int stage, int cause)
+{
+    machine->counters.stalls[stage][cause]++;
+    if(machine->config.profile) profileStall(machine, stage);
+    if(machine->trace.out != NULL) traceFlags(machine, stage, TRACESTALL, cause);
+}
+
+/* Function Name: countBubble
+ * Purpose:       Counts a cycle a pipeline register was given a bubble
+ *
+ * Parameters:    machine - machine being simulated
+ *                stage - STAGE... of the register
+ *                cause - CAUSE... of the bubble
+ * Returns:       -
+ * Modifies:      machine->counters, machine->profile, machine->trace
+ */
+void countBubble(machineType * machine, int stage, int cause)
+{
+    machine->counters.bubbles[stage][cause]++;
+    if(machine->config.profile) profileBubble(machine, cause);
+    if(machine->trace.out != NULL) traceFlags(machine, stage, TRACEBUBBLE, cause);
+}
+
+/* Function Name: countRetired
+ * Purpose:       Counts an instruction that reached writeback
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - its address
+ *                icode - its icode
+ * Returns:       -
+ * Modifies:      machine->counters, machine->profile
+ */
+void countRetired(machineType * machine, unsigned int pc, unsigned int icode)
+{
+    machine->counters.retired++;
+    machine->counters.icodes[icode & 0xf]++;
+    if(machine->config.profile) profileRetired(machine, pc);
+}
+
+/* Function Name: stallCause
+ * Purpose:       Finds why the F, D or E register is stalled, the cause
+ *                furthest down the pipeline when there are several
+ *
+ * Parameters:    signals - signals of the later stages this clock cycle
+ * Returns:       CAUSEMEMORY or CAUSEEXECUTE if the instruction in the execute
+ *                stage stays there, CAUSELOADUSE for a load-use hazard and
+ *                CAUSERET otherwise, when fetch waits for a ret
+ * Modifies:      -
+ */
+int stallCause(signalType * signals)
+{
+    if(signals->e_busy) return signals->m_busy ? CAUSEMEMORY : CAUSEEXECUTE;
+    if(signals->d_loadUse) return CAUSELOADUSE;
+    return CAUSERET;
+}
+
+/* Function Name: bubbleCause
+ * Purpose:       Finds why the D or E register is bubbled, the cause
+ *                furthest down the pipeline when there are several
+ *
+ * Parameters:    machine - machine being simulated
+ *                signals - signals of the later stages this clock cycle
+ * Returns:       CAUSERETMISS, CAUSEMISPREDICT, CAUSELOADUSE or CAUSERET when
+ *                fetch waits for a ret
+ * Modifies:      -
+ */
+int bubbleCause(machineType * machine, signalType * signals)
+{
+    if(signals->m_retMiss) return CAUSERETMISS;
+    if(machine->cur->E.icode == IJXX && signals->e_Cnd != machine->cur->E.predTaken) return CAUSEMISPREDICT;
+    if(signals->d_loadUse) return CAUSELOADUSE;
+    return CAUSERET;
+}
+
+/* Function Name: writeCounters
+ * Purpose:       Writes the counters of the program the pipeline ran as a
+ *                JSON object, without a newline after it
+ *
+ * Parameters:    machine - machine that ran the program
+ *                fileName - the program
+ *                out - stream to write to
+ * Returns:       -
+ * Modifies:      -
+ */
+void writeCounters(machineType * machine, char * fileName, FILE * out)
+{
+    countersType * counters = &machine->counters;
+    const char * c;
+    unsigned int i;
+
+    fprintf(out, "{\n  \"program\": \"");
+    //quotes, backslashes and control characters are escaped, the rest of the name is written as it is
+    for(c = fileName; *c != '\0'; c++){
+        if((unsigned char) *c < 0x20) fprintf(out, "\\u%04x", (unsigned char) *c);
+        else{
+            if(*c == '"' || *c == '\\') fputc('\\', out);
+            fputc(*c, out);
+        }
+    }
+    fprintf(out, "\",\n  \"cycles\": %llu,\n  \"instructions\": %llu,\n  \"cpi\": %.4f,\n", machine->cycles,
+            counters->retired, getCPI(machine));
+
+    fprintf(out, "  \"retired\": {");
+    for(i = 0; i <= IDUMP; i++) fprintf(out, "\"%s\": %llu, ", icodeName(i), counters->icodes[i]);
+    fprintf(out, "\"invalid\": %llu},\n", counters->icodes[13] + counters->icodes[14] + counters->icodes[15]);
+
+    fprintf(out, "  \"stalls\": ");
+    writeCauses(counters->stalls, out);
+    fprintf(out, ",\n  \"bubbles\": ");
+    writeCauses(counters->bubbles, out);
+    fprintf(out, "\n}");
+}
+
+/* Function Name: writeCauses
+ * Purpose:       Writes the stalls or the bubbles of each register by cause
+ *                as a JSON object
+ *
+ * Parameters:    counts - the stalls or the bubbles
+ *                out - stream to write to
+ * Returns:       -
+ * Modifies:      -
+ */
+static void writeCauses(unsigned long long counts[STAGES][CAUSES], FILE * out)
+{
+    int stage, cause;
+
+    fprintf(out, "{");
+    for(stage = 0; stage < STAGES; stage++){
+        fprintf(out, "%s\n    \"%s\": {", stage == 0 ? "" : ",", stageNames[stage]);
+        for(cause = 0; cause < CAUSES; cause++)
+            fprintf(out, "%s\"%s\": %llu", cause == 0 ? "" : ", ", causeName(cause), counts[stage][cause]);
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  }");
+}
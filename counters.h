@@ -0,0 +1,45 @@
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+//pipeline registers a clock cycle can stall or bubble, a stalled register keeps
+//its instruction and a bubbled one gets a nop
+#define STAGEF 0
+#define STAGED 1
+#define STAGEE 2
+#define STAGEM 3              //the last memory stage, or M[0] when the execute stage bubbles it
+#define STAGEW 4
+#define STAGES 5
+
+//why a register was stalled or bubbled
+#define CAUSELOADUSE 0        //an instruction needs a register a load hasn't read yet
+#define CAUSERET 1            //fetch waits for a ret to read its address
+#define CAUSEMISPREDICT 2     //a conditional jump went the other way
+#define CAUSEEXCEPTION 3      //an instruction ahead stopped the program
+#define CAUSERETMISS 4        //the return address stack predicted a ret wrongly
+#define CAUSEFETCH 5          //the instruction is still in the fetch stages, the icache or DRAM
+#define CAUSEEXECUTE 6        //an OPL takes more than a cycle in the execute stage
+#define CAUSEMEMORY 7         //an access takes more than a cycle in the last memory stage
+#define CAUSES 8
+
+//counters of the pipeline for the program a machine ran
+typedef struct
+{
+    unsigned long long retired;               //instructions that reached writeback
+    unsigned long long icodes[16];            //of them, those of each icode
+    unsigned long long stalls[STAGES][CAUSES];
+    unsigned long long bubbles[STAGES][CAUSES];
+} countersType;
+
+//prototypes
+const char * causeName(int cause);
+const char * icodeName(unsigned int icode);
+void startCounters(machineType * machine);
+const countersType * getCounters(machineType * machine);
+double getCPI(machineType * machine);
+void countStall(machineType * machine, int stage, int cause);
+void countBubble(machineType * machine, int stage, int cause);
+void countRetired(machineType * machine, unsigned int pc, unsigned int icode);
+int stallCause(signalType * signals);
+int bubbleCause(machineType * machine, signalType * signals);
+void writeCounters(machineType * machine, char * fileName, FILE * out);
+#endif
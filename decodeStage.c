@@ -1,25 +1,18 @@
-#include "bool.h"
-#include "forwarding.h"
-#include "status.h"
-#include "bubbling.h"
-#include "decodeStage.h"
+#include "machine.h"
 #include "tools.h"
 #include "instructions.h"
-#include "executeStage.h"
-#include "registers.h"
+#include "opcodes.h"
 
-/*D register holds the input for the decode stage.
- * It is only accessible from this file. (static)*/
-static dregister D;
+/*A machine's D register holds the input for the decode stage.
+ * It is only accessed from this file, the stage reads cur->D and writes next->E.*/
 
 //prototypes
-unsigned int selectFwdA(unsigned int d_srcA, forwardType forwarded);
-unsigned int forwardB(unsigned int d_srcB, forwardType forwarded);
-unsigned int getDstE();
-unsigned int getDstM();
-unsigned int getSrcA();
-unsigned int getSrcB();
-bool E_bubble(bubbleType *bubble);
+unsigned int selectFwdA(machineType * machine, unsigned int d_srcA, bool useValP, signalType * signals);
+unsigned int forwardB(machineType * machine, unsigned int d_srcB, signalType * signals);
+unsigned int forward(machineType * machine, unsigned int src, signalType * signals);
+bool E_bubble(machineType * machine, signalType * signals);
+bool loadUseHazard(machineType * machine, signalType * signals);
+bool pendingLoad(unsigned int icode, unsigned int dstM, signalType * signals);
 
 
 /* Function Name: decodeStage
@@ -28,123 +21,105 @@ bool E_bubble(bubbleType *bubble);
  *                Execute Stage to operate with.
  *
  * Returns:       -
- * Parameters:    forward - a struct used for forwarding of values from later stages
- *                bubble - pointer to a struct used for bubbling/stalling
- * Modifies:      -
+ * Parameters:    machine - machine being simulated
+ *                signals - values of the later stages used for forwarding and
+ *                          bubbling, gets the source registers of this stage
+ * Modifies:      next E register, signals->d_srcA, signals->d_srcB, signals->d_loadUse
  */
-void decodeStage(forwardType forward, bubbleType *bubble){
+void decodeStage(machineType * machine, signalType * signals){
+    dregister * D = &machine->cur->D;
+
+    //the descriptor's register selectors index this array
+    const opcodeType * op = &opcodeTable[OPCODE(D->icode, D->ifun)];
+    unsigned int regs[4];
+    regs[SELNONE] = RNONE;
+    regs[SELRA] = D->rA;
+    regs[SELRB] = D->rB;
+    regs[SELESP] = ESP;
+
     //set variables
-    unsigned int d_srcA = getSrcA();
-    unsigned int d_srcB = getSrcB();
-    unsigned int d_dstM = getDstM();
-    unsigned int d_dstE = getDstE();
+    unsigned int d_srcA = regs[op->srcA];
+    unsigned int d_srcB = regs[op->srcB];
+    unsigned int d_dstM = regs[op->dstM];
+    unsigned int d_dstE = regs[op->dstE];
 
     unsigned int d_valA, d_valB;
 
     //select forwarding sources
-    d_valA = selectFwdA(d_srcA, forward);
-    d_valB = forwardB(d_srcB, forward);
+    d_valA = selectFwdA(machine, d_srcA, op->useValP, signals);
+    d_valB = forwardB(machine, d_srcB, signals);
 
     //set the bubble conditions
-    bubble->D_icode = D.icode;
-    bubble->d_srcA = d_srcA;
-    bubble->d_srcB = d_srcB;
+    signals->d_srcA = d_srcA;
+    signals->d_srcB = d_srcB;
+    signals->d_loadUse = loadUseHazard(machine, signals);
 
-    //update the E register for the Execute Stage
-    if(E_bubble(bubble)) updateEregister(SAOK, INOP, 0, 0, 0, 0, RNONE, RNONE, RNONE, RNONE);
-    else updateEregister(D.stat, D.icode, D.ifun, D.valC, d_valA, d_valB, d_dstE, d_dstM, d_srcA, d_srcB);
+    //update the E register for the Execute Stage, unless the instruction in it stays there
+    if(signals->e_busy){
+        machine->next->E = machine->cur->E;
+        if(machine->next->E.cycles < MAXLATENCY) machine->next->E.cycles++;
+        countStall(machine, STAGEE, stallCause(signals));
+    }
+    else if(E_bubble(machine, signals)){
+        updateEregister(machine, SAOK, INOP, 0, 0, 0, 0, RNONE, RNONE, RNONE, RNONE, NOPC, FALSE);
+        countBubble(machine, STAGEE, bubbleCause(machine, signals));
+        TRACEPOINT(TPBUBBLE, machine, NOPC, STAGEE, bubbleCause(machine, signals));
+    }
+    else{
+        updateEregister(machine, D->stat, D->icode, D->ifun, D->valC, d_valA, d_valB, d_dstE, d_dstM,
+                        d_srcA, d_srcB, D->pc, D->predTaken);
+        machine->next->E.checkpoint = D->checkpoint;
+    }
 }
 
 /* Function Name: getDregister
  * Purpose:       Returns a copy of the D register
  *
- * Parameters:    none
+ * Parameters:    machine - machine being simulated
  * Returns:       D register
  * Modifies:      none
  */
-dregister getDregister(){
-    return D;
+dregister getDregister(machineType * machine){
+    return machine->cur->D;
 }
 
 /* Function Name: clearDregister
  * Purpose:       Clears the D register
  *
- * Parameters:    none
+ * Parameters:    machine - machine being simulated
  * Returns:       none
  * Modifies:      D
  */
-void clearDregister(){
-    clearBuffer((char *) &D, sizeof(D));
-    D.stat = SAOK;
-    D.icode = INOP;
+void clearDregister(machineType * machine){
+    clearBuffer((char *) &machine->cur->D, sizeof(machine->cur->D));
+    machine->cur->D.stat = SAOK;
+    machine->cur->D.icode = INOP;
+    machine->cur->D.pc = NOPC;
 }
 
 /* Funcion Name: updateDregister
  * Purpose:      Used by the Fetch Stage to update values in the D register
  *
  * Returns:      None
- * Parameters:   Values used by the Decode Stage
- * Modifies:     None
+ * Parameters:   machine - machine being simulated
+ *               Values used by the Decode Stage
+ * Modifies:     next D register
  */
-void updateDregister(unsigned int stat, unsigned int icode, unsigned int ifun,
-    unsigned int rA, unsigned int rB, unsigned int valC, unsigned int valP)
+void updateDregister(machineType * machine, unsigned int stat, unsigned int icode, unsigned int ifun,
+    unsigned int rA, unsigned int rB, unsigned int valC, unsigned int valP, unsigned int pc,
+    unsigned int predTaken)
 {
-    D.stat = stat;
-    D.icode = icode;
-    D.ifun = ifun;
-    D.rA = rA;
-    D.rB = rB;
-    D.valC = valC;
-    D.valP = valP;
-}
-
-/* Function Name: getSrcA
- * Purpose:       Get the sourceA register if it's needed
- *
- * Returns:       D.rA if the register is needed, RNONE otherwise
- * Parameters:    None
- * Modifies:      None
- */
-unsigned int getSrcA(){
-    switch(D.icode){
-        case IRRMOVL:
-        case IRMMOVL:
-        case IOPL:
-        case IPUSHL:
-            return D.rA;
-
-        case IRET:
-        case IPOPL:
-        	return ESP;
+    dregister * D = &machine->next->D;
 
-        default:
-            return RNONE;
-    }
-}
-
-/* Function Name: getSrcB()
- * Purpose:       Get the sourceB register if it's needed
- *
- * Returns:       D.rB if the register is needed, RNONE otherwise
- * Parameters:    None
- * Modifies:      None
- */
-unsigned int getSrcB(){
-    switch(D.icode){
-        case IMRMOVL:
-        case IRMMOVL:
-        case IOPL:
-            return D.rB;
-
-        case IPUSHL:
-        case IPOPL:
-        case ICALL:
-        case IRET:
-        	return ESP;
-
-        default:
-            return RNONE;
-    }
+    D->stat = stat;
+    D->icode = icode;
+    D->ifun = ifun;
+    D->rA = rA;
+    D->rB = rB;
+    D->valC = valC;
+    D->valP = valP;
+    D->pc = pc;
+    D->predTaken = predTaken;
 }
 
 /* Function Name: selectFwdA()
@@ -152,25 +127,17 @@ unsigned int getSrcB(){
  *                decode stage.
  *
  * Returns:       The required valA value
- * Parameters:    -
+ * Parameters:    machine - machine being simulated
+ *                d_srcA - source register for valA
+ *                useValP - TRUE if the instruction passes valP on as valA
+ *                signals - values computed by later stages this clock cycle
  * Modifies:      -
  */
-unsigned int selectFwdA(unsigned int d_srcA, forwardType forwarded){
-    //returns D.valP(an address) if a jump or call instruction
-    if(D.icode == IJXX || D.icode == ICALL) return D.valP;
-
-    //if valA is not needed in the execute stage
-    else if(d_srcA == RNONE) return 0;
-
-    //checks if forwarding of a value in a later stage is needed
-    else if(d_srcA == forwarded.e_dstE) return forwarded.e_valE; 
-    else if(d_srcA == forwarded.M_dstM) return forwarded.m_valM;
-    else if(d_srcA == forwarded.M_dstE) return forwarded.M_valE;
-    else if(d_srcA == forwarded.W_dstM) return forwarded.W_valM;
-    else if(d_srcA == forwarded.W_dstE) return forwarded.W_valE;
-
-    //returns the value in d_srcA
-    else return getRegister(d_srcA);
+unsigned int selectFwdA(machineType * machine, unsigned int d_srcA, bool useValP, signalType * signals){
+    //returns D.valP(an address) if a call, and the address fetch didn't go on at if a jump,
+    //so a mispredicted jump knows where to go
+    if(useValP) return machine->cur->D.predTaken ? machine->cur->D.valP : machine->cur->D.valC;
+    return forward(machine, d_srcA, signals);
 }
 
 /* Function Name: forwardB()
@@ -178,81 +145,117 @@ unsigned int selectFwdA(unsigned int d_srcA, forwardType forwarded){
  *                decode stage.
  *
  * Returns:       The required valB value
- * Parameters:    -
+ * Parameters:    machine - machine being simulated
+ *                d_srcB - source register for valB
+ *                signals - values computed by later stages this clock cycle
  * Modifies:      -
  */
-unsigned int forwardB(unsigned int d_srcB, forwardType forwarded){
-
-	//if valB is not needed in the execute stage
-    if(d_srcB == RNONE) return 0;
-
-    //checks if forwarding of a value in a later stage is needed
-    else if(d_srcB == forwarded.e_dstE) return forwarded.e_valE;
-    else if(d_srcB == forwarded.M_dstM) return forwarded.m_valM;
-    else if(d_srcB == forwarded.M_dstE) return forwarded.M_valE;
-    else if(d_srcB == forwarded.W_dstM) return forwarded.W_valM;
-    else if(d_srcB == forwarded.W_dstE) return forwarded.W_valE;
-    
-    //returns the value in d_srcB
-    else return getRegister(d_srcB);
+unsigned int forwardB(machineType * machine, unsigned int d_srcB, signalType * signals){
+    return forward(machine, d_srcB, signals);
 }
 
-/* Function Name: getDstM()
- * Purpose:       determines the destination register for
- *                the IMRMOVL and IPOPL operands
+/* Function Name: forward()
+ * Purpose:       Reads a source register, or the value a later stage is
+ *                about to write to it.
  *
- * Returns:       D.rA if the register is needed, RNONE otherwise
- * Parameters:    -
+ * Returns:       The value of the register
+ * Parameters:    machine - machine being simulated
+ *                src - source register
+ *                signals - values computed by later stages this clock cycle
  * Modifies:      -
  */
-unsigned int getDstM(){
-    if(D.icode == IMRMOVL || D.icode == IPOPL) return D.rA;
-    else return RNONE;
-}
+unsigned int forward(machineType * machine, unsigned int src, signalType * signals){
+    int last = machine->config.memoryStages - 1;
+    mregister * M = machine->cur->M;
+    wregister * W = &machine->cur->W;
+    int i;
 
-/* Function Name: getDstE()
- * Purpose:       determines the destination register for certain operands
- *
- * Returns:       D.rA, ESP, or RNONE
- * Parameters:    -
- * Modifies:      -
- */
-unsigned int getDstE(){
-    switch(D.icode){
-        case IRRMOVL:
-        case IIRMOVL:
-        case IOPL:
-            return D.rB;
+	//if the value is not needed in the execute stage
+    if(src == RNONE) return 0;
 
-        case IPUSHL:
-        case IPOPL:
-        case ICALL:
-        case IRET:
-            return ESP;
+    //checks if forwarding of a value in a later stage is needed, newest first, the
+    //tracepoints see where each value came from
+    if(src == signals->e_dstE){
+        TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, STAGEE);
+        return signals->e_valE;
+    }
+    for(i = 0; i < last; i++){
+        //a value not read from memory yet isn't forwarded, the decode stage waits for it
+        if(src == M[i].dstM) return 0;
+        if(src == M[i].dstE){
+            TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, STAGEM);
+            return M[i].valE;
+        }
+    }
+    if(src == M[last].dstM){
+        TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, STAGEM);
+        return signals->m_valM;
+    }
+    else if(src == M[last].dstE){
+        TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, STAGEM);
+        return M[last].valE;
+    }
+    else if(src == W->dstM){
+        TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, STAGEW);
+        return W->valM;
+    }
+    else if(src == W->dstE){
+        TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, STAGEW);
+        return W->valE;
+    }
 
-        default:
-            return RNONE;
-   }    
+    //returns the value in the register
+    TRACEPOINT(TPFORWARD, machine, machine->cur->D.pc, src, TPREGISTERFILE);
+    return getRegister(machine, src);
 }
 
 /* Function Name: E_bubble()
  * Purpose:       determines whether or not the E Register is bubbled
- * Returns:       TRUE if Y86 performed a mispredicted branch or
+ * Returns:       TRUE if Y86 performed a mispredicted branch or ret
  *                or if there is a load/use hazard. Otherwise, FALSE
  *
- * Parameters:    bubble - the values to load into the registers if bubbled
+ * Parameters:    machine - machine being simulated
+ *                signals - values computed by later stages this clock cycle
  * Modifies:      -
  */
-bool E_bubble(bubbleType *bubble){
+bool E_bubble(machineType * machine, signalType * signals){
     //local variables to make code easier to read
-    unsigned int E_icode = bubble->E_icode;
-    unsigned int E_dstM = bubble->E_dstM;
+    unsigned int E_icode = machine->cur->E.icode;
 
     //mispredicted branch detection
-    bool misPredBr = (E_icode == IJXX && !bubble->e_Cnd);
-    //load/use hazard detection
-    bool loadUseHaz = ((E_icode == IMRMOVL || E_icode == IPOPL) && (E_dstM == bubble->d_srcA || E_dstM == bubble->d_srcB));
+    bool misPredBr = (E_icode == IJXX && signals->e_Cnd != machine->cur->E.predTaken);
+    if(misPredBr || signals->d_loadUse || signals->m_retMiss) return TRUE;
+    return FALSE;
+}
+
+/* Function Name: loadUseHazard
+ * Purpose:       Determines if the decode stage needs a value that is still to be read
+ *                from memory, by a load in the execute stage or in a memory stage
+ *                before the last one
+ *
+ * Parameters:    machine - machine being simulated
+ *                signals - holds the source registers of the decode stage
+ * Returns:       TRUE if the decode stage has to wait for a load, FALSE otherwise
+ * Modifies:      -
+ */
+bool loadUseHazard(machineType * machine, signalType * signals){
+    int i;
 
-    if(misPredBr || loadUseHaz) return TRUE;
+    if(pendingLoad(machine->cur->E.icode, machine->cur->E.dstM, signals)) return TRUE;
+    for(i = 0; i < machine->config.memoryStages - 1; i++)
+        if(pendingLoad(machine->cur->M[i].icode, machine->cur->M[i].dstM, signals)) return TRUE;
     return FALSE;
 }
+
+/* Function Name: pendingLoad
+ * Purpose:       Determines if an instruction loads a source register of the decode stage
+ *
+ * Parameters:    icode - instruction code of the instruction
+ *                dstM - register it loads
+ *                signals - holds the source registers of the decode stage
+ * Returns:       TRUE if the instruction is a load of d_srcA or d_srcB, FALSE otherwise
+ * Modifies:      -
+ */
+bool pendingLoad(unsigned int icode, unsigned int dstM, signalType * signals){
+    return (icode == IMRMOVL || icode == IPOPL) && (dstM == signals->d_srcA || dstM == signals->d_srcB);
+}
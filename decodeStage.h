@@ -4,19 +4,23 @@
 //struct representing the D pipeline register
 typedef struct
 {
-    unsigned int stat;
-    unsigned int icode;
-    unsigned int ifun;
-    unsigned int rA;
-    unsigned int rB;
     unsigned int valC;
     unsigned int valP;
+    unsigned int pc;
+    unsigned char stat;
+    unsigned char icode;
+    unsigned char ifun;
+    unsigned char rA;
+    unsigned char rB;
+    unsigned char predTaken;  //TRUE if fetch went on at valC
+    predictorCheckpointType checkpoint; //predictor after it was fetched
 } dregister;
 
 //prototypes for functions called from files other than decodeStage
-dregister getDregister();
-void clearDregiser();
-void updateDregister(unsigned int stat, unsigned int icode, unsigned int ifun,
-    unsigned int rA, unsigned int rB, unsigned int valC, unsigned int valP);
-void decodeStage(forwardType forward, bubbleType *bubble);
+dregister getDregister(machineType * machine);
+void clearDregister(machineType * machine);
+void updateDregister(machineType * machine, unsigned int stat, unsigned int icode, unsigned int ifun,
+    unsigned int rA, unsigned int rB, unsigned int valC, unsigned int valP, unsigned int pc,
+    unsigned int predTaken);
+void decodeStage(machineType * machine, signalType * signals);
 #endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+
+/*
+ * Dram.c - models the timing of the DRAM behind the caches of the pipeline.
+ * Like the caches it never holds the program's bytes, it only decides when
+ * a request for them is finished.
+ *
+ * The caches send a request for each line they fill or write back, and
+ * without a cache each access is a request.  A request waits in the queue
+ * until its bank is free, then takes tCAS cycles if its row is open, tRCD +
+ * tCAS if no row is open and tRP + tRCD + tCAS if another row is.  The row
+ * is left open.  Each cycle the scheduler gives every free bank a request
+ * first-ready first-come first-served: the oldest request for the open row,
+ * otherwise the oldest request, and a request that has waited too long goes
+ * before both so that row hits can't starve it.
+ *
+ * A ticket keeps the finish of its request in a slot until the request is
+ * finished.  Only then is the slot given to a later ticket, so a ticket that
+ * lost its slot is finished.
+ */
+
+//prototypes of functions only called within this file
+static void issueRequest(machineType * machine, dramRequestType * request);
+static unsigned int findBank(machineType * machine, unsigned int address, unsigned int * row);
+//end prototypes
+
+/* Function Name: validDram
+ * Purpose:       Checks that the shape of the DRAM can be simulated
+ *
+ * Parameters:    config - shape of the DRAM
+ * Returns:       TRUE if the banks and the row size are powers of two in range
+ *                and so are the timings
+ * Modifies:      -
+ */
+bool validDram(const dramConfigType * config)
+{
+    if(config->banks <= 0 || config->banks > MAXBANKS || (config->banks & (config->banks - 1)) != 0)
+        return FALSE;
+    if(config->rowSize < 16 || config->rowSize > MAXROWSIZE || (config->rowSize & (config->rowSize - 1)) != 0)
+        return FALSE;
+    return config->tCAS >= 1 && config->tCAS <= MAXDRAMTIMING && config->tRCD >= 1 &&
+           config->tRCD <= MAXDRAMTIMING && config->tRP >= 1 && config->tRP <= MAXDRAMTIMING;
+}
+
+/* Function Name: startDram
+ * Purpose:       Closes every row and empties the queue for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->dram
+ */
+void startDram(machineType * machine)
+{
+    memset(&machine->dram, 0, sizeof(machine->dram));
+}
+
+/* Function Name: dramTick
+ * Purpose:       Starts a clock cycle of the DRAM, issuing a waiting request
+ *                to each bank that is free
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       -
+ * Modifies:      machine->dram
+ */
+void dramTick(machineType * machine)
+{
+    dramType * dram = &machine->dram;
+    const dramConfigType * config = &machine->config.dram;
+    int chosen[MAXBANKS], priority[MAXBANKS];
+    unsigned int bank, row;
+    int i, kept = 0;
+
+    if(config->banks == 0) return;
+    dram->now++;
+    if(dram->queued == 0) return;
+
+    //the queue is oldest first, so the first request of a priority is the oldest
+    for(i = 0; i < config->banks; i++) chosen[i] = -1;
+    for(i = 0; i < dram->queued; i++){
+        bank = findBank(machine, dram->queue[i].address, &row);
+        if(dram->ready[bank] > dram->now) continue;
+
+        int rank = dram->open[bank] && dram->rows[bank] == row;
+        if(dram->now - dram->queue[i].arrival >= 4 * (unsigned long long) (config->tRP + config->tRCD + config->tCAS))
+            rank = 2;
+        if(chosen[bank] == -1 || rank > priority[bank]){
+            chosen[bank] = i;
+            priority[bank] = rank;
+        }
+    }
+
+    for(i = 0; i < dram->queued; i++){
+        bank = findBank(machine, dram->queue[i].address, &row);
+        if(chosen[bank] == i) issueRequest(machine, &dram->queue[i]);
+        else dram->queue[kept++] = dram->queue[i];
+    }
+    dram->queued = kept;
+}
+
+/* Function Name: dramRequest
+ * Purpose:       Sends a request to the DRAM
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the bytes
+ *                write - TRUE to write them
+ * Returns:       ticket to ask dramDone about
+ * Modifies:      machine->dram
+ */
+unsigned int dramRequest(machineType * machine, unsigned int address, bool write)
+{
+    dramType * dram = &machine->dram;
+    dramRequestType request;
+    unsigned int slot;
+    int i;
+
+    //the ticket takes the next slot whose request is finished, ticket 0 is never given out
+    for(i = 0; i < DRAMTICKETS; i++){
+        dram->tickets++;
+        if(dram->tickets == 0) dram->tickets++;
+        slot = dram->tickets & (DRAMTICKETS - 1);
+        if(dram->owners[slot] == 0 || (dram->finish[slot] != 0 && dram->finish[slot] <= dram->now)) break;
+    }
+    if(i == DRAMTICKETS){
+        fprintf(stderr, "More than %d DRAM requests are outstanding\n", DRAMTICKETS);
+        exit(1);
+    }
+    request.address = address;
+    request.ticket = dram->tickets;
+    request.arrival = dram->now;
+    request.write = write;
+    dram->owners[slot] = request.ticket;
+    dram->finish[slot] = 0;
+
+    //a full queue can't wait, the request is issued as if it went before them
+    if(dram->queued == DRAMQUEUE){
+        dram->full++;
+        issueRequest(machine, &request);
+    }else dram->queue[dram->queued++] = request;
+    return request.ticket;
+}
+
+/* Function Name: dramDone
+ * Purpose:       Checks whether a request is finished
+ *
+ * Parameters:    machine - machine being simulated
+ *                ticket - ticket dramRequest gave the request
+ * Returns:       TRUE if it finished by this cycle, FALSE otherwise
+ * Modifies:      -
+ */
+bool dramDone(machineType * machine, unsigned int ticket)
+{
+    unsigned int slot = ticket & (DRAMTICKETS - 1);
+    unsigned long long finish = machine->dram.finish[slot];
+
+    //a later ticket only gets the slot once the request is finished
+    if(machine->dram.owners[slot] != ticket) return TRUE;
+    return finish != 0 && finish <= machine->dram.now;
+}
+
+/* Function Name: reportDram
+ * Purpose:       Writes the counters of the DRAM, if the machine has one
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportDram(machineType * machine)
+{
+    dramType * dram = &machine->dram;
+    const dramConfigType * config = &machine->config.dram;
+    unsigned long long requests = dram->reads + dram->writes;
+
+    if(config->banks == 0) return;
+    fprintf(machine->out, "\nDRAM = %d banks %d byte rows tCAS = %d tRCD = %d tRP = %d\n", config->banks,
+            config->rowSize, config->tCAS, config->tRCD, config->tRP);
+    fprintf(machine->out, "Requests = %llu reads = %llu writes = %llu queue full = %llu\n", requests, dram->reads,
+            dram->writes, dram->full);
+    fprintf(machine->out, "Row hits = %llu empty = %llu conflicts = %llu row hit rate = %.2f%%\n", dram->hits,
+            dram->empty, dram->conflicts, requests == 0 ? 0.0 : 100.0 * dram->hits / requests);
+    fprintf(machine->out, "Average latency = %.2f cycles\n",
+            requests == 0 ? 0.0 : (double) dram->latency / requests);
+}
+
+/* Function Name: issueRequest
+ * Purpose:       Gives a request its bank, which is busy until it finishes
+ *
+ * Parameters:    machine - machine being simulated
+ *                request - the request
+ * Returns:       -
+ * Modifies:      machine->dram
+ */
+static void issueRequest(machineType * machine, dramRequestType * request)
+{
+    dramType * dram = &machine->dram;
+    const dramConfigType * config = &machine->config.dram;
+    unsigned int row, bank = findBank(machine, request->address, &row);
+    unsigned long long start = dram->ready[bank] > dram->now ? dram->ready[bank] : dram->now;
+    unsigned long long cycles = config->tCAS;
+
+    if(dram->open[bank] && dram->rows[bank] == row) dram->hits++;
+    else if(!dram->open[bank]){
+        dram->empty++;
+        cycles += config->tRCD;
+    }else{
+        dram->conflicts++;
+        cycles += config->tRP + config->tRCD;
+    }
+    dram->rows[bank] = row;
+    dram->open[bank] = TRUE;
+    dram->ready[bank] = start + cycles;
+    dram->finish[request->ticket & (DRAMTICKETS - 1)] = start + cycles;
+
+    if(request->write) dram->writes++;
+    else dram->reads++;
+    dram->latency += start + cycles - request->arrival;
+}
+
+/* Function Name: findBank
+ * Purpose:       Finds the bank and row of an address
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - the address
+ *                row - gets the row within the bank
+ * Returns:       the bank
+ * Modifies:      row
+ */
+static unsigned int findBank(machineType * machine, unsigned int address, unsigned int * row)
+{
+    unsigned int rows = address / machine->config.dram.rowSize;
+
+    *row = rows / machine->config.dram.banks;
+    return rows & (machine->config.dram.banks - 1);
+}
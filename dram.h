@@ -0,0 +1,56 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+//largest DRAM that can be asked for
+#define MAXBANKS 64
+#define MAXROWSIZE 65536
+#define MAXDRAMTIMING 200
+
+//requests waiting for their bank, and how many can be outstanding, waiting or issued
+#define DRAMQUEUE 64
+#define DRAMTICKETS 1024
+
+//shape and timing of the DRAM, kept with the rest of the configuration
+typedef struct
+{
+    int banks;                //0 for memory without DRAM timing
+    int rowSize;              //bytes of a row, consecutive rows are in consecutive banks
+    int tCAS;                 //cycles to read or write an open row
+    int tRCD;                 //cycles to open a row
+    int tRP;                  //cycles to close the open row
+} dramConfigType;
+
+//a request waiting for its bank
+typedef struct
+{
+    unsigned int address;
+    unsigned int ticket;
+    unsigned long long arrival;
+    bool write;
+} dramRequestType;
+
+//state of the DRAM of a machine
+typedef struct
+{
+    unsigned int rows[MAXBANKS];              //open row of each bank
+    bool open[MAXBANKS];
+    unsigned long long ready[MAXBANKS];       //cycle each bank finishes its request
+
+    dramRequestType queue[DRAMQUEUE];         //oldest first
+    int queued;
+    unsigned int owners[DRAMTICKETS];         //ticket whose request a slot holds, 0 for none
+    unsigned long long finish[DRAMTICKETS];   //cycle the request of a slot finishes, 0 until it is issued
+    unsigned int tickets;                     //last ticket given out
+    unsigned long long now;
+
+    unsigned long long reads, writes, hits, empty, conflicts, full, latency;
+} dramType;
+
+//prototypes
+bool validDram(const dramConfigType * config);
+void startDram(machineType * machine);
+void dramTick(machineType * machine);
+unsigned int dramRequest(machineType * machine, unsigned int address, bool write);
+bool dramDone(machineType * machine, unsigned int ticket);
+void reportDram(machineType * machine);
+#endif
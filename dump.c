@@ -1,62 +1,65 @@
-#include "bool.h"
 #include <stdio.h>
+#include "machine.h"
 #include "dump.h"
-#include "forwarding.h"
-#include "status.h"
-#include "bubbling.h"
-#include "fetchStage.h"
-#include "decodeStage.h"
-#include "executeStage.h"
-#include "memoryStage.h"
-#include "writebackStage.h"
-#include "registers.h"
-#include "memory.h"
+#include "tools.h"
 
 #define WORDSPERLINE 8
 #define LINELENGTH
 
 //prototypes of Functions only called within this file
-static void dumpLine(int line[WORDSPERLINE], int address);
-static void buildLine(int line[WORDSPERLINE], int address);
+static void dumpLine(machineType * machine, int line[WORDSPERLINE], unsigned int address);
+static void buildLine(machineType * machine, int line[WORDSPERLINE], unsigned int address);
 static int isEqual(int prevLine[WORDSPERLINE], int currLine[WORDSPERLINE]);
 static void copy(int *, int *);
 //end prototypes
 
+//a line of memory that was never written
+static int zeroLine[WORDSPERLINE];
+
 // Function: dumpMemory
 // Description: Outputs the contents of the YESS little-endian memory 
 //              WORDSPERLINE four-byte words per line.  A * is displayed 
 //              at the end of a line if each line in memory after that 
 //              up to the next ine displayed is identical to the * line.
-// Params: none
+//              Pages that were never written are all zeros, so once the
+//              * has been displayed for one the rest of it is skipped.
+// Params: machine - machine whose memory is displayed
 // Returns: none
 // Modifies: none
-void dumpMemory()
+void dumpMemory(machineType * machine)
 {
-    int address = 0;
+    unsigned int address = 0;
+    unsigned int memWords = (unsigned int)(getMemorySize(machine) / 4);
     int prevLine[WORDSPERLINE];
     int currLine[WORDSPERLINE];
     int star = 0;
-    buildLine(prevLine, address);
-    dumpLine(prevLine, address);
-    for (address=WORDSPERLINE; address < MEMSIZE; address+=WORDSPERLINE)
+    buildLine(machine, prevLine, address);
+    dumpLine(machine, prevLine, address);
+    for (address=WORDSPERLINE; address < memWords; address+=WORDSPERLINE)
     {
-       buildLine(currLine, address);    
+       if (star && isEqual(prevLine, zeroLine) && !isPageAllocated(machine, address * 4))
+       {
+          //skip to the last line of the untouched page
+          address |= (PAGEWORDS - 1) & ~(WORDSPERLINE - 1);
+          continue;
+       }
+       buildLine(machine, currLine, address);    
        if (isEqual(prevLine, currLine))
        {
           if (!star)
           {
-              printf("*\n");
+              fprintf(machine->out, "*\n");
               star = 1;
           }
        } else
        { 
-          printf("\n");
-          dumpLine(currLine, address);
+          fprintf(machine->out, "\n");
+          dumpLine(machine, currLine, address);
           star = 0;
        }
        copy(prevLine, currLine);
     }
-    printf("\n");
+    fprintf(machine->out, "\n");
 }
 
 // Function: copy
@@ -74,31 +77,34 @@ void copy(int pLine[WORDSPERLINE], int cLine[WORDSPERLINE])
 // Function: dumpLine
 // Description: This Function outputs the starting address in the variable
 //              address and the contents of the line array.
-// Params: line - array of ints to output
+// Params: machine - machine whose output stream is written
+//        line - array of ints to output
 //        address - row header
 // Returns: none
 // Modifies: none
-void dumpLine(int line[WORDSPERLINE], int address)
+void dumpLine(machineType * machine, int line[WORDSPERLINE], unsigned int address)
 {
     int i;
-    printf("%03x: ", address*4);
-    for (i = 0; i < WORDSPERLINE; i++) printf("%08x ", line[i]);
+    fprintf(machine->out, "%03x: ", address*4);
+    for (i = 0; i < WORDSPERLINE; i++) fprintf(machine->out, "%08x ", line[i]);
 }
 
 // Function: buildLine
 // Descripton: This Function accesses memory for WORDSPERLINE words and 
 //             sets the line array to the WORDSPERLINE
 //             words from memory.
-// Params: address - starting index to access memory
+// Params: machine - machine whose memory is accessed
+//         address - starting index to access memory
 // Returns: none
 // Modifies: line - array initialized to values in memory
-void buildLine(int line[WORDSPERLINE], int address)
+void buildLine(machineType * machine, int line[WORDSPERLINE], unsigned int address)
 {
     int i;
-    char byte0, byte1, byte2, byte3;
+    unsigned char bytes[WORDSPERLINE * 4];
     bool memError;
-    for (i = 0; i < WORDSPERLINE; i++, address++)
-        line[i] = getWord((address * 4), &memError);
+    copyOut(machine, (address * 4), bytes, sizeof(bytes), &memError);
+    for (i = 0; i < WORDSPERLINE; i++)
+        line[i] = buildWord(bytes[i*4], bytes[i*4+1], bytes[i*4+2], bytes[i*4+3]);
 }
 
 // Function: isEqual
@@ -118,44 +124,55 @@ int isEqual(int prevLine[WORDSPERLINE], int currLine[WORDSPERLINE])
 
 // Function: dumpProgramRegisters
 // Description: This Function outputs the contents of the YESS program registers
-//              to standard out.
-// Params: none
+//              to the machine output stream.
+// Params: machine - machine whose registers are displayed
 // Returns: none
 // Modifies: none
-void dumpProgramRegisters()
+void dumpProgramRegisters(machineType * machine)
 {
-    printf("%%eax: %08x %%ecx: %08x %%edx: %08x %%ebx: %08x\n",
-           getRegister(EAX), getRegister(ECX), getRegister(EDX), 
-           getRegister(EBX));
-    printf("%%esp: %08x %%ebp: %08x %%esi: %08x %%edi: %08x\n\n",
-           getRegister(ESP), getRegister(EBP), getRegister(ESI), 
-           getRegister(EDI));
+    fprintf(machine->out, "%%eax: %08x %%ecx: %08x %%edx: %08x %%ebx: %08x\n",
+           getRegister(machine, EAX), getRegister(machine, ECX), getRegister(machine, EDX), 
+           getRegister(machine, EBX));
+    fprintf(machine->out, "%%esp: %08x %%ebp: %08x %%esi: %08x %%edi: %08x\n\n",
+           getRegister(machine, ESP), getRegister(machine, EBP), getRegister(machine, ESI), 
+           getRegister(machine, EDI));
 }
 
 // Function: dumpProcessorRegisters
 // Description: This Function outputs the contents of the YESS 
-//              processor registers to standard out.
-// Params: none
+//              processor registers to the machine output stream.
+// Params: machine - machine whose registers are displayed
 // Returns: none
 // Modifies: none
-void dumpProcessorRegisters()
+void dumpProcessorRegisters(machineType * machine)
 {
-    fregister F = getFregister();
-    dregister D = getDregister();
-    eregister E = getEregister();
-    mregister M = getMregister();
-    wregister W = getWregister();
+    fregister F = getFregister(machine);
+    dregister D = getDregister(machine);
+    eregister E = getEregister(machine);
+    mregister M = getMregister(machine);
+    wregister W = getWregister(machine);
 
-    printf("CC - ZF: %01x SF: %01x OF: %01x\n", getCC(ZF), getCC(SF), getCC(OF)); 
-    printf("F - predPC: %08x\n", F.predPC);
-    printf("D - stat: %01x icode: %01x ifun: %01x rA: %01x rB: %01x valC: %08x  valP: %08x\n",
+    dumpConditionCodes(machine);
+    fprintf(machine->out, "F - predPC: %08x\n", F.predPC);
+    fprintf(machine->out, "D - stat: %01x icode: %01x ifun: %01x rA: %01x rB: %01x valC: %08x  valP: %08x\n",
             D.stat, D.icode, D.ifun, D.rA, D.rB, D.valC, D.valP);
-    printf("E - stat: %01x icode: %01x  ifun: %01x  valC: %08x valA: %08x valB: %08x\n",
+    fprintf(machine->out, "E - stat: %01x icode: %01x  ifun: %01x  valC: %08x valA: %08x valB: %08x\n",
             E.stat, E.icode, E.ifun, E.valC, E.valA, E.valB);
-    printf("    dstE: %01x dstM: %01x srcA: %01x srcB: %01x\n",
+    fprintf(machine->out, "    dstE: %01x dstM: %01x srcA: %01x srcB: %01x\n",
             E.dstE, E.dstM, E.srcA, E.srcB);
-    printf("M - stat: %01x icode: %01x Cnd: %01x valE: %08x valA: %08x dstE: %01x dstM: %01x\n",
+    fprintf(machine->out, "M - stat: %01x icode: %01x Cnd: %01x valE: %08x valA: %08x dstE: %01x dstM: %01x\n",
             M.stat, M.icode, M.Cnd, M.valE, M.valA, M.dstE, M.dstM);
-    printf("W - stat: %01x icode: %01x valE: %08x valM: %08x dstE: %01x dstM: %01x\n\n",
+    fprintf(machine->out, "W - stat: %01x icode: %01x valE: %08x valM: %08x dstE: %01x dstM: %01x\n\n",
             W.stat, W.icode, W.valE, W.valM, W.dstE, W.dstM);
 }
+
+// Function: dumpConditionCodes
+// Description: This Function outputs the contents of the YESS
+//              condition codes to the machine output stream.
+// Params: machine - machine whose condition codes are displayed
+// Returns: none
+// Modifies: none
+void dumpConditionCodes(machineType * machine)
+{
+    fprintf(machine->out, "CC - ZF: %01x SF: %01x OF: %01x\n", getCC(machine, ZF), getCC(machine, SF), getCC(machine, OF)); 
+}
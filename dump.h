@@ -1,7 +1,8 @@
 
 #ifndef DUMP_H
 #define DUMP_H
-void dumpMemory();
-void dumpProgramRegisters();
-void dumpProcessorRegisters();
+void dumpMemory(machineType * machine);
+void dumpProgramRegisters(machineType * machine);
+void dumpProcessorRegisters(machineType * machine);
+void dumpConditionCodes(machineType * machine);
 #endif
@@ -1,33 +1,29 @@
-#include "bool.h"
-#include "forwarding.h"
-#include "status.h"
-#include "bubbling.h"
-#include "executeStage.h"
+#include "machine.h"
 #include "tools.h"
 #include "instructions.h"
-#include "memoryStage.h"
-#include "registers.h"
+#include "opcodes.h"
 
 //prototypes
-bool calcECnd();
-bool M_bubble(statusType status);
-bool calcMCnd();
-bool set_cc(statusType status);
+bool calcECnd(machineType * machine);
+bool M_bubble(machineType * machine, signalType * signals);
+bool calcMCnd(machineType * machine);
+bool set_cc(machineType * machine, signalType * signals);
+bool laterException(machineType * machine, signalType * signals);
+bool dumpAhead(machineType * machine);
 
 //prototypes for functions involving the function pointer array
-unsigned int (*functions[16])(bool status);
-unsigned int performOpl(bool status);
-unsigned int performIrmovl(bool status);
-unsigned int performCmovl(bool status);
-unsigned int performRmmovl(bool status);
-unsigned int performMrmovl(bool status);
-unsigned int performPushl(bool status);
-unsigned int performPopl(bool status);
-unsigned int seteDstE(bool e_cnd);
-unsigned int performCall(bool);
-unsigned int performRet(bool status);
-unsigned int returnZero(bool status);
-unsigned int dump(bool status);
+unsigned int performOpl(machineType * machine, bool status);
+unsigned int performIrmovl(machineType * machine, bool status);
+unsigned int performCmovl(machineType * machine, bool status);
+unsigned int performRmmovl(machineType * machine, bool status);
+unsigned int performMrmovl(machineType * machine, bool status);
+unsigned int performPushl(machineType * machine, bool status);
+unsigned int performPopl(machineType * machine, bool status);
+unsigned int seteDstE(machineType * machine, bool e_cnd);
+unsigned int performCall(machineType * machine, bool);
+unsigned int performRet(machineType * machine, bool status);
+unsigned int returnZero(machineType * machine, bool status);
+unsigned int dump(machineType * machine, bool status);
 
 /*-----------------NOTE-----------------------
  * If the execute stage doesn't do anything
@@ -37,267 +33,282 @@ unsigned int dump(bool status);
  * returnZero function.
  * ------------------------------------------*/
 
-
-
-//E register holds the input for the execute stage
-//It is only accessible from this file. (static)
-static eregister E;
+//the function pointer array, indexed by icode
+//It never changes, so it is shared by every machine
+static unsigned int (* const functions[16])(machineType * machine, bool status) =
+{
+    [IHALT] = returnZero,
+    [INOP] = returnZero,
+    [ICMOVXX] = performCmovl,
+    [IIRMOVL] = performIrmovl,
+    [IRMMOVL] = performRmmovl,
+    [IMRMOVL] = performMrmovl,
+    [IOPL] = performOpl,
+    [IJXX] = returnZero,
+    [ICALL] = performCall,
+    [IRET] = performRet,
+    [IPUSHL] = performPushl,
+    [IPOPL] = performPopl,
+    [IDUMP] = dump,
+    [0xD] = returnZero,
+    [0xE] = returnZero,
+    [0xF] = returnZero
+};
+
+//A machine's E register holds the input for the execute stage
+//It is only accessed from this file, the stage reads cur->E and writes next->M[0].
 
 /* Function Name: executeStage
  * Purpose:       performs execution of instruction
  *                and detects mispredicted branches
  *
- * Parameters:    status    - status of memory stage and writeback register
- *                forwarded - pointer to a struct used for forwarding
- *                bubble    - pointer to a struct used for bubbling/stalling
+ * Parameters:    machine   - machine being simulated
+ *                signals   - values computed by the later stages this clock
+ *                            cycle, gets the values of this stage
  * Returns:       -
- * Modifies:      M Register
- *                forwarded->e_valE
- *                forwarded->e_dstE
- *                bubble->e_Cnd
- *                bubble->E_icode
- *                bubble->E_dstM
+ * Modifies:      next M Register
+ *                signals->e_valE
+ *                signals->e_dstE
+ *                signals->e_Cnd
+ *                signals->e_busy
  */
-void executeStage(statusType status, forwardType *forwarded, bubbleType *bubble)
+void executeStage(machineType * machine, signalType * signals)
 {
+    eregister * E = &machine->cur->E;
+
+    //the instruction stays in the execute stage while the memory stages wait or
+    //while an OPL hasn't had aluLatency cycles or would change the condition codes
+    //a dump ahead of it shows, an instruction after a mispredicted ret is squashed instead
+    signals->e_busy = signals->m_busy || (E->icode == IOPL && !signals->m_retMiss &&
+                      (E->cycles + 1 < machine->config.aluLatency || dumpAhead(machine)));
+    if(signals->e_busy){
+        signals->e_dstE = RNONE;
+        signals->e_Cnd = FALSE;
+        if(!signals->m_busy){
+            updateMregister(machine, 0, SAOK, INOP, 0, 0, 0, RNONE, RNONE, NOPC, FALSE, 0, 0);
+            countBubble(machine, STAGEM, CAUSEEXECUTE);
+            TRACEPOINT(TPBUBBLE, machine, NOPC, STAGEM, CAUSEEXECUTE);
+        }
+        return;
+    }
+
     //determines whether the condition codes should be set or not
-    bool setcc = set_cc(status);
+    bool setcc = set_cc(machine, signals);
 
     //calculates the condition code used by the execute stage that determines whether or not
     //a conditional move should be taken
-    bool e_cnd = calcECnd();
+    bool e_cnd = calcECnd(machine);
 
     //calculates the value of e_valE based on the icode
-    unsigned int e_valE = (*functions[E.icode])(setcc);
+    unsigned int e_valE = (*functions[E->icode])(machine, setcc);
 
     //calculates the e_dstE register
-    unsigned int e_dstE = seteDstE(e_cnd);
-
-    //update forwarded struct
-    forwarded->e_valE = e_valE;
-    forwarded->e_dstE = e_dstE;
+    unsigned int e_dstE = seteDstE(machine, e_cnd);
 
     //calculates the condition code used by the memory stage that determines whether or not
     //a conditional jump should be taken
-    bool M_cnd = calcMCnd();
+    bool M_cnd = calcMCnd(machine);
 
-    //update bubble struct
-    bubble->e_Cnd = M_cnd;
-    bubble->E_icode = E.icode;
-    bubble->E_dstM = E.dstM;
+    //update the signals used for forwarding and bubbling
+    signals->e_valE = e_valE;
+    signals->e_dstE = e_dstE;
+    signals->e_Cnd = M_cnd;
+
+    //tell the predictor what a conditional jump did
+    if(E->icode == IJXX && E->ifun != JMP && E->stat == SAOK && !signals->m_retMiss)
+        resolveBranch(machine, E->pc, E->predTaken, M_cnd);
     
+    //a predicted ret carries the address fetch went on at in valC, and the condition
+    //codes to put back if the instructions fetched after it are squashed
+    unsigned int cc = (E->icode == IRET && E->predTaken) ? getFlags(machine) : 0;
+
     //check if bubbling is needed and update the M register accordingly
-    if(M_bubble(status)) updateMregister(SAOK, INOP, 0, 0, 0, RNONE, RNONE);
-    else updateMregister(E.stat, E.icode, M_cnd, e_valE, E.valA, e_dstE, E.dstM);
+    if(M_bubble(machine, signals)){
+        updateMregister(machine, 0, SAOK, INOP, 0, 0, 0, RNONE, RNONE, NOPC, FALSE, 0, 0);
+        countBubble(machine, STAGEM, signals->m_retMiss ? CAUSERETMISS : CAUSEEXCEPTION);
+        TRACEPOINT(TPBUBBLE, machine, NOPC, STAGEM, signals->m_retMiss ? CAUSERETMISS : CAUSEEXCEPTION);
+    }
+    else{
+        updateMregister(machine, 0, E->stat, E->icode, M_cnd, e_valE, E->valA, e_dstE, E->dstM, E->pc,
+                        E->predTaken, E->valC, cc);
+        machine->next->M[0].checkpoint = E->checkpoint;
+    }
 }
 
 /* Function Name: set_cc
  * Purpose:       Determines if an IOPL instruction should set condition codes
  *
- * Parameters:    status - status of memory stage and writeback stage
- * Returns:       TRUE if the instruction is an OPL and the status in the memory and writeback
- *                stages are SAOK
+ * Parameters:    machine - machine being simulated
+ *                signals - holds the status of the memory stage
+ * Returns:       TRUE if the instruction is an OPL, the status in the memory and writeback
+ *                stages are SAOK and the ret in the memory stage, if any, wasn't mispredicted
  * Modifies:      -
  */
-bool set_cc(statusType status){
-    if(E.icode == IOPL && status.m_stat == SAOK && status.W_stat == SAOK) return TRUE;
+bool set_cc(machineType * machine, signalType * signals){
+    if(machine->cur->E.icode == IOPL && !laterException(machine, signals) && !signals->m_retMiss) return TRUE;
     else return FALSE;
 }
 
-/* Function Name: calcMCnd
- * Purpose:       sets the conditional flags
+/* Function Name: dumpAhead
+ * Purpose:       Determines if an OPL has to wait for a dump in a memory stage.  A dump
+ *                shows the condition codes when it reaches the writeback stage, with more
+ *                than one memory stage the OPLs after it would have set them by then.
+ *                The five stage pipeline keeps its timing, the instruction right after
+ *                a dump may set the condition codes it shows.
  *
- * Parameters:    -
- * Returns:       whether or not any of the condition codes
- * 				  were set to true
+ * Parameters:    machine - machine being simulated
+ * Returns:       TRUE if there is more than one memory stage and a dump is in one of them
  * Modifies:      -
  */
-bool calcMCnd(){
-    if(E.icode != IJXX) return 0;
-
-    //grab the condition codes
-    unsigned int oF = getCC(OF);
-    unsigned int sF = getCC(SF);
-    unsigned int zF = getCC(ZF);
+bool dumpAhead(machineType * machine){
+    int i;
 
-    //determine the kind of jump
-    switch(E.ifun){
-        case JMP: //unconditional jump
-            return 1;
-
-        case JLE: //jump if less than or equal to
-            if((sF ^ oF) || zF) return 1;
-            else return 0;
-
-        case JL: //jump if less than
-            if(sF^oF) return 1;
-            else return 0;
-
-        case JE: //jump if equal to
-            if(zF) return 1;
-            else return 0;
+    if(machine->config.memoryStages == 1) return FALSE;
+    for(i = 0; i < machine->config.memoryStages; i++)
+        if(machine->cur->M[i].icode == IDUMP) return TRUE;
+    return FALSE;
+}
 
-        case JNE: //jump if not equal to
-            if(!zF) return 1;
-            else return 0;
+/* Function Name: laterException
+ * Purpose:       Determines if an instruction in a memory stage or the writeback stage
+ *                stops the program, so the instructions after it mustn't change anything
+ *
+ * Parameters:    machine - machine being simulated
+ *                signals - holds the status of the last memory stage
+ * Returns:       TRUE if the status of a memory or writeback stage isn't SAOK
+ * Modifies:      -
+ */
+bool laterException(machineType * machine, signalType * signals){
+    int i;
 
-        case JGE: //jump if greater than or equal to
-            if(!(sF ^ oF)) return 1;
-            else return 0;
+    if(signals->m_stat != SAOK || machine->cur->W.stat != SAOK) return TRUE;
+    for(i = 0; i < machine->config.memoryStages - 1; i++)
+        if(machine->cur->M[i].stat != SAOK) return TRUE;
+    return FALSE;
+}
 
-        case JG: //jump if greater than
-            if(!(sF^oF) && !zF) return 1;
-            else return 0;
+/* Function Name: calcMCnd
+ * Purpose:       sets the conditional flags
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       whether or not any of the condition codes
+ * 				  were set to true
+ * Modifies:      -
+ */
+bool calcMCnd(machineType * machine){
+    if(machine->cur->E.icode != IJXX) return 0;
+    return testCondition(machine, machine->cur->E.ifun);
+}
 
-        default: //otherwise
-            return 0;
-    }
+/* Function Name: testCondition
+ * Purpose:       Tests the condition codes against the condition of a jump
+ *                or conditional move
+ *
+ * Parameters:    machine - machine being simulated
+ *                ifun - function code of the jump or move
+ * Returns:       TRUE if the jump or move should be taken, FALSE otherwise
+ * Modifies:      CC, if the flags of the last opl weren't worked out yet
+ */
+bool testCondition(machineType * machine, unsigned int ifun){
+    //the condition table is indexed by the function code, the function codes are the same
+    //for jumps and moves
+    return CONDITION(ifun, getFlags(machine));
 }
 
 /* Function Name: calcECnd
  * Purpose:       Calculates whether or not a conditional move should be taken
  *
- * Parameters:    -
+ * Parameters:    machine - machine being simulated
  * Returns:       TRUE if the conditional move should be taken, FALSE otherwise
  * Modifies:      -
  */
-bool calcECnd()
+bool calcECnd(machineType * machine)
 {
-	if(E.icode != ICMOVXX || E.icode != IRRMOVL){
+	if(machine->cur->E.icode != ICMOVXX || machine->cur->E.icode != IRRMOVL){
         return 0;
     }
-
-	//grab the condition codes
-    unsigned int oF = getCC(OF);
-    unsigned int sF = getCC(SF);
-    unsigned int zF = getCC(ZF);
-
-    //determine the kind of move
-    switch(E.ifun){
-        case RRMOVL: //"unconditional" move
-            return 1;
-
-        case CMOVLE: //move if less than or equal to
-            if((sF ^ oF) || zF) return 1;
-            else return 0;
-
-        case CMOVL: //move if less than
-            if(sF ^ oF) return 1;
-            else return 0;
-        case CMOVE: //move if equal to
-            if(zF) return 1;
-            else return 0;
-
-        case CMOVNE: //move if not equal to
-            if(!zF) return 1;
-            else return 0;
-
-        case CMOVGE: //move if greater than or equal to
-            if(!(sF ^ oF)) return 1;
-            else return 0;
-
-        case CMOVG: //move if greater than
-            if((!(sF^oF))&&(!zF)) return 1;
-            else return 0;
-    }
+    return testCondition(machine, machine->cur->E.ifun);
 }
 
 /* Function Name: M_bubble
  * Purpose:       Determines whether or not the M pipeline register should be bubbled
  *
- * Parameters:    status - struct with status information from the memory and writeback stages
+ * Parameters:    machine - machine being simulated
+ *                signals - holds the status of the memory stage
  * Returns:       bool to determine whether the M register should be bubbled
  * Modifies       -
  */
-bool M_bubble(statusType status){
-    if(status.m_stat != SAOK || status.W_stat != SAOK) return TRUE;
+bool M_bubble(machineType * machine, signalType * signals){
+    if(laterException(machine, signals) || signals->m_retMiss) return TRUE;
     return FALSE;
 }
 
 /* Function Name: getEregister
  * Purpose:       Returns a copy of the E register
  * 
- * Parameters:    none
+ * Parameters:    machine - machine being simulated
  * Returns:       e register
  * Modifies:      none
  */
-eregister getEregister(){
-    return E;
+eregister getEregister(machineType * machine){
+    return machine->cur->E;
 }
 
 /* Function Name: clearEregister
  * Purpose:       Clears the E register
  *
- * Parameters:    none
+ * Parameters:    machine - machine being simulated
  * Returns:       none
  * Modifies:      E
  */
-void clearEregister(){
-    clearBuffer((char *) &E, sizeof(E));
-    E.stat = SAOK;
-    E.icode = INOP;
+void clearEregister(machineType * machine){
+    clearBuffer((char *) &machine->cur->E, sizeof(machine->cur->E));
+    machine->cur->E.stat = SAOK;
+    machine->cur->E.icode = INOP;
+    machine->cur->E.pc = NOPC;
 }
 
 /* Function Name: seteDstE
  * Purpose:       sets the destination register
  *
- * Parameters:    condition codes set in this stage
+ * Parameters:    machine - machine being simulated
+ *                condition codes set in this stage
  * Returns:       the destination register
  * Modifies:      -
  */
-unsigned int seteDstE(bool e_cnd)
+unsigned int seteDstE(machineType * machine, bool e_cnd)
 {   
-    if((E.icode == IRRMOVL) && !e_cnd) return RNONE;
-	else return E.dstE;
-}
-
-/* Function Name: initializeFuncPtrArray()
- * Purpose:       initializes the array of function pointers
- *
- * Parameters:    none
- * Returns:       none
- * Modifies:      E
- */
-void initializeFuncPtrArray()
-{
-	//fill the function pointer array with returnZero()
-    int i = 0;
-    for(i; i < 16; i++) functions[i] = returnZero;
-
-    //put the functions in their respective places
-    functions[IDUMP] = dump;
-    functions[IOPL] = performOpl;
-    functions[IIRMOVL] = performIrmovl;
-    functions[ICMOVXX] = performCmovl;
-    functions[IRMMOVL] = performRmmovl;
-    functions[IMRMOVL] = performMrmovl;
-    functions[IPUSHL] = performPushl;
-    functions[IPOPL] = performPopl;
-    functions[ICALL] = performCall;
-    functions[IRET] = performRet;
+    if((machine->cur->E.icode == IRRMOVL) && !e_cnd) return RNONE;
+	else return machine->cur->E.dstE;
 }
 
 /* Function Name: updateEregister
  * Purpose:       Passes values from d stage to E register
  *
  * Returns:       -
- * Parameters:    All parameters are the corresponding fields to the E register
- * Modifies:      ALl of the E register
+ * Parameters:    machine - machine being simulated
+ *                All parameters are the corresponding fields to the E register
+ * Modifies:      ALl of the next E register
  */
-void updateEregister(unsigned int stat, unsigned int icode, unsigned int ifun,
+void updateEregister(machineType * machine, unsigned int stat, unsigned int icode, unsigned int ifun,
     unsigned int valC, unsigned int valA, unsigned int valB, unsigned int dstE,
-    unsigned int dstM, unsigned int srcA, unsigned int srcB)
+    unsigned int dstM, unsigned int srcA, unsigned int srcB, unsigned int pc, unsigned int predTaken)
 {
-    E.stat = stat;
-    E.icode = icode;
-    E.ifun = ifun;
-    E.valC = valC;
-    E.valA = valA;
-    E.valB = valB;
-    E.dstE = dstE;
-    E.dstM = dstM;
-    E.srcA = srcA;
-    E.srcB = srcB;
+    eregister * E = &machine->next->E;
+
+    E->stat = stat;
+    E->icode = icode;
+    E->ifun = ifun;
+    E->valC = valC;
+    E->valA = valA;
+    E->valB = valB;
+    E->dstE = dstE;
+    E->dstM = dstM;
+    E->srcA = srcA;
+    E->srcB = srcB;
+    E->pc = pc;
+    E->predTaken = predTaken;
+    E->cycles = 0;
 }
 
 //****************************************
@@ -308,45 +319,38 @@ void updateEregister(unsigned int stat, unsigned int icode, unsigned int ifun,
  * Purpose:       executes the designated operation if it's an an opl code
  *
  * Returns:       result of add, subtract, and, or xor of E.valA and E.valB
- * Parameters:    None
+ * Parameters:    machine - machine being simulated
  * Modifies:      Condition codes when appropriate
  */
-unsigned int performOpl(bool status)
+unsigned int performOpl(machineType * machine, bool status)
 {
-    int aluA = E.valA;
-    int aluB = E.valB;
-    int ret;
+    if(!status) return machine->cur->E.valA + machine->cur->E.valB;
+    return alu(machine, machine->cur->E.ifun, machine->cur->E.valA, machine->cur->E.valB);
+}
 
-    if(!status) return aluA+aluB;
+/* Function Name: alu
+ * Purpose:       performs an opl operation and records it for the condition codes
+ *
+ * Returns:       result of add, subtract, and, or xor of aluA and aluB
+ * Parameters:    machine - machine being simulated
+ *                ifun - function code of the operation
+ *                aluA, aluB - operands, aluA is subtracted from aluB
+ * Modifies:      lazy condition codes
+ */
+unsigned int alu(machineType * machine, unsigned int ifun, int aluA, int aluB)
+{
+    unsigned int ret = 0;
 
-	//Perform calculations and check for overflow.
-	//Check for zero result and negative result later.
-	switch(E.ifun)
+	//Perform the calculation, the condition codes are only worked out from
+	//the operands and result if a later instruction reads them
+	switch(ifun)
 	{
 		case ADDL: //addition
-			ret = aluA + aluB;
-
-			//positive overflow
-			if(ret <= 0 && aluA > 0 && aluB > 0) setCC(OF, 1);
-
-			//negative overflow
-			else if(ret >= 0 && aluA < 0 && aluB < 0) setCC(OF, 1);
-
-			//no overflow
-			else setCC(OF, 0);
+			ret = (unsigned int) aluA + aluB;
             break;
 
 		case SUBL: //subtraction
-			ret = aluB - aluA;
-
-			//positive overflow
-			if(ret <= 0 && aluA < 0 && aluB > 0) setCC(OF, 1);
-
-			//negative overflow
-			else if(ret >= 0 && aluA > 0 && aluB < 0) setCC(OF, 1);
-
-			//no overflow
-			else setCC(OF, 0);
+			ret = (unsigned int) aluB - aluA;
             break;
 
 		case ANDL: //bitwise and
@@ -358,63 +362,56 @@ unsigned int performOpl(bool status)
             break;
 	}
 
-	//Check for a result of 0.
-	if(ret == 0) setCC(ZF, 1);
-	else setCC(ZF, 0);
-
-	//Check for a negative result.
-	if(ret < 0) setCC(SF, 1);
-	else setCC(SF, 0);
-
+    recordOpl(machine, ifun, aluA, aluB, ret);
 	return ret;
 }
 
 //returns E.valC to move an immediate into a register
-unsigned int performIrmovl(bool status){
-	return E.valC;
+unsigned int performIrmovl(machineType * machine, bool status){
+	return machine->cur->E.valC;
 }
 
 //returns E.valA to conditionally move based on registers
-unsigned int performCmovl(bool status){
-	return E.valA;
+unsigned int performCmovl(machineType * machine, bool status){
+	return machine->cur->E.valA;
 }
 //returns E.valB + E.valC to move from a register to memory
-unsigned int performRmmovl(bool status){
-    return E.valB + E.valC;
+unsigned int performRmmovl(machineType * machine, bool status){
+    return machine->cur->E.valB + machine->cur->E.valC;
 }
 
 //returns E.valB + E.valC to move from memory to register
-unsigned int performMrmovl(bool status){
-    return E.valB + E.valC;
+unsigned int performMrmovl(machineType * machine, bool status){
+    return machine->cur->E.valB + machine->cur->E.valC;
 }
 
 //decrements the stack pointer by 4 to push a value
-unsigned int performPushl(bool status){
-	return E.valB - 4;
+unsigned int performPushl(machineType * machine, bool status){
+	return machine->cur->E.valB - 4;
 }
 
 //increments the stack pointer by 4 to push a value
-unsigned int performPopl(bool status){
-	return E.valB + 4;
+unsigned int performPopl(machineType * machine, bool status){
+	return machine->cur->E.valB + 4;
 }
 
 //filler function
-unsigned int returnZero(bool status){
+unsigned int returnZero(machineType * machine, bool status){
 	return 0;
 }
 
 //performs a memory dump
-unsigned int dump(bool status){
-	return E.valC;
+unsigned int dump(machineType * machine, bool status){
+	return machine->cur->E.valC;
 }
 
 //performs a call to a function in the assembly
-unsigned int performCall(bool status){
-    return E.valB - 4;
+unsigned int performCall(machineType * machine, bool status){
+    return machine->cur->E.valB - 4;
 }
 
 //performs a return from a call
-unsigned int performRet(bool status){
-    return E.valB + 4;
+unsigned int performRet(machineType * machine, bool status){
+    return machine->cur->E.valB + 4;
 }
 
@@ -4,24 +4,29 @@
 //struct representing the E pipeline register
 typedef struct
 {
-    unsigned int stat;
-    unsigned int icode;
-    unsigned int ifun;
     unsigned int valC;
     unsigned int valA;
     unsigned int valB;
-    unsigned int dstE;
-    unsigned int dstM;
-    unsigned int srcA;
-    unsigned int srcB;
+    unsigned int pc;
+    unsigned char stat;
+    unsigned char icode;
+    unsigned char ifun;
+    unsigned char dstE;
+    unsigned char dstM;
+    unsigned char srcA;
+    unsigned char srcB;
+    unsigned char predTaken;
+    unsigned char cycles;     //cycles spent in the execute stage
+    predictorCheckpointType checkpoint; //predictor after it was fetched
 } eregister;
 
 //prototypes for functions called from files other than executeStage
-eregister getEregister();
-void clearEregister();
-void updateEregister(unsigned int stat, unsigned int icode, unsigned int ifun,
+eregister getEregister(machineType * machine);
+void clearEregister(machineType * machine);
+void updateEregister(machineType * machine, unsigned int stat, unsigned int icode, unsigned int ifun,
     unsigned int valC, unsigned int valA, unsigned int valB, unsigned int dstE,
-    unsigned int dstM, unsigned int srcA, unsigned int srcB);
-void initializeFuncPtrArray();
-void executeStage(statusType status, forwardType *forwarded, bubbleType *bubble);
+    unsigned int dstM, unsigned int srcA, unsigned int srcB, unsigned int pc, unsigned int predTaken);
+void executeStage(machineType * machine, signalType * signals);
+bool testCondition(machineType * machine, unsigned int ifun);
+unsigned int alu(machineType * machine, unsigned int ifun, int aluA, int aluB);
 #endif
@@ -1,349 +1,359 @@
-#include "bool.h"
-#include "forwarding.h"
-#include "bubbling.h"
-#include "fetchStage.h"
-#include "decodeStage.h"
+#include <stdio.h>
+#include "machine.h"
 #include "tools.h"
 #include "instructions.h"
-#include "registers.h"
+#include "opcodes.h"
 
-//F register holds the input for the fetch stage. 
-//It is only accessible from this file. (static)
-static fregister F;
+//A machine's F register holds the input for the fetch stage. 
+//It is only accessed from this file, the stage reads cur->F and writes next->F and next->D.
 
 //prototypes
-bool needs_regids(unsigned int icode);
-bool needs_valc(unsigned int icode);
-unsigned int getValC(unsigned int f_pc, bool *memError);
-unsigned int checkIcode(unsigned int icode);
-bool F_stall(bubbleType bubble);
-bool D_stall(bubbleType bubble);
-bool D_bubble(bubbleType bubble);
-unsigned int predictPC(unsigned int f_pc, unsigned int icode);
-unsigned int selectPC(forwardType forwarded);
+unsigned int getValC(machineType * machine, unsigned int f_pc, bool *memError);
+bool F_stall(machineType * machine, signalType * signals);
+bool D_stall(machineType * machine, signalType * signals);
+bool D_bubble(machineType * machine, signalType * signals);
+unsigned int selectPC(machineType * machine, signalType * signals, bool * redirect);
+bool waitForRet(machineType * machine);
+void repairPredictor(machineType * machine, signalType * signals);
 
 
 /* Function Name: fetchStage
  * Purpose:       Handles the Fetch stage of the pipelined machine.  Fetches an instruction and
  *                sets initial values for later stages to use.  Also increments the PC.
- * Parameters:    forwarded - struct containing values used for forwarding
- *                bubble - struct containing values used for bubbling/stalling
+ * Parameters:    machine - machine being simulated
+ *                signals - values of the later stages used for stalling and bubbling
  * Returns:       None
- * Modifies:      F.predPC
+ * Modifies:      next F and D registers
  */
-void fetchStage(forwardType forwarded, bubbleType bubble)
+void fetchStage(machineType * machine, signalType * signals)
 {
-	//F register only variables
-	unsigned int icode;
-	unsigned int ifun;
-	unsigned int f_stat;
-	unsigned int rA = RNONE;
-	unsigned int rB = RNONE;
-	unsigned int valC = 0;
-	unsigned int valP;
+    //the calls, rets and jumps fetched after a mispredicted jump or ret are taken off the
+    //return address stack and the perfect predictor before anything on the right path is fetched
+    repairPredictor(machine, signals);
+
+    //address of next instruction
+    bool redirect;
+    unsigned int f_pc = selectPC(machine, signals, &redirect);
+
+    bool stall = D_stall(machine, signals);
+    bool bubble = D_bubble(machine, signals);
+
+    //fetching down the predicted path is pipelined, but the instruction at a new address
+    //goes through every fetch stage before it reaches decode
+    unsigned int delay = redirect ? (unsigned int) machine->config.fetchStages - 1 : machine->cur->F.delay;
+
+    //a stalled F register keeps a new address to fetch once the stall is over, one that
+    //missed in the instruction cache also waits for the DRAM
+    bool fstall = F_stall(machine, signals);
+    bool waiting = !redirect && machine->cur->F.cached && !fetchReady(machine);
+    if(fstall || delay > 0 || waiting){
+        if(!fstall && delay > 0) delay--;
+        machine->next->F.predPC = f_pc;
+        machine->next->F.delay = delay;
+        machine->next->F.cached = redirect ? FALSE : machine->cur->F.cached;
+        int cause = fstall ? stallCause(signals) : CAUSEFETCH;
+        countStall(machine, STAGEF, cause);
+        if(stall){
+            machine->next->D = machine->cur->D;
+            countStall(machine, STAGED, stallCause(signals));
+        }else{
+            updateDregister(machine, SAOK, INOP, 0, RNONE, RNONE, 0, 0, NOPC, FALSE);
+            countBubble(machine, STAGED, bubble ? bubbleCause(machine, signals) : cause);
+            TRACEPOINT(TPBUBBLE, machine, NOPC, STAGED, bubble ? bubbleCause(machine, signals) : cause);
+        }
+        return;
+    }
+
+    //the decoded instruction, only decoded again if it isn't in the predecode cache
+    predecodeType * inst = lookupPredecode(machine, f_pc);
+    if(inst == NULL) inst = decodeInstruction(machine, f_pc);
+
+    //an instruction that misses in the instruction cache reaches decode the cycles the
+    //cache adds later, it isn't looked up again when it is fetched then
+    if(!stall && !bubble && inst->stat != SADR && (redirect || !machine->cur->F.cached)){
+        reuseFetch(machine, f_pc, inst->valP - f_pc);
+        unsigned int wait = fetchDelay(machine, f_pc, inst->valP - f_pc);
+        if(wait > 0 || !fetchReady(machine)){
+            machine->next->F.predPC = f_pc;
+            machine->next->F.delay = wait > 0 ? wait - 1 : 0;
+            machine->next->F.cached = TRUE;
+            updateDregister(machine, SAOK, INOP, 0, RNONE, RNONE, 0, 0, NOPC, FALSE);
+            countStall(machine, STAGEF, CAUSEFETCH);
+            countBubble(machine, STAGED, CAUSEFETCH);
+            TRACEPOINT(TPBUBBLE, machine, NOPC, STAGED, CAUSEFETCH);
+            return;
+        }
+    }
+
+    //calls and jumps go on at valC, the predictor is only asked about conditional
+    //jumps that go on to the decode stage
+    bool predTaken = opcodeTable[OPCODE(inst->icode, inst->ifun)].predValC;
+    bool enters = inst->stat == SAOK && !stall && !bubble;
+    if(inst->icode == IJXX && inst->ifun != JMP && enters)
+        predTaken = predictBranch(machine, f_pc, inst->valC);
+
+    //with a return address stack a call pushes its return address and a ret goes
+    //on at the popped address, carried in valC, which ret doesn't otherwise use.
+    //Nothing fetched after a halt or an error changes the stack
+    unsigned int valC = inst->valC;
+    returnStackType * returns = &machine->predictor.returns;
+    if(machine->config.rasDepth > 0 && !stall && !bubble){
+        if(inst->stat != SAOK) returns->stopped = TRUE;
+        else if(!returns->stopped && inst->icode == ICALL) pushReturn(machine, inst->valP);
+        else if(!returns->stopped && inst->icode == IRET) predTaken = popReturn(machine, &valC);
+    }
+
+    //updates the F register with the predicted address of the next instruction
+    if(predTaken) machine->next->F.predPC = valC;
+    else machine->next->F.predPC = inst->valP;
+    machine->next->F.delay = 0;
+    machine->next->F.cached = FALSE;
+
+    //checks if the D register should be stalled or bubbled, and updates the D register as necessary
+    if(stall){
+        machine->next->D = machine->cur->D;
+        countStall(machine, STAGED, stallCause(signals));
+    }
+    else if(bubble){
+        updateDregister(machine, SAOK, INOP, 0, RNONE, RNONE, 0, 0, NOPC, FALSE);
+        countBubble(machine, STAGED, bubbleCause(machine, signals));
+        TRACEPOINT(TPBUBBLE, machine, NOPC, STAGED, bubbleCause(machine, signals));
+    }
+    else{
+        updateDregister(machine, inst->stat, inst->icode, inst->ifun, inst->rA, inst->rB, valC, inst->valP,
+                        f_pc, predTaken);
+        savePredictor(machine, &machine->next->D.checkpoint);
+        TRACEPOINT(TPFETCH, machine, f_pc, inst->icode, inst->ifun);
+    }
+}
+
+/* Function Name: decodeInstruction
+ * Purpose:       Reads the instruction at an address from memory, splits it into
+ *                its fields and adds it to the predecode cache
+ * Parameters:    machine - machine being simulated
+ *                f_pc - address of the instruction
+ * Returns:       pointer to the cached instruction
+ * Modifies:      predecode cache
+ */
+predecodeType * decodeInstruction(machineType * machine, unsigned int f_pc)
+{
+	predecodeType inst;
 	unsigned int opcode;
-	unsigned int f_pc;
     bool memError = FALSE;
 
-    //address of next instruction
-    f_pc = selectPC(forwarded);
+    inst.pc = f_pc;
+    inst.rA = RNONE;
+    inst.rB = RNONE;
+    inst.valC = 0;
 
-    //grabs the byte-long opcode
-    opcode = getByte(f_pc, &memError);
+    //grabs the byte-long opcode and its descriptor
+    opcode = getByte(machine, f_pc, &memError);
+    const opcodeType * op = &opcodeTable[opcode];
 
     //gets the function code and instruction code
-    ifun = getBits(0, 3, opcode);
-    icode = getBits(4, 7, opcode);
+    inst.ifun = getBits(0, 3, opcode);
+    inst.icode = getBits(4, 7, opcode);
 
     //checks for valid instructions
-    f_stat = checkIcode(icode);
+    inst.stat = op->stat;
 
     //check for prior memory errors
-    if(memError) f_stat = SADR;
+    if(memError) inst.stat = SADR;
 
-    //Only update values in the F register if a valid instruction
-    if(f_stat != SINS){
+    //Only read the rest of the instruction if a valid instruction
+    if(inst.stat != SINS){
     
         //handles cases where instructions require register IDs or values
-        if(needs_regids(icode)){
+        if(op->regids){
             //gets the byte containing register identifiers and checks for memory errors
-            unsigned int regs = getByte(f_pc+1, &memError);
-            if(memError) f_stat = SADR;
+            unsigned int regs = getByte(machine, f_pc+1, &memError);
+            if(memError) inst.stat = SADR;
 
             //gets the invidivual register identifiers
-            rA = getBits(4,7,regs);
-            rB = getBits(0,3,regs);
+            inst.rA = getBits(4,7,regs);
+            inst.rB = getBits(0,3,regs);
         }
 
         //checks if a value is needed for valC, sets valC to the appropriate value if so
-        if(needs_valc(icode)){
-            switch(icode){
-                case IIRMOVL:
-                case IRMMOVL:
-                case IMRMOVL:
-                    valC = getValC(f_pc+2, &memError);
-                    break;
-                case IDUMP:
-                case IJXX:
-                case ICALL:
-                    valC = getValC((f_pc+1), &memError);
-                    break;
-                default:
-                    valC = getValC((f_pc+1), &memError);
-                    break;
-            }
-            if(memError) f_stat = SADR;
+        if(op->valC){
+            inst.valC = getValC(machine, f_pc + op->valC, &memError);
+            if(memError) inst.stat = SADR;
         }
     }
 
-    //checks if the F register should be stalled, if not the appropriate values are updated
-    if(!F_stall(bubble)){
-        valP = predictPC(f_pc, icode);
+    //address of the next instruction
+    inst.valP = f_pc + op->length;
 
-        if(icode == IJXX || icode == ICALL) F.predPC = valC;
-        else F.predPC = valP;
-    }
-
-    //checks if the D register should be stalled or bubbled, and updates the D register as necessary
-    if(!D_stall(bubble)){
-        if(D_bubble(bubble)) updateDregister(SAOK, INOP, 0, RNONE, RNONE, 0, 0);
-        else updateDregister(f_stat, icode, ifun, rA, rB, valC, valP);
-    }
+    return insertPredecode(machine, &inst);
 }
+
 /* Function Name: getFregister
 *  Purpose:       Returns a copy of the F register
 *
-*  Parameterss:   -
+*  Parameterss:   machine - machine being simulated
 *  Returns:       fregister
 *  Modifies:      -
 */
-fregister getFregister()
+fregister getFregister(machineType * machine)
 {
-    return F;
+    return machine->cur->F;
 }
 
 /* Function Name: clearFregister
 *  Purpose:       Returns a copy of the F register
 *
-*  Parameterss:   -
+*  Parameterss:   machine - machine being simulated
 *  Returns:       -
 *  Modifies:      F
 */ 
-void clearFregister()
+void clearFregister(machineType * machine)
 {
-    clearBuffer((char *) &F, sizeof(F));
+    clearBuffer((char *) &machine->cur->F, sizeof(machine->cur->F));
 }
 
 /*  Function Name: selectPC
  *  Purpose:       retrieving the address of the next function
  *
- *  Parameters:    forwarded - struct containing forwarded values
+ *  Parameters:    machine - machine being simulated
+ *                 signals - address read by a ret in the memory stage
+ *                 redirect - gets TRUE if the address isn't the predicted one
  *  Returns:       The address of the next instruction
- *  Modifies:      -
+ *  Modifies:      redirect
  */
-unsigned int selectPC(forwardType forwarded)
+unsigned int selectPC(machineType * machine, signalType * signals, bool * redirect)
 {
-    //checks icode in later stages for forwarding
-    if(forwarded.M_icode == IJXX && !forwarded.M_Cnd) return forwarded.M_valA;
-    else if(forwarded.W_icode == IRET) return forwarded.W_valM;
+    pipelineType * cur = machine->cur;
 
-    //returns F.predPC if no forwarding is needed
-    else return F.predPC;
-}
+    *redirect = TRUE;
 
-/* Function Name: predictPC
- * Purpose:       Predicts the address of the next instruction based on the length of the
- *                current instruction
- *
- * Parameters:    pc - address of the current instruction
- *                icode - the current instruction code
- * Returns:       predicted address of the next instruction
- * Modifies:      -
- */
-unsigned int predictPC(unsigned int pc, unsigned int icode){
-    //Use switch statement to predict next address based on length of current instruction
-    switch(icode){
-        case IHALT:
-            return pc + 1;
-        case INOP:
-            return pc + 1;
-        case IIRMOVL:
-            return pc + 6;
-        case IRMMOVL:
-            return pc + 6;
-        case IMRMOVL:
-            return pc + 6;
-        case IOPL:
-            return pc + 2;
-        case IJXX:
-            return pc + 5;
-        case ICMOVXX:
-            return pc + 2;
-        case ICALL:
-            return pc + 5;
-        case IRET:
-            return pc + 1;
-        case IPUSHL:
-            return pc + 2;
-        case IPOPL:
-            return pc + 2;
-        case IDUMP:
-            return pc + 5;
-        default:
-            return pc + 1;
-    }
-}
+    //a mispredicted ret goes on at the address it read as soon as it is read
+    if(signals->m_retMiss) return signals->m_valM;
 
-/* Function Name: needs_regids
- * Purpose:       Determines if the current instruction requires register IDs
- *
- * Parameters:    icode - the instruction code for the current instruction
- * Returns:       True if register IDs are needed, false otherwise
- * Modifies:      -
- */
-bool needs_regids(unsigned int icode){
-    switch(icode){
-        case IIRMOVL:
-        case IRMMOVL:
-        case IMRMOVL:
-        case IOPL:
-        case ICMOVXX:
-        case IPUSHL:
-        case IPOPL:
-            return TRUE;
-        default:            //If not one of the above instructions, return FALSE
-            return FALSE;
-    }
-}
+    //a mispredicted jump carries the address fetch should have gone on at in valA
+    else if(cur->M[0].icode == IJXX && cur->M[0].Cnd != cur->M[0].predTaken) return cur->M[0].valA;
+    else if(cur->W.icode == IRET && !cur->W.predTaken) return cur->W.valM;
 
-/* Function Name: needs_valc
- * Purpose:       Determines if the current instruction requires a value provided by
- *                the instruction.
- *
- * Parameters:    icode - the current instruction code
- * Returns:       True if a value is required, false otherwise
- * Modifies:      -
- */
-bool needs_valc(unsigned int icode){
-    switch(icode){
-        case IIRMOVL:
-        case IRMMOVL:
-        case IMRMOVL:
-        case IJXX:
-        case ICALL:
-        case IDUMP:
-            return TRUE;
-        default:            //If not one of the above instructions, return False
-            return FALSE;
-    }
+    //returns F.predPC if no forwarding is needed
+    *redirect = FALSE;
+    return cur->F.predPC;
 }
 
 /* Function Name: getValC
  * Purpose:       Retrieves the value contained in the instruction
  *
- * Parameters:    f_pc - the starting address of value to return
+ * Parameters:    machine - machine being simulated
+ *                f_pc - the starting address of value to return
  *                memError - a pointer to a boolean that indicates whether a memory error occurred
  * Returns:       the valC value
  * Modifies:      -
  */
-unsigned int getValC(unsigned int f_pc, bool * memError){
-    //obtains the 4 bytes needed
-    unsigned char byte0 = getByte(f_pc, memError);
-    unsigned char byte1 = getByte(f_pc+1, memError);
-    unsigned char byte2 = getByte(f_pc+2, memError);
-    unsigned char byte3 = getByte(f_pc+3, memError);
-
-    //combines the four bytes into an unsigned int and returns
-    return buildWord(byte0, byte1, byte2, byte3);
-}
-
-/* Function Name: checkIcode
- * Purpose:       Checks for valid instructions and returns the status
- *
- * Parameters:    icode - the current instruction code
- * Returns:       The status as determined by the icode
- * Modifies:      -
- */
-unsigned int checkIcode(unsigned int icode){
-    switch(icode){
-        case INOP:
-        case IRRMOVL:
-        case IIRMOVL:
-        case IRMMOVL:
-        case IMRMOVL:
-        case IOPL:
-        case IJXX:
-        case ICALL:
-        case IRET:
-        case IPUSHL:
-        case IPOPL:
-        case IDUMP:
-            return SAOK;    //SAOK if a valid, non-halt instruction
-        case IHALT:
-            return SHLT;    //SHLT if instruction is a halt
-        default:
-            return SINS;    //SINS if the instruction is invalid
-    }
+unsigned int getValC(machineType * machine, unsigned int f_pc, bool * memError){
+    //the 4 bytes needed are a single, possibly unaligned, word
+    return getWord(machine, f_pc, memError);
 }
 
 /* Function Name: F_stall
  * Purpose:       Determines if a stall should be performed on the F register
  *
- * Parameters:    bubble - struct containing values for determining if the register should be stalled
+ * Parameters:    machine - machine being simulated
+ *                signals - values for determining if the register should be stalled
  * Returns:       TRUE if register should be stalled, FALSE otherwise
  * Modifies:      -
  */
-bool F_stall(bubbleType bubble){
-    //makes code easier to read
-    unsigned int E_icode = bubble.E_icode;
-    unsigned int E_dstM = bubble.E_dstM;
+bool F_stall(machineType * machine, signalType * signals){
+    //fetch goes on at the address read by a mispredicted ret
+    if(signals->m_retMiss) return FALSE;
 
-    //register should be stalled if a RET instruction is anywhere in the pipeline except the writeback stage
-    if(bubble.D_icode == IRET || E_icode == IRET || bubble.M_icode == IRET) return TRUE;
+    //register should be stalled if an unpredicted RET instruction is anywhere in the pipeline
+    //except the writeback stage
+    if(waitForRet(machine)) return TRUE;
 
-    //stall required if a load/data hazard is present
-    else if((E_icode == IMRMOVL || E_icode == IPOPL) && (E_dstM == bubble.d_srcA || E_dstM == bubble.d_srcB)) return TRUE;
+    //stall required if a load/data hazard is present or the instruction in execute stays there
+    else if(signals->d_loadUse || signals->e_busy) return TRUE;
     return FALSE;
 }
 
 /* Function Name: D_stall
  * Purpose:       Determines if the D register should be stalled
  *
- * Parameters:    bubble - struct containing values for determining if the register should be stalled
+ * Parameters:    machine - machine being simulated
+ *                signals - values for determining if the register should be stalled
  * Returns:       TRUE if register should be stalled, FALSE otherwise
  * Modifies:      -
  */
-bool D_stall(bubbleType bubble){
-    //makes code easier to read
-    unsigned int E_icode = bubble.E_icode;
-    unsigned int E_dstM = bubble.E_dstM;
+bool D_stall(machineType * machine, signalType * signals){
+    //the instruction in the decode stage follows a mispredicted ret, so it is replaced
+    if(signals->m_retMiss) return FALSE;
+    if(signals->e_busy) return TRUE;
+
+    //a load in a memory stage can be ahead of a mispredicted jump, the instruction
+    //waiting for it is bubbled instead
+    if(machine->cur->E.icode == IJXX && signals->e_Cnd != machine->cur->E.predTaken) return FALSE;
 
     //stall required if a load/data hazard is present
-    if((E_icode == IMRMOVL || E_icode == IPOPL) && (E_dstM == bubble.d_srcA || E_dstM == bubble.d_srcB)) return TRUE;
+    if(signals->d_loadUse) return TRUE;
     return FALSE;
 }
 
 /* Function Name: D_bubble
  * Purpose:       Determines if the D register should be bubbled
  *
- * Parameters:    bubble - struct containing values for determining if the register should be bubbled
+ * Parameters:    machine - machine being simulated
+ *                signals - values for determining if the register should be bubbled
  * Returns:       TRUE if register should be bubbled, false otherwise
  * Modifies:      -
  */
-bool D_bubble(bubbleType bubble){
-    //makes code easier to read
-    unsigned int E_icode = bubble.E_icode;
-    unsigned int E_dstM = bubble.E_dstM;
-
+bool D_bubble(machineType * machine, signalType * signals){
     //checks for a mispredicted branch
-    bool misPredBr = (E_icode == IJXX && !bubble.e_Cnd);
+    bool misPredBr = (machine->cur->E.icode == IJXX && signals->e_Cnd != machine->cur->E.predTaken);
 
-    //checks for a RET instruction later in the pipeline
-    bool iret  = (bubble.D_icode == IRET || E_icode == IRET || bubble.M_icode == IRET);
+    //checks for an unpredicted RET instruction later in the pipeline
+    bool iret  = waitForRet(machine);
 
     //checks if load/data hazard exists
-    bool bub = (!((E_icode == IMRMOVL || E_icode == IPOPL) && (E_dstM == bubble.d_srcA || E_dstM == bubble.d_srcB)) && iret);
+    bool bub = (!signals->d_loadUse && iret);
 
+    //the instruction fetched at the address read by a mispredicted ret goes on to decode
+    if(signals->m_retMiss) return FALSE;
     if(misPredBr || bub) return TRUE;
     return FALSE;
 }
+
+/* Function Name: waitForRet
+ * Purpose:       Determines if fetch has to wait for a ret to read its address
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       TRUE if a ret the return address stack didn't predict is in the
+ *                decode, execute or a memory stage, FALSE otherwise
+ * Modifies:      -
+ */
+bool waitForRet(machineType * machine){
+    pipelineType * cur = machine->cur;
+    int i;
+
+    if((cur->D.icode == IRET && !cur->D.predTaken) || (cur->E.icode == IRET && !cur->E.predTaken)) return TRUE;
+    for(i = 0; i < machine->config.memoryStages; i++)
+        if(cur->M[i].icode == IRET && !cur->M[i].predTaken) return TRUE;
+    return FALSE;
+}
+
+/* Function Name: repairPredictor
+ * Purpose:       Puts the return address stack and the perfect predictor back
+ *                as they were after the instruction whose misprediction
+ *                squashes the ones after it this cycle, a ret that read
+ *                another address than the stack gave or a conditional jump
+ *                that went the other way
+ *
+ * Parameters:    machine - machine being simulated
+ *                signals - values computed by the later stages this clock cycle
+ * Returns:       -
+ * Modifies:      machine->predictor
+ */
+void repairPredictor(machineType * machine, signalType * signals){
+    pipelineType * cur = machine->cur;
+
+    //the ret is older than a jump in the execute stage, which it squashes too
+    if(signals->m_retMiss) restorePredictor(machine, &cur->M[machine->config.memoryStages - 1].checkpoint);
+    else if(!signals->e_busy && cur->E.icode == IJXX && signals->e_Cnd != cur->E.predTaken)
+        restorePredictor(machine, &cur->E.checkpoint);
+}
@@ -5,12 +5,13 @@
 typedef struct 
 {
     unsigned int predPC;
+    unsigned int delay;       //cycles until the instruction at predPC reaches the decode stage
+    unsigned char cached;     //TRUE if the instruction at predPC was looked up in the instruction cache
 } fregister;
 
 //prototypes for functions called from files other than fetchStage
-fregister getFregister();
-void clearFregister();
-void updateDregister(unsigned int stat, unsigned int icode, unsigned int ifun, unsigned int rA,
-    unsigned int rB, unsigned int valC, unsigned int valP);
-void fetchStage(forwardType forwarded, bubbleType bubble);
+fregister getFregister(machineType * machine);
+void clearFregister(machineType * machine);
+void fetchStage(machineType * machine, signalType * signals);
+predecodeType * decodeInstruction(machineType * machine, unsigned int f_pc);
 #endif
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include "machine.h"
+#include "tools.h"
+#include "instructions.h"
+#include "opcodes.h"
+#include "dump.h"
+#include "functional.h"
+
+/*
+ * Functional.c - simulates a program one whole instruction at a time.
+ * There is no pipeline, so there are no pipeline registers, forwarding
+ * or bubbles, only the program registers, condition codes and memory.
+ * The architectural results match the pipeline's, which stays the model
+ * of how many clock cycles a program takes.
+ */
+
+//prototypes of functions only called within this file
+static void dumpProcessor(machineType * machine);
+//end prototypes
+
+/* Function Name: runFunctional
+ * Purpose:       Simulates the loaded program one instruction at a time
+ *                until it halts or causes an error.
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       number of instructions executed, including the one that
+ *                stopped the program
+ * Modifies:      machine
+ */
+unsigned long long runFunctional(machineType * machine)
+{
+    return runFunctionalFrom(machine, 0);
+}
+
+/* Function Name: runFunctionalFrom
+ * Purpose:       Simulates the program one instruction at a time starting
+ *                at an address, with the registers and condition codes the
+ *                machine already holds.  Lets translated code hand a program
+ *                over when it can't carry on itself.
+ *
+ * Parameters:    machine - machine holding the program
+ *                pc - address of the first instruction
+ * Returns:       number of instructions executed, including the one that
+ *                stopped the program
+ * Modifies:      machine
+ */
+unsigned long long runFunctionalFrom(machineType * machine, unsigned int pc)
+{
+    unsigned long long count = 0;
+    bool stop = FALSE;
+
+    while(!stop){
+        count++;
+        stop = stepFunctional(machine, &pc);
+    }
+    return count;
+}
+
+/* Function Name: stepFunctional
+ * Purpose:       Simulates one instruction
+ *
+ * Parameters:    machine - machine holding the program
+ *                pc - address of the instruction
+ * Returns:       TRUE if the program stopped with the instruction
+ * Modifies:      machine, pc is set to the address of the next instruction
+ */
+bool stepFunctional(machineType * machine, unsigned int * pc)
+{
+    //the decoded instruction, only decoded again if it isn't in the predecode cache
+    predecodeType * inst = lookupPredecode(machine, *pc);
+    if(inst == NULL) inst = decodeInstruction(machine, *pc);
+    const opcodeType * op = &opcodeTable[OPCODE(inst->icode, inst->ifun)];
+
+    unsigned int stat = inst->stat;
+    unsigned int nextPC = inst->valP;
+    unsigned int valE = 0;
+    unsigned int valM = 0;
+    bool memError = FALSE;
+
+    //the descriptor's register selectors index this array
+    unsigned int regs[4] = {RNONE, inst->rA, inst->rB, ESP};
+    unsigned int dstE = regs[op->dstE];
+    unsigned int dstM = regs[op->dstM];
+
+    if(stat == SAOK){
+        unsigned int valA = op->useValP ? inst->valP : getRegister(machine, regs[op->srcA]);
+        unsigned int valB = getRegister(machine, regs[op->srcB]);
+
+        //execute
+        switch(inst->icode){
+            case IOPL:
+                valE = alu(machine, inst->ifun, valA, valB);
+                break;
+            case IRRMOVL:
+                valE = valA;
+                if(!testCondition(machine, inst->ifun)) dstE = RNONE;
+                break;
+            case IIRMOVL:
+            case IDUMP:
+                valE = inst->valC;
+                break;
+            case IRMMOVL:
+            case IMRMOVL:
+                valE = valB + inst->valC;
+                break;
+            case ICALL:
+            case IPUSHL:
+                valE = valB - 4;
+                break;
+            case IRET:
+            case IPOPL:
+                valE = valB + 4;
+                break;
+            case IJXX:
+                if(testCondition(machine, inst->ifun)) nextPC = inst->valC;
+                break;
+        }
+        if(inst->icode == ICALL) nextPC = inst->valC;
+
+        //memory, the descriptor's address selector indexes this array
+        unsigned int addrs[3] = {0, valE, valA};
+        if(op->memRead) valM = getWord(machine, addrs[op->memAddr], &memError);
+        else if(op->memWrite) putWord(machine, addrs[op->memAddr], valA, &memError);
+        if(memError) stat = SADR;
+        if(inst->icode == IRET) nextPC = valM;
+    }
+
+    //write back
+    if(stat == SAOK){
+        setRegister(machine, dstE, valE);
+        setRegister(machine, dstM, valM);
+    }
+    *pc = nextPC;
+    return retire(machine, stat, inst->icode, valE);
+}
+
+/* Function Name: retire
+ * Purpose:       Performs the dumps of an instruction and stops the program
+ *                the same way the writeback stage does.  Used by the engines
+ *                that run whole instructions.
+ *
+ * Parameters:    machine - machine being simulated
+ *                stat - status of the instruction
+ *                icode - instruction code
+ *                valE - dump bits of a dump instruction
+ * Returns:       TRUE if the program should stop
+ * Modifies:      -
+ */
+bool retire(machineType * machine, unsigned int stat, unsigned int icode, unsigned int valE)
+{
+    //check if instruction is a dump
+    if(icode == IDUMP && stat == SAOK){
+        if(valE & 0x1) dumpProgramRegisters(machine);
+        if(valE & 0x2) dumpProcessor(machine);
+        if(valE & 0x4) dumpMemory(machine);
+    }
+
+    //determines next operation based on status
+    switch(stat){
+        case SAOK:
+            return FALSE; //continue program operation
+        case SADR:
+            fprintf(machine->out, "Invalid memory address\n");
+            break;
+        case SINS:
+            fprintf(machine->out, "Invalid instruction\n");
+            break;
+        default:
+            return TRUE; //program terminated due to halt
+    }
+
+    //error, dump everything and terminate
+    dumpProgramRegisters(machine);
+    dumpProcessor(machine);
+    dumpMemory(machine);
+    return TRUE;
+}
+
+/* Function Name: dumpProcessor
+ * Purpose:       Displays what there is of the processor registers without a
+ *                pipeline, the condition codes
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       -
+ * Modifies:      -
+ */
+static void dumpProcessor(machineType * machine)
+{
+    dumpConditionCodes(machine);
+    fprintf(machine->out, "\n");
+}
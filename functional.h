@@ -0,0 +1,9 @@
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+
+//prototypes
+unsigned long long runFunctional(machineType * machine);
+unsigned long long runFunctionalFrom(machineType * machine, unsigned int pc);
+bool stepFunctional(machineType * machine, unsigned int * pc);
+bool retire(machineType * machine, unsigned int stat, unsigned int icode, unsigned int valE);
+#endif
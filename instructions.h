@@ -22,6 +22,9 @@
 #define IPOPL 0xB
 #define IDUMP 0xC
 
+//pc of a bubble, so it isn't mistaken for a nop of the program
+#define NOPC 0xffffffff
+
 //IOPL function codes
 #define ADDL 0
 #define SUBL 1
@@ -0,0 +1,879 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include "machine.h"
+#include "tools.h"
+#include "instructions.h"
+#include "opcodes.h"
+#include "functional.h"
+#include "threaded.h"
+#include "jit.h"
+
+/*
+ * Jit.c - simulates a program by translating its basic blocks into x86-64
+ * code.  A block is translated the first time the PC reaches it and ends
+ * at a jump, call, ret, dump or halt.  Its exits jump back to the dispatcher
+ * in runJit, which translates the block they go to and patches the jump to
+ * go straight there, so a loop runs without leaving the host code.
+ *
+ * While the host code runs guest register r is in host register r8 + r,
+ * the state pointer is in rbx and the count of instructions is in rbp.
+ * After an opl the condition codes are left in the host flags and are
+ * only stored into the state when something needs them from memory: a
+ * memory access (which calls a helper), the end of a block, or an and or
+ * xor, which leave OF alone while the host clears it.  Memory is accessed
+ * through getWord and putWord.  A store into translated code flushes every
+ * translation.
+ *
+ * Only x86-64 hosts are supported, anywhere else the threaded engine runs
+ * instead.
+ */
+
+#if defined(__x86_64__)
+
+//host registers
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RBP 5
+#define RSI 6
+#define RDI 7
+#define GUEST(reg) ((reg) + 8)
+
+//x86 condition codes, used by jcc, setcc and cmovcc
+#define XB 0x2                //carry set
+#define XE 0x4
+#define XNE 0x5
+#define XS 0x8
+#define XO 0x0
+#define XL 0xc
+#define XGE 0xd
+#define XLE 0xe
+#define XG 0xf
+
+//where the condition codes are while a block is translated
+#define CCMEM 0               //only in the state
+#define CCHOST 1              //in the host flags, maybe also in the state
+#define CCHOSTZS 2            //ZF and SF in the host flags, OF in the state
+
+//what translateBlock knows about the code it has emitted so far
+typedef struct
+{
+    jitCacheType * cache;
+    int flags;                //CC... where the condition codes are
+    bool stored;              //TRUE if the state holds all of the condition codes
+    unsigned int count;       //instructions translated so far
+} translationType;
+
+//the host condition for each jump function code when the host flags hold the condition codes
+static const unsigned char hostCondition[7] =
+{
+    [JLE] = XLE,
+    [JL] = XL,
+    [JE] = XE,
+    [JNE] = XNE,
+    [JGE] = XGE,
+    [JG] = XG
+};
+
+//prototypes of functions only called within this file
+static unsigned char * findBlock(jitCacheType * cache, machineType * machine, unsigned int pc);
+static unsigned char * translateBlock(jitCacheType * cache, machineType * machine, unsigned int pc);
+static bool translateInstruction(translationType * t, predecodeType * inst);
+static void translateMove(translationType * t, unsigned int ifun, unsigned int srcA, unsigned int dst);
+static void translateOpl(translationType * t, unsigned int ifun, unsigned int srcA, unsigned int srcB);
+static void translateJump(translationType * t, unsigned int ifun, unsigned int valC, unsigned int valP);
+static int emitCondition(translationType * t, unsigned int ifun);
+static void emitStore(translationType * t);
+static void emitExit(translationType * t, unsigned int reason, unsigned int pc, unsigned int count);
+static void emitLink(translationType * t, unsigned int pc);
+static void emitCall(translationType * t, void * function);
+static void emitMemoryCheck(translationType * t);
+static void emitCodeCheck(translationType * t, unsigned int pc);
+static void emitOperand(jitCacheType * cache, int reg, unsigned int guest);
+static void emitAddress(jitCacheType * cache, unsigned int base, unsigned int disp);
+static void emitRex(jitCacheType * cache, bool wide, int reg, int rm);
+static void emitRR(jitCacheType * cache, unsigned int opcode, int reg, int rm);
+static void emitMovImm(jitCacheType * cache, int rm, unsigned int value);
+static void emitSetcc(jitCacheType * cache, int cc, unsigned int offset);
+static void emitMovzx(jitCacheType * cache, int reg, unsigned int offset);
+static void emitStateImm(jitCacheType * cache, unsigned int offset, unsigned int value);
+static void emitStateReg(jitCacheType * cache, unsigned int opcode, int reg, unsigned int offset);
+static unsigned int emitJcc(jitCacheType * cache, int cc);
+static void emitJmp(jitCacheType * cache, unsigned int target);
+static void patch(jitCacheType * cache, unsigned int site);
+static void emitPrologue(jitCacheType * cache);
+static void emit8(jitCacheType * cache, unsigned int value);
+static void emit32(jitCacheType * cache, unsigned int value);
+static void emit64(jitCacheType * cache, unsigned long long value);
+static unsigned int jitLoad(jitStateType * state, unsigned int address);
+static void jitStore(jitStateType * state, unsigned int address, unsigned int value);
+static void flushJit(jitCacheType * cache);
+static void syncJit(machineType * machine, jitStateType * state);
+//end prototypes
+
+#endif
+
+/* Function Name: runJit
+ * Purpose:       Simulates the loaded program by translating it into host
+ *                code, until it halts or causes an error.
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       number of instructions executed, including the one that
+ *                stopped the program
+ * Modifies:      machine
+ */
+unsigned long long runJit(machineType * machine)
+{
+#if defined(__x86_64__)
+    jitCacheType * cache = calloc(1, sizeof(jitCacheType));
+    jitStateType state;
+    void (* enter)(jitStateType * state, unsigned char * code);
+    unsigned char * code;
+    int i;
+
+    if(cache != NULL)
+        cache->code = mmap(NULL, JITCODESIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(cache == NULL || cache->code == MAP_FAILED){
+        printf("Unable to allocate the translated code\n");
+        exit(1);
+    }
+    emitPrologue(cache);
+    enter = (void (*)(jitStateType *, unsigned char *)) cache->code;
+
+    clearBuffer((char *) &state, sizeof(state));
+    for(i = 0; i < REGSIZE; i++) state.registers[i] = getRegister(machine, i);
+    state.zf = getCC(machine, ZF);
+    state.sf = getCC(machine, SF);
+    state.of = getCC(machine, OF);
+    state.machine = machine;
+    state.codeLines = cache->codeLines;
+
+    code = findBlock(cache, machine, state.pc);
+    do {
+        enter(&state, code);
+
+        switch(state.reason){
+            case EXITLINK:
+                //link the exit to the block so the next time it goes straight there
+                code = findBlock(cache, machine, state.pc);
+                if(code != NULL){
+                    unsigned int offset = code - (state.linkSite + 4);
+                    for(i = 0; i < 4; i++) state.linkSite[i] = offset >> (i * 8);
+                }
+                break;
+            case EXITFLUSH:
+                flushJit(cache);
+                code = findBlock(cache, machine, state.pc);
+                break;
+            case EXITDUMP:
+                syncJit(machine, &state);
+                retire(machine, SAOK, IDUMP, state.dumpBits);
+                code = findBlock(cache, machine, state.pc);
+                break;
+            case EXITPC:
+                code = findBlock(cache, machine, state.pc);
+                break;
+        }
+
+        //out of room for the block, start over
+        if(state.reason != EXITSTOP && code == NULL){
+            flushJit(cache);
+            code = findBlock(cache, machine, state.pc);
+        }
+    } while(state.reason != EXITSTOP);
+
+    syncJit(machine, &state);
+    retire(machine, state.stat, IHALT, 0);
+    munmap(cache->code, JITCODESIZE);
+    free(cache);
+    return state.count;
+#else
+    return runThreaded(machine);
+#endif
+}
+
+#if defined(__x86_64__)
+
+/* Function Name: findBlock
+ * Purpose:       Finds the host code of the block that starts at an address,
+ *                translating it if it hasn't been
+ *
+ * Parameters:    cache - translations of the program
+ *                machine - machine holding the program
+ *                pc - address of the block
+ * Returns:       the host code, NULL if there is no room left to translate it
+ * Modifies:      cache
+ */
+static unsigned char * findBlock(jitCacheType * cache, machineType * machine, unsigned int pc)
+{
+    jitBlockType * block = &cache->blocks[pc & (JITBLOCKS - 1)];
+
+    if(block->code != NULL && block->pc == pc) return block->code;
+    if(cache->used + JITBLOCKBYTES > JITCODESIZE) return NULL;
+
+    block->pc = pc;
+    block->code = translateBlock(cache, machine, pc);
+    return block->code;
+}
+
+/* Function Name: translateBlock
+ * Purpose:       Translates the instructions from an address up to the end
+ *                of the block, at most JITBLOCKLEN of them
+ *
+ * Parameters:    cache - translations of the program
+ *                machine - machine holding the program
+ *                pc - address of the block
+ * Returns:       the host code of the block
+ * Modifies:      cache
+ */
+static unsigned char * translateBlock(jitCacheType * cache, machineType * machine, unsigned int pc)
+{
+    unsigned char * start = &cache->code[cache->used];
+    translationType t = {cache, CCMEM, TRUE, 0};
+    unsigned int line;
+    bool end = FALSE;
+
+    while(!end){
+        //the decoded instruction, only decoded again if it isn't in the predecode cache
+        predecodeType * inst = lookupPredecode(machine, pc);
+        if(inst == NULL) inst = decodeInstruction(machine, pc);
+
+        //mark every line the instruction's bytes fall in
+        for(line = inst->pc >> JITLINEBITS; line <= (inst->valP - 1) >> JITLINEBITS; line++)
+            cache->codeLines[line & (JITLINES - 1)] = 1;
+
+        end = translateInstruction(&t, inst);
+        pc = inst->valP;
+        if(!end && t.count == JITBLOCKLEN){
+            emitLink(&t, pc);
+            end = TRUE;
+        }
+    }
+    return start;
+}
+
+/* Function Name: translateInstruction
+ * Purpose:       Emits the host code for one instruction
+ *
+ * Parameters:    t - the block being translated
+ *                inst - the decoded instruction
+ * Returns:       TRUE if the instruction ends the block
+ * Modifies:      t
+ */
+static bool translateInstruction(translationType * t, predecodeType * inst)
+{
+    jitCacheType * cache = t->cache;
+    const opcodeType * op = &opcodeTable[OPCODE(inst->icode, inst->ifun)];
+
+    //the descriptor's register selectors index this array
+    unsigned int regs[4] = {RNONE, inst->rA, inst->rB, ESP};
+    unsigned int srcA = regs[op->srcA];
+    unsigned int srcB = regs[op->srcB];
+    unsigned int dst = (op->dstM != SELNONE) ? regs[op->dstM] : regs[op->dstE];
+
+    t->count++;
+    if(inst->stat != SAOK){
+        emitStateImm(cache, offsetof(jitStateType, stat), inst->stat);
+        emitExit(t, EXITSTOP, 0, t->count);
+        return TRUE;
+    }
+
+    switch(inst->icode){
+        case IRRMOVL:
+            translateMove(t, inst->ifun, srcA, dst);
+            break;
+        case IIRMOVL:
+            if(dst < REGSIZE) emitMovImm(cache, GUEST(dst), inst->valC);
+            break;
+        case IOPL:
+            translateOpl(t, inst->ifun, srcA, srcB);
+            break;
+        case IRMMOVL:
+            emitStore(t);
+            emitAddress(cache, srcB, inst->valC);
+            emitOperand(cache, RDX, srcA);
+            emitCall(t, jitStore);
+            emitMemoryCheck(t);
+            emitCodeCheck(t, inst->valP);
+            break;
+        case IMRMOVL:
+            emitStore(t);
+            emitAddress(cache, srcB, inst->valC);
+            emitCall(t, jitLoad);
+            emitMemoryCheck(t);
+            if(dst < REGSIZE) emitRR(cache, 0x89, RAX, GUEST(dst));
+            break;
+        case IPUSHL:
+            emitStore(t);
+            emitAddress(cache, ESP, -4);
+            emitOperand(cache, RDX, srcA);
+            emitCall(t, jitStore);
+            emitMemoryCheck(t);
+            emit8(cache, 0x41); emit8(cache, 0x83); emit8(cache, 0xec); emit8(cache, 4); //sub r12d, 4
+            emitCodeCheck(t, inst->valP);
+            break;
+        case IPOPL:
+            emitStore(t);
+            emitAddress(cache, ESP, 0);
+            emitCall(t, jitLoad);
+            emitMemoryCheck(t);
+            emit8(cache, 0x41); emit8(cache, 0x83); emit8(cache, 0xc4); emit8(cache, 4); //add r12d, 4
+            if(dst < REGSIZE) emitRR(cache, 0x89, RAX, GUEST(dst));
+            break;
+        case ICALL:
+            emitStore(t);
+            emitAddress(cache, ESP, -4);
+            emitMovImm(cache, RDX, inst->valP);
+            emitCall(t, jitStore);
+            emitMemoryCheck(t);
+            emit8(cache, 0x41); emit8(cache, 0x83); emit8(cache, 0xec); emit8(cache, 4); //sub r12d, 4
+            emitCodeCheck(t, inst->valC);
+            emitLink(t, inst->valC);
+            return TRUE;
+        case IRET:
+            emitStore(t);
+            emitAddress(cache, ESP, 0);
+            emitCall(t, jitLoad);
+            emitMemoryCheck(t);
+            emit8(cache, 0x41); emit8(cache, 0x83); emit8(cache, 0xc4); emit8(cache, 4); //add r12d, 4
+            emitStateReg(cache, 0x89, RAX, offsetof(jitStateType, pc));
+            emitExit(t, EXITPC, 0, t->count);
+            return TRUE;
+        case IJXX:
+            translateJump(t, inst->ifun, inst->valC, inst->valP);
+            return TRUE;
+        case IDUMP:
+            emitStateImm(cache, offsetof(jitStateType, dumpBits), inst->valC);
+            emitExit(t, EXITDUMP, inst->valP, t->count);
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Function Name: translateMove
+ * Purpose:       Emits an rrmovl or conditional move
+ *
+ * Parameters:    t - the block being translated
+ *                ifun - function code
+ *                srcA - register moved
+ *                dst - register moved to
+ * Returns:       -
+ * Modifies:      t
+ */
+static void translateMove(translationType * t, unsigned int ifun, unsigned int srcA, unsigned int dst)
+{
+    jitCacheType * cache = t->cache;
+    int cc, src;
+
+    //conditions past JG are never true
+    if(dst >= REGSIZE || ifun > JG) return;
+
+    if(ifun == RRMOVL){
+        emitOperand(cache, GUEST(dst), srcA);
+        return;
+    }
+
+    cc = emitCondition(t, ifun);
+    src = (srcA < REGSIZE) ? GUEST(srcA) : RDX;
+    if(srcA >= REGSIZE) emitMovImm(cache, RDX, 0);
+
+    //cmovcc dst, src
+    emitRex(cache, FALSE, GUEST(dst), src);
+    emit8(cache, 0x0f);
+    emit8(cache, 0x40 + cc);
+    emit8(cache, 0xc0 | ((GUEST(dst) & 7) << 3) | (src & 7));
+}
+
+/* Function Name: translateOpl
+ * Purpose:       Emits an opl, leaving the condition codes in the host flags
+ *
+ * Parameters:    t - the block being translated
+ *                ifun - function code
+ *                srcA - register used as aluA
+ *                srcB - register used as aluB and the destination
+ * Returns:       -
+ * Modifies:      t
+ */
+static void translateOpl(translationType * t, unsigned int ifun, unsigned int srcA, unsigned int srcB)
+{
+    jitCacheType * cache = t->cache;
+    int a = (srcA < REGSIZE) ? GUEST(srcA) : RDX;
+    int b = (srcB < REGSIZE) ? GUEST(srcB) : RCX;
+    unsigned int zero, minimum, done;
+
+    //registers that don't exist read as 0, writes to rcx are dropped
+    if(srcA >= REGSIZE) emitMovImm(cache, RDX, 0);
+    if(srcB >= REGSIZE) emitMovImm(cache, RCX, 0);
+
+    switch(ifun){
+        case ADDL:
+            emitRR(cache, 0x01, a, b);
+            t->flags = CCHOST;
+            break;
+
+        case SUBL:
+            //The execute stage only sets OF for b - a if b isn't 0, so 0 - 0x80000000
+            //doesn't overflow there.  Make the host flags agree.
+            emitRR(cache, 0x85, b, b);                       //test b, b
+            emit8(cache, 0x75); emit8(cache, 0); zero = cache->used;
+            emitRex(cache, FALSE, 0, a);                     //cmp a, 0x80000000
+            emit8(cache, 0x81); emit8(cache, 0xf8 | (a & 7)); emit32(cache, 0x80000000);
+            emit8(cache, 0x75); emit8(cache, 0); minimum = cache->used;
+            emitRR(cache, 0x89, a, b);                       //mov b, a
+            emitRR(cache, 0x85, b, b);                       //test b, b, clears OF
+            emit8(cache, 0xeb); emit8(cache, 0); done = cache->used;
+            cache->code[zero - 1] = cache->used - zero;
+            cache->code[minimum - 1] = cache->used - minimum;
+            emitRR(cache, 0x29, a, b);                       //sub b, a
+            cache->code[done - 1] = cache->used - done;
+            t->flags = CCHOST;
+            break;
+
+        default:
+            //and, xor and the undefined function codes leave OF alone but the host clears it
+            if(t->flags == CCHOST && !t->stored) emitSetcc(cache, XO, offsetof(jitStateType, of));
+            if(ifun == ANDL) emitRR(cache, 0x21, a, b);
+            else if(ifun == XORL) emitRR(cache, 0x31, a, b);
+            else emitRR(cache, 0x31, b, b);
+            t->flags = CCHOSTZS;
+    }
+    t->stored = FALSE;
+}
+
+/* Function Name: translateJump
+ * Purpose:       Emits a jump, which ends the block
+ *
+ * Parameters:    t - the block being translated
+ *                ifun - function code
+ *                valC - address jumped to
+ *                valP - address of the next instruction
+ * Returns:       -
+ * Modifies:      t
+ */
+static void translateJump(translationType * t, unsigned int ifun, unsigned int valC, unsigned int valP)
+{
+    unsigned int site;
+
+    emitStore(t);
+    if(ifun == JMP) emitLink(t, valC);
+    else if(ifun > JG) emitLink(t, valP);
+    else {
+        site = emitJcc(t->cache, emitCondition(t, ifun) ^ 1);
+        emitLink(t, valC);
+        patch(t->cache, site);
+        emitLink(t, valP);
+    }
+}
+
+/* Function Name: emitCondition
+ * Purpose:       Gets the condition of a jump or conditional move into the
+ *                host flags, straight from the flags of the last opl when
+ *                they still hold it
+ *
+ * Parameters:    t - the block being translated
+ *                ifun - function code, JLE to JG
+ * Returns:       host condition code that is true when the condition is
+ * Modifies:      t
+ */
+static int emitCondition(translationType * t, unsigned int ifun)
+{
+    jitCacheType * cache = t->cache;
+
+    if(t->flags == CCHOST || (t->flags == CCHOSTZS && (ifun == JE || ifun == JNE)))
+        return hostCondition[ifun];
+
+    //build the CC register in eax and look it up in the condition's mask
+    emitStore(t);
+    emitMovzx(cache, RAX, offsetof(jitStateType, zf));
+    emitMovzx(cache, RCX, offsetof(jitStateType, sf));
+    emit8(cache, 0x8d); emit8(cache, 0x04); emit8(cache, 0x41);          //lea eax, [rcx + rax * 2]
+    emitMovzx(cache, RCX, offsetof(jitStateType, of));
+    emit8(cache, 0x8d); emit8(cache, 0x04); emit8(cache, 0x41);          //lea eax, [rcx + rax * 2]
+    emitMovImm(cache, RCX, conditionMask[ifun]);
+    emit8(cache, 0x0f); emit8(cache, 0xa3); emit8(cache, 0xc1);          //bt ecx, eax
+    t->flags = CCMEM;
+    return XB;
+}
+
+/* Function Name: emitStore
+ * Purpose:       Stores the condition codes held in the host flags into
+ *                the state, without changing the flags
+ *
+ * Parameters:    t - the block being translated
+ * Returns:       -
+ * Modifies:      t
+ */
+static void emitStore(translationType * t)
+{
+    if(t->stored) return;
+    emitSetcc(t->cache, XE, offsetof(jitStateType, zf));
+    emitSetcc(t->cache, XS, offsetof(jitStateType, sf));
+    if(t->flags == CCHOST) emitSetcc(t->cache, XO, offsetof(jitStateType, of));
+    t->stored = TRUE;
+}
+
+/* Function Name: emitExit
+ * Purpose:       Emits a return to the dispatcher.  The condition codes
+ *                must already be stored.
+ *
+ * Parameters:    t - the block being translated
+ *                reason - EXIT... code
+ *                pc - where to continue, not stored for EXITPC
+ *                count - instructions of the block executed
+ * Returns:       -
+ * Modifies:      t
+ */
+static void emitExit(translationType * t, unsigned int reason, unsigned int pc, unsigned int count)
+{
+    jitCacheType * cache = t->cache;
+
+    emitStore(t);
+    emit8(cache, 0x48); emit8(cache, 0x8d); emit8(cache, 0x6d); emit8(cache, count); //lea rbp, [rbp + count]
+    if(reason != EXITPC) emitStateImm(cache, offsetof(jitStateType, pc), pc);
+    emitStateImm(cache, offsetof(jitStateType, reason), reason);
+    emitJmp(cache, cache->epilogue);
+}
+
+/* Function Name: emitLink
+ * Purpose:       Emits a jump to the block at an address.  Until the block
+ *                is linked the jump goes to the code right after it, which
+ *                asks the dispatcher to link it.
+ *
+ * Parameters:    t - the block being translated
+ *                pc - address of the block
+ * Returns:       -
+ * Modifies:      t
+ */
+static void emitLink(translationType * t, unsigned int pc)
+{
+    jitCacheType * cache = t->cache;
+    unsigned int site;
+
+    emitStore(t);
+    emit8(cache, 0x48); emit8(cache, 0x8d); emit8(cache, 0x6d); emit8(cache, t->count); //lea rbp, [rbp + count]
+    emit8(cache, 0xe9); emit32(cache, 0);
+    site = cache->used - 4;
+
+    emitStateImm(cache, offsetof(jitStateType, pc), pc);
+    emitStateImm(cache, offsetof(jitStateType, reason), EXITLINK);
+    emit8(cache, 0x48); emit8(cache, 0xb8); emit64(cache, (unsigned long long) &cache->code[site]); //mov rax, site
+    emitStateReg(cache, 0x89 | 0x100, RAX, offsetof(jitStateType, linkSite));
+    emitJmp(cache, cache->epilogue);
+}
+
+/* Function Name: emitCall
+ * Purpose:       Emits a call to a memory helper, with the address in esi
+ *                and the value stored in edx.  The guest registers in
+ *                r8-r11 are saved around it.
+ *
+ * Parameters:    t - the block being translated
+ *                function - the helper
+ * Returns:       -
+ * Modifies:      t
+ */
+static void emitCall(translationType * t, void * function)
+{
+    jitCacheType * cache = t->cache;
+    int i;
+
+    for(i = 0; i < 4; i++){ emit8(cache, 0x41); emit8(cache, 0x50 + i); }      //push r8-r11
+    emit8(cache, 0x48); emit8(cache, 0x89); emit8(cache, 0xdf);                //mov rdi, rbx
+    emit8(cache, 0x48); emit8(cache, 0xb8); emit64(cache, (unsigned long long) function);
+    emit8(cache, 0xff); emit8(cache, 0xd0);                                     //call rax
+    for(i = 3; i >= 0; i--){ emit8(cache, 0x41); emit8(cache, 0x58 + i); }    //pop r11-r8
+    t->flags = CCMEM;
+}
+
+/* Function Name: emitMemoryCheck
+ * Purpose:       Emits a stop with an invalid address status if the last
+ *                memory helper failed
+ *
+ * Parameters:    t - the block being translated
+ * Returns:       -
+ * Modifies:      t
+ */
+static void emitMemoryCheck(translationType * t)
+{
+    jitCacheType * cache = t->cache;
+    unsigned int site;
+
+    emit8(cache, 0x80); emit8(cache, 0x7b); emit8(cache, offsetof(jitStateType, memError)); emit8(cache, 0);
+    site = emitJcc(cache, XE);
+    emitStateImm(cache, offsetof(jitStateType, stat), SADR);
+    emitExit(t, EXITSTOP, 0, t->count);
+    patch(cache, site);
+}
+
+/* Function Name: emitCodeCheck
+ * Purpose:       Emits a return to the dispatcher to flush the translations
+ *                if the last store wrote into translated code
+ *
+ * Parameters:    t - the block being translated
+ *                pc - where to continue
+ * Returns:       -
+ * Modifies:      t
+ */
+static void emitCodeCheck(translationType * t, unsigned int pc)
+{
+    jitCacheType * cache = t->cache;
+    unsigned int site;
+
+    emit8(cache, 0x80); emit8(cache, 0x7b); emit8(cache, offsetof(jitStateType, codeWritten)); emit8(cache, 0);
+    site = emitJcc(cache, XE);
+    emitExit(t, EXITFLUSH, pc, t->count);
+    patch(cache, site);
+}
+
+/* Function Name: emitOperand
+ * Purpose:       Emits a move of a guest register into a host register,
+ *                registers that don't exist read as 0
+ *
+ * Parameters:    cache - where the code is emitted
+ *                reg - host register
+ *                guest - guest register
+ * Returns:       -
+ * Modifies:      cache
+ */
+static void emitOperand(jitCacheType * cache, int reg, unsigned int guest)
+{
+    if(guest < REGSIZE) emitRR(cache, 0x89, GUEST(guest), reg);
+    else emitMovImm(cache, reg, 0);
+}
+
+/* Function Name: emitAddress
+ * Purpose:       Emits the calculation of a memory address into esi
+ *
+ * Parameters:    cache - where the code is emitted
+ *                base - guest register added to disp
+ *                disp - displacement
+ * Returns:       -
+ * Modifies:      cache
+ */
+static void emitAddress(jitCacheType * cache, unsigned int base, unsigned int disp)
+{
+    if(base >= REGSIZE){
+        emitMovImm(cache, RSI, disp);
+        return;
+    }
+
+    //lea esi, [base + disp]
+    emitRex(cache, FALSE, RSI, GUEST(base));
+    emit8(cache, 0x8d);
+    emit8(cache, 0x80 | (RSI << 3) | (GUEST(base) & 7));
+    if((GUEST(base) & 7) == RSP) emit8(cache, 0x24);
+    emit32(cache, disp);
+}
+
+//emits a REX prefix if the instruction needs one
+static void emitRex(jitCacheType * cache, bool wide, int reg, int rm)
+{
+    if(wide || reg >= 8 || rm >= 8)
+        emit8(cache, 0x40 | (wide << 3) | ((reg >= 8) << 2) | (rm >= 8));
+}
+
+//emits a 32 bit instruction between two registers, opcode r/m, reg
+static void emitRR(jitCacheType * cache, unsigned int opcode, int reg, int rm)
+{
+    emitRex(cache, FALSE, reg, rm);
+    emit8(cache, opcode);
+    emit8(cache, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+//emits mov reg, value, which leaves the flags alone
+static void emitMovImm(jitCacheType * cache, int rm, unsigned int value)
+{
+    emitRex(cache, FALSE, 0, rm);
+    emit8(cache, 0xb8 + (rm & 7));
+    emit32(cache, value);
+}
+
+//emits setcc byte [rbx + offset]
+static void emitSetcc(jitCacheType * cache, int cc, unsigned int offset)
+{
+    emit8(cache, 0x0f);
+    emit8(cache, 0x90 + cc);
+    emit8(cache, 0x43);
+    emit8(cache, offset);
+}
+
+//emits movzx reg, byte [rbx + offset]
+static void emitMovzx(jitCacheType * cache, int reg, unsigned int offset)
+{
+    emit8(cache, 0x0f);
+    emit8(cache, 0xb6);
+    emit8(cache, 0x43 | (reg << 3));
+    emit8(cache, offset);
+}
+
+//emits mov dword [rbx + offset], value
+static void emitStateImm(jitCacheType * cache, unsigned int offset, unsigned int value)
+{
+    emit8(cache, 0xc7);
+    emit8(cache, 0x43);
+    emit8(cache, offset);
+    emit32(cache, value);
+}
+
+//emits a move between a register and [rbx + offset], 64 bits if 0x100 is set in opcode
+static void emitStateReg(jitCacheType * cache, unsigned int opcode, int reg, unsigned int offset)
+{
+    emitRex(cache, opcode >> 8, reg, RBX);
+    emit8(cache, opcode & 0xff);
+    emit8(cache, 0x43 | ((reg & 7) << 3));
+    emit8(cache, offset);
+}
+
+//emits a jcc with a 32 bit displacement to be patched, returns where the displacement is
+static unsigned int emitJcc(jitCacheType * cache, int cc)
+{
+    emit8(cache, 0x0f);
+    emit8(cache, 0x80 + cc);
+    emit32(cache, 0);
+    return cache->used - 4;
+}
+
+//emits a jmp to an offset in the code buffer
+static void emitJmp(jitCacheType * cache, unsigned int target)
+{
+    emit8(cache, 0xe9);
+    emit32(cache, target - (cache->used + 4));
+}
+
+//points the jump whose displacement is at site to the next byte emitted
+static void patch(jitCacheType * cache, unsigned int site)
+{
+    unsigned int offset = cache->used - (site + 4);
+    int i;
+
+    for(i = 0; i < 4; i++) cache->code[site + i] = offset >> (i * 8);
+}
+
+/* Function Name: emitPrologue
+ * Purpose:       Emits the code at the start of the buffer that enters a
+ *                block, enter(state, code), and the epilogue that blocks
+ *                jump to when they return to the dispatcher
+ *
+ * Parameters:    cache - translations of the program
+ * Returns:       -
+ * Modifies:      cache
+ */
+static void emitPrologue(jitCacheType * cache)
+{
+    int i;
+
+    //save the registers the host code uses that the caller expects kept
+    emit8(cache, 0x53);                                                         //push rbx
+    emit8(cache, 0x55);                                                         //push rbp
+    for(i = 4; i < 8; i++){ emit8(cache, 0x41); emit8(cache, 0x50 + i); }      //push r12-r15
+    emit8(cache, 0x48); emit8(cache, 0x83); emit8(cache, 0xec); emit8(cache, 8); //sub rsp, 8
+    emit8(cache, 0x48); emit8(cache, 0x89); emit8(cache, 0xfb);                //mov rbx, rdi
+
+    for(i = 0; i < REGSIZE; i++)
+        emitStateReg(cache, 0x8b, GUEST(i), offsetof(jitStateType, registers) + i * 4);
+    emitStateReg(cache, 0x8b | 0x100, RBP, offsetof(jitStateType, count));
+    emit8(cache, 0xff); emit8(cache, 0xe6);                                     //jmp rsi
+
+    cache->epilogue = cache->used;
+    for(i = 0; i < REGSIZE; i++)
+        emitStateReg(cache, 0x89, GUEST(i), offsetof(jitStateType, registers) + i * 4);
+    emitStateReg(cache, 0x89 | 0x100, RBP, offsetof(jitStateType, count));
+    emit8(cache, 0x48); emit8(cache, 0x83); emit8(cache, 0xc4); emit8(cache, 8); //add rsp, 8
+    for(i = 7; i >= 4; i--){ emit8(cache, 0x41); emit8(cache, 0x58 + i); }     //pop r15-r12
+    emit8(cache, 0x5d);                                                         //pop rbp
+    emit8(cache, 0x5b);                                                         //pop rbx
+    emit8(cache, 0xc3);                                                         //ret
+
+    cache->start = cache->used;
+}
+
+static void emit8(jitCacheType * cache, unsigned int value)
+{
+    cache->code[cache->used++] = value;
+}
+
+static void emit32(jitCacheType * cache, unsigned int value)
+{
+    int i;
+    for(i = 0; i < 4; i++) emit8(cache, value >> (i * 8));
+}
+
+static void emit64(jitCacheType * cache, unsigned long long value)
+{
+    emit32(cache, value);
+    emit32(cache, value >> 32);
+}
+
+/* Function Name: jitLoad
+ * Purpose:       Reads a word for the host code
+ *
+ * Parameters:    state - state of the host code
+ *                address - address of the word
+ * Returns:       the word, 0 if the address is invalid
+ * Modifies:      state->memError
+ */
+static unsigned int jitLoad(jitStateType * state, unsigned int address)
+{
+    bool memError;
+    unsigned int value = getWord(state->machine, address, &memError);
+
+    state->memError = memError;
+    return value;
+}
+
+/* Function Name: jitStore
+ * Purpose:       Writes a word for the host code
+ *
+ * Parameters:    state - state of the host code
+ *                address - address of the word
+ *                value - the word
+ * Returns:       -
+ * Modifies:      memory, state->memError, state->codeWritten
+ */
+static void jitStore(jitStateType * state, unsigned int address, unsigned int value)
+{
+    bool memError;
+
+    putWord(state->machine, address, value, &memError);
+    state->memError = memError;
+    state->codeWritten = !memError &&
+        (state->codeLines[(address >> JITLINEBITS) & (JITLINES - 1)] ||
+         state->codeLines[((address + 3) >> JITLINEBITS) & (JITLINES - 1)]);
+}
+
+/* Function Name: flushJit
+ * Purpose:       Drops every translation
+ *
+ * Parameters:    cache - translations of the program
+ * Returns:       -
+ * Modifies:      cache
+ */
+static void flushJit(jitCacheType * cache)
+{
+    cache->used = cache->start;
+    clearBuffer((char *) cache->blocks, sizeof(cache->blocks));
+    clearBuffer((char *) cache->codeLines, sizeof(cache->codeLines));
+}
+
+/* Function Name: syncJit
+ * Purpose:       Copies the registers and condition codes of the host code
+ *                back to the machine
+ *
+ * Parameters:    machine - machine being simulated
+ *                state - state of the host code
+ * Returns:       -
+ * Modifies:      machine
+ */
+static void syncJit(machineType * machine, jitStateType * state)
+{
+    int i;
+
+    for(i = 0; i < REGSIZE; i++) setRegister(machine, i, state->registers[i]);
+    setFlags(machine, (state->zf << ZF) | (state->sf << SF) | (state->of << OF));
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef JIT_H
+#define JIT_H
+
+//bytes of host code kept before the translations are flushed
+#define JITCODESIZE (4 * 1024 * 1024)
+
+//most instructions translated into one block
+#define JITBLOCKLEN 32
+
+//room that must be left in the code buffer to translate a block
+#define JITBLOCKBYTES 16384
+
+//number of blocks that can be found by their address, indexed by the low bits of the PC
+#define JITBLOCKS 4096
+
+//stores are checked against the translations in lines of 1 << JITLINEBITS bytes
+#define JITLINEBITS 5
+#define JITLINES 4096
+
+//why the host code returned to the dispatcher
+#define EXITLINK 0            //reached a block that isn't linked yet
+#define EXITPC 1              //reached an address only known at run time (ret)
+#define EXITFLUSH 2           //a store wrote into translated code
+#define EXITDUMP 3            //a dump instruction
+#define EXITSTOP 4            //halt or an error
+
+/* State shared by the host code and the dispatcher.  The guest registers
+ * only live here between blocks, inside them they are in host registers.
+ * The condition codes are kept one per byte so host flags can be stored
+ * into them with setcc.
+ */
+typedef struct
+{
+    unsigned int registers[REGSIZE];
+    unsigned char zf;
+    unsigned char sf;
+    unsigned char of;
+    unsigned char memError;   //set by the memory helpers
+    unsigned char codeWritten;
+    unsigned int pc;          //where to continue
+    unsigned int reason;      //EXIT... code
+    unsigned int stat;        //status of a program that stopped
+    unsigned int dumpBits;    //valC of a dump instruction
+    unsigned long long count; //instructions executed
+    unsigned char * linkSite; //jump to patch for EXITLINK
+    machineType * machine;
+    unsigned char * codeLines;
+} jitStateType;
+
+//the start of a translated block
+typedef struct
+{
+    unsigned int pc;
+    unsigned char * code;
+} jitBlockType;
+
+//translations of one program
+typedef struct
+{
+    unsigned char * code;     //executable buffer, starts with the prologue and epilogue
+    unsigned int used;
+    unsigned int start;       //first byte after the prologue and epilogue
+    unsigned int epilogue;
+    jitBlockType blocks[JITBLOCKS];
+
+    //nonzero if a translated instruction may overlap the line (hashed on the line number)
+    unsigned char codeLines[JITLINES];
+} jitCacheType;
+
+//prototypes
+unsigned long long runJit(machineType * machine);
+#endif
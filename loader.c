@@ -1,80 +1,125 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "bool.h"
+#include <ctype.h>
+#include "machine.h"
 #include "loader.h"
-#include "memory.h"
 
 /* Function Name: load
- * Purpose:       Driver function. Opens an input file, loads the machine code,
- *                performs a memory dump, then exits.
+ * Purpose:       Driver function. Loads the machine code from the input file
+ *                named on the command line.
  *
- * Parameters:    argc - amount of arguments passed
+ * Parameters:    machine - machine the program is loaded into
+ *                argc - amount of arguments passed
  *                args[] - input file name
  * Returns:       TRUE if program loaded successfully
  *                FALSE if program failed to load
  */
-bool load(int argc, char * args[])
+bool load(machineType * machine, int argc, char * args[])
 {
-    if((argc > 1) && (validFileName(args[1]))){ //check for valid file name and # of arguments
+    if(argc > 1) return loadFile(machine, args[1]); //check # of arguments
 
-        FILE* f = fopen(args[1], "r"); //open the file
+    fprintf(machine->out, "file opening failed\n usage: yess [-m <memory size>] <filename>.yo\n"); //error message
+    return TRUE; //return if no filename
+}
+
+/* Function Name: loadFile
+ * Purpose:       Opens an input file and loads the machine code in it.
+ *
+ * Parameters:    machine - machine the program is loaded into
+ *                fileName - name of the .yo file
+ * Returns:       TRUE if program loaded successfully
+ *                FALSE if program failed to load
+ */
+bool loadFile(machineType * machine, char * fileName)
+{
+    FILE* f;
+
+    //check for valid file name and open the file
+    if(validFileName(fileName) && (f = fopen(fileName, "r")) != NULL){
         
-        unsigned char addrCounter = 0; //counter used to check for overlapping addresses
+        unsigned int addrCounter = 0; //counter used to check for overlapping addresses
         char line[80];
+        char * data;        //line shifted past any address digits beyond the third
         unsigned int addr;
         int i;              //Address parser count
         unsigned int lineCount = 0;
         int len;            //Length of instruction
-        unsigned char dataByte;      //Temporary storage of info
+        unsigned char dataBytes[6];  //Temporary storage of info
         bool loadErr = FALSE;
+        bool memError = FALSE;
         int check;
         while(fgets(line,80,f))     //While we haven't reached the end of the file...
         {           
             lineCount++;
             check = checkLine(line);                    //Check the line
 
+            data = line + addressShift(line);
+
             if(check == 1)                              //If the line is valid...
             {                                           
                 addr = grabAddress(line);               //Grab the address
                 if(addr < addrCounter){                 //Check for errors with the address
-                    printError(lineCount, line);
+                    printError(machine, lineCount, line);
                     loadErr = TRUE;
                     break;
                 }
-                len = lenInst(line);                    //Find the length of the instruction
-                int i = 0;
-                unsigned int byteNo = 0;
-                while(byteNo < len)                          //And load the data byte by byte
-                {
-                    dataByte = grabDataByte(line, 9+i);
-                    putByte(addr, dataByte, &loadErr);
-                    addr++;
-                    byteNo++;
-                    addrCounter = addr;
-                    i += 2;
+                len = lenInst(data);                    //Find the length of the instruction
+                int byteNo;
+                for(byteNo = 0; byteNo < len; byteNo++)     //Grab the data byte by byte
+                    dataBytes[byteNo] = grabDataByte(data, 9+byteNo*2);
+                copyIn(machine, addr, dataBytes, len, &memError);    //And load it as a block
+                addrCounter = addr + len;
+                if(memError){                           //The data doesn't fit in memory
+                    printError(machine, lineCount, line);
+                    loadErr = TRUE;
+                    break;
                 }
-              
+                addSourceLine(machine, TRUE, addr, TRUE, data + 23);   //Keep the assembly for the profile
             }                 
             else if(check == 0)                         //If the line is invalid...
             {                                           //Halt loading and give an error message
-                printError(lineCount, line);
+                printError(machine, lineCount, line);
                 loadErr = TRUE;
                 break;
             }    
+            else if(isAddress(line))                    //A label or directive keeps its address
+                addSourceLine(machine, TRUE, grabAddress(line), FALSE, data + 23);
+            else
+                addSourceLine(machine, FALSE, 0, FALSE, data + 23);
             discardRest(line, f);                                 //If the line or instructions are just spaces, do nothing
         }
 
+        fclose(f);
         return loadErr;                                 //return TRUE if program was successfully loaded
     }
-    printf("file opening failed\n usage: yess <filename>.yo\n"); //error message
+    fprintf(machine->out, "file opening failed\n usage: yess [-m <memory size>] <filename>.yo\n"); //error message
 
     return TRUE; //return if invalid filename
 }
 
-void printError(unsigned int lineNum, char* line){
-    printf("Error on line%d\n", lineNum);
-    printf("%s\n", line);
+void printError(machineType * machine, unsigned int lineNum, char* line){
+    fprintf(machine->out, "Error on line%d\n", lineNum);
+    fprintf(machine->out, "%s\n", line);
+}
+
+/* Function Name: addressShift
+ * Purpose:       Determine how far a record is shifted to the right by an
+ *                address with more than three hex digits (0x1000 and up)
+ *
+ * Parameters:    line - line of YAS
+ * Returns:       Number of address digits beyond the third, 0 if the line
+ *                has no address
+ * Modifies:      -
+ */
+int addressShift(char * line)
+{
+    int count = 4;
+
+    if(!(line[2] == '0' && line[3] == 'x')) return 0;
+    while(count < 12 && isxdigit((int) line[count])) count++;
+    if(count <= 7) return 0;
+    return count - 7;
 }
 
 /* Function Name: lenInst
@@ -287,6 +332,7 @@ int checkLine(char * line)
             return 0;
         if(!isAddress(line))      //Check for address
             return 0;
+        line += addressShift(line); //Skip over any extra address digits
         if(!(line[7] == ':' && line[8] == ' ' && line[21] == ' ' && line[22] == '|')) //Check particular spots
             return 0;
         if(!(isData(line)))       //Check for data
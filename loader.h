@@ -2,7 +2,9 @@
 #define LOADER_H
 
 //prototypes
-bool load(int argc, char * args[]);
+bool load(machineType * machine, int argc, char * args[]);
+bool loadFile(machineType * machine, char * fileName);
+int addressShift(char * line);
 int lenInst(char * line);
 bool validFileName(char * name);
 void discardRest(char * line, FILE * file);
@@ -14,6 +16,6 @@ bool checkHex(char * data, unsigned int start, unsigned int end);
 bool isData(char* line);
 unsigned char grabDataByte(char * data, unsigned int start);
 int checkLine(char * data);
-void printError(unsigned int lineNum, char* line);
+void printError(machineType * machine, unsigned int lineNum, char* line);
 
 #endif
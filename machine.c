@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "tools.h"
+#include "functional.h"
+#include "threaded.h"
+#include "jit.h"
+
+//the engines a program can be simulated with, the first is the default
+static const engineType engines[] =
+{
+    {"pipeline", runMachine, "clock cycles"},
+    {"functional", runFunctional, "instructions"},
+    {"threaded", runThreaded, "instructions"},
+    {"jit", runJit, "instructions"}
+};
+
+/* Function Name: newMachine
+ * Purpose:       Creates a machine with empty memory and registers that
+ *                writes its output to stdout
+ *
+ * Parameters:    -
+ * Returns:       pointer to the new machine, NULL if it couldn't be allocated
+ * Modifies:      -
+ */
+machineType * newMachine()
+{
+    machineType * machine = calloc(1, sizeof(machineType));
+    if(machine == NULL) return NULL;
+
+    machine->memory.memLimit = MEMSIZE - 1;
+    machine->out = stdout;
+    machine->config.predictor = PREDTAKEN;
+    machine->config.fetchStages = 1;
+    machine->config.memoryStages = 1;
+    machine->config.aluLatency = 1;
+    machine->config.memLatency = 1;
+    initializeMachine(machine);
+    return machine;
+}
+
+/* Function Name: freeMachine
+ * Purpose:       Releases a machine and its memory
+ *
+ * Parameters:    machine - machine to release
+ * Returns:       -
+ * Modifies:      machine
+ */
+void freeMachine(machineType * machine)
+{
+    clearMemory(machine);
+    clearPredictor(machine);
+    clearCaches(machine);
+    clearReuse(machine);
+    clearProfile(machine);
+    clearCallGraph(machine);
+    free(machine);
+}
+
+/* Function Name: initializeMachine
+ * Purpose:       Clear the memory and registers in preparation for
+ *                running a new program.  The configuration is kept.
+ *
+ * Parameters:    machine - machine to clear
+ * Returns:       -
+ * Modifies:      machine
+ */
+void initializeMachine(machineType * machine)
+{
+    clearMemory(machine);
+    clearRegisters(machine);
+
+    //the stages write every next pipeline register each clock cycle, so only cur needs its values
+    clearBuffer((char *) machine->latches, sizeof(machine->latches));
+    machine->cur = &machine->latches[0];
+    machine->next = &machine->latches[1];
+    clearFregister(machine);
+    clearDregister(machine);
+    clearEregister(machine);
+    clearMregister(machine);
+    clearWregister(machine);
+
+    //nothing is carried between programs in the signals between stages
+    clearBuffer((char *) &machine->signals, sizeof(machine->signals));
+    clearPredictor(machine);
+
+    //the source of the program is kept by the loader for the profile
+    clearProfile(machine);
+}
+
+/* Function Name: runMachine
+ * Purpose:       Simultes execution of the loaded program through the pipeline
+ *                by calling the different stages in the appropriate order and
+ *                passing the required structs, until the program stops.
+ *                The stages only read the current pipeline registers and
+ *                only write the next ones, which become current at the end
+ *                of the clock cycle, so no stage overwrites the input of
+ *                another.  They are still called from writeback to fetch:
+ *                forwarding, stalls and bubbles use signals a later stage
+ *                works out in the same cycle, and latching those would make
+ *                every forwarded value a cycle late.
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       number of clock cycles the program took
+ * Modifies:      machine
+ */
+unsigned long long runMachine(machineType * machine)
+{
+    //clock cycle counter
+    unsigned long long clockCount = 0;
+    bool stop = FALSE;
+    signalType * signals = &machine->signals;
+
+    startPredictor(machine);
+
+    //without its caches the pipeline runs as if there were none
+    if(!startCaches(machine)){
+        fprintf(stderr, "Unable to allocate the caches\n");
+        clearCaches(machine);
+        machine->config.icache.size = 0;
+        machine->config.dcache.size = 0;
+    }
+    startDram(machine);
+    startStoreBuffer(machine);
+    startPrefetcher(machine);
+    startCounters(machine);
+    startProfile(machine);
+    startCallGraph(machine);
+    if(!startTrace(machine)){
+        fprintf(stderr, "Unable to create the trace %s\n", machine->config.traceFile);
+        machine->config.traceFile = NULL;
+    }
+    machine->cycles = 0;
+    if(!startReuse(machine)){
+        fprintf(stderr, "Unable to allocate the reuse distance profiles\n");
+        clearReuse(machine);
+        machine->config.reuseLines = 0;
+    }
+    while(!stop){
+        dramTick(machine);
+        storeBufferTick(machine);
+        stop = writebackStage(machine);
+        memoryStage(machine, signals);
+        executeStage(machine, signals);
+        decodeStage(machine, signals);
+        fetchStage(machine, signals);
+        if(machine->trace.out != NULL) traceCycle(machine);
+
+        //clock edge, the next pipeline registers become current
+        pipelineType * latched = machine->next;
+        machine->next = machine->cur;
+        machine->cur = latched;
+        machine->cycles++;
+        clockCount++;
+    }
+    if(!endTrace(machine)) fprintf(stderr, "Unable to write the trace %s\n", machine->config.traceFile);
+    return clockCount;
+}
+
+/* Function Name: findEngine
+ * Purpose:       Looks up an engine by name
+ *
+ * Parameters:    name - name of the engine, NULL for the default engine
+ * Returns:       the engine, NULL if there isn't one with that name
+ * Modifies:      -
+ */
+const engineType * findEngine(char * name)
+{
+    size_t i;
+
+    if(name == NULL) return &engines[0];
+    for(i = 0; i < sizeof(engines) / sizeof(engines[0]); i++)
+        if(strcmp(engines[i].name, name) == 0) return &engines[i];
+    return NULL;
+}
+
+/* Function Name: reportStatistics
+ * Purpose:       Writes the statistics of the program that was run, if the
+ *                configuration asks for them
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportStatistics(machineType * machine)
+{
+    if(!machine->config.report) return;
+    reportPredictor(machine);
+    reportCaches(machine);
+    reportPrefetcher(machine);
+    reportStoreBuffer(machine);
+    reportDram(machine);
+    reportReuse(machine);
+    reportProfile(machine);
+    reportCallGraph(machine);
+}
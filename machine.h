@@ -0,0 +1,153 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+/* Everything one simulated machine needs lives in a machineType, so any
+ * number of machines can be simulated at once.  Every function that reads
+ * or changes the state of a machine is passed a pointer to it.
+ *
+ * machineType is declared before the other headers are included because
+ * their prototypes take a machine.
+ */
+typedef struct yess_machine machineType;
+
+#include <stdio.h>
+#include "bool.h"
+#include "signals.h"
+#include "registers.h"
+#include "memory.h"
+#include "predecode.h"
+#include "predictor.h"
+#include "cache.h"
+#include "dram.h"
+#include "storeBuffer.h"
+#include "prefetch.h"
+#include "counters.h"
+#include "profile.h"
+#include "callGraph.h"
+#include "trace.h"
+#include "tracepoints.h"
+#include "reuse.h"
+#include "fetchStage.h"
+#include "decodeStage.h"
+#include "executeStage.h"
+#include "memoryStage.h"
+#include "writebackStage.h"
+
+//largest pipeline geometry that can be asked for
+#define MAXFETCHSTAGES 16
+#define MAXMEMSTAGES 8
+#define MAXLATENCY 64
+
+//options of the pipeline, kept for every program a machine runs
+typedef struct
+{
+    int predictor;            //PRED... used for conditional jumps
+    int rasDepth;             //entries of the return address stack, 0 for none
+    bool report;              //TRUE to write the statistics of a run after its total
+
+    //geometry of the pipeline, all 1 for the five stage pipeline
+    int fetchStages;          //stages a redirected fetch goes through before decode
+    int memoryStages;         //stages of M, memory is accessed in the last one
+    int aluLatency;           //cycles an OPL spends in the execute stage
+    int memLatency;           //cycles an access spends in the last memory stage
+
+    //L1 caches, a size of 0 for memory that always answers in memLatency cycles
+    cacheConfigType icache;
+    cacheConfigType dcache;
+
+    //DRAM the caches miss to, 0 banks for none
+    dramConfigType dram;
+
+    //entries of the store buffer between the memory stage and the data cache, 0 for none
+    int storeBuffer;
+
+    //PREF... prefetching into the data cache, and how many lines ahead
+    int prefetcher;
+    int prefetchDegree;
+
+    //bit n set to profile the reuse distances of lines of 1 << n bytes
+    unsigned int reuseLines;
+
+    //TRUE to profile each instruction and write it next to the source of the program
+    bool profile;
+
+    //file the counters of the pipeline are written to as JSON, NULL for none
+    char * countersFile;
+
+    //file the call paths of the program are written to as folded stacks, NULL for no call graph
+    char * foldedFile;
+
+    //file the pipeline registers are traced to each cycle, NULL for no trace, and the
+    //cycles it keeps, the last ones of the run, 0 for all of them
+    char * traceFile;
+    unsigned long long traceCycles;
+} configType;
+
+//one set of pipeline registers
+typedef struct
+{
+    fregister F;
+    dregister D;
+    eregister E;
+    mregister M[MAXMEMSTAGES];
+    wregister W;
+} pipelineType;
+
+struct yess_machine
+{
+    //pipeline registers, the stages read cur and write next during a clock
+    //cycle and the two are swapped at the end of it
+    pipelineType latches[2];
+    pipelineType * cur;
+    pipelineType * next;
+
+    //program registers and the condition codes, CC is out of date while
+    //lazyCC.pending is set and is only read through getFlags and getCC
+    unsigned int registers[REGSIZE];
+    unsigned int CC;
+    lazyCCType lazyCC;
+
+    //values passed between the stages each clock cycle
+    signalType signals;
+
+    memoryType memory;
+    predecodeCacheType predecode;
+
+    configType config;
+    predictorType predictor;
+    cacheType icache;
+    cacheType dcache;
+    dramType dram;
+    storeBufferType storeBuffer;
+    prefetcherType prefetcher;
+
+    //clock cycles the pipeline has run the program for
+    unsigned long long cycles;
+    countersType counters;
+    profileType profile;
+    callGraphType callGraph;
+    traceType trace;
+    reuseType reuse;
+
+    //where dumps and messages about the program are written
+    FILE * out;
+};
+
+//a way of simulating the loaded program
+typedef struct
+{
+    char * name;
+
+    //simulates the program and returns how many of counted it took
+    unsigned long long (* run)(machineType * machine);
+    char * counted;
+} engineType;
+
+//prototypes
+machineType * newMachine();
+void freeMachine(machineType * machine);
+void initializeMachine(machineType * machine);
+unsigned long long runMachine(machineType * machine);
+void reportStatistics(machineType * machine);
+const engineType * findEngine(char * name);
+#endif
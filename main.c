@@ -1,74 +1,622 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "bool.h"
+#include <string.h>
+#include <unistd.h>
+#include "machine.h"
 #include "tools.h"
-#include "memory.h"
+#include "loader.h"
 #include "dump.h"
-#include "forwarding.h"
-#include "status.h"
-#include "bubbling.h"
+#include "batch.h"
+#include "translate.h"
 
 //prototypes
-void initialize();
-forwardType forwarded; 
-statusType status;
-bubbleType bubble;
-
-/* The main driver for the program.  Initializes the registers and function
- * pointer array for the execute stage.  Loads the program into the simulated
- * memory.  Simultes execution of the pipeline by calling the different stages
- * in the appropriate order and passing the required structs.
+unsigned long long parseSize(char * text);
+bool parseGeometry(char * text, configType * config);
+bool parseCache(char * text, cacheConfigType * config);
+bool parseDram(char * text, dramConfigType * config);
+bool parsePrefetcher(char * text, configType * config);
+unsigned int parseLines(char * text);
+bool parseTrace(char * text, configType * config);
+bool saveCounters(machineType * machine, char * fileName);
+bool saveFolded(machineType * machine);
+
+/* The main driver for the program.  Reads the command line options and
+ * creates a machine with cleared memory and registers.  Loads the program
+ * into the machine's memory and simulates its execution through the
+ * pipeline.
+ *
+ * When more than one program is given, or a manifest of programs, the
+ * programs are simulated in batch mode on a pool of threads.
+ *
+ * With -t the program is translated into C instead, which compiled and
+ * linked with every object of yess but main.o (make <filename>.aot) runs
+ * the program natively.
+ *
+ * usage: yess [-e <engine>] [-m <memory size>] [-p <predictor>] [-r <depth>] [-g <geometry>]
+ *             [-i <cache>] [-d <cache>] [-f <prefetcher>] [-D <dram>] [-s <entries>]
+ *             [-u <line sizes>] [-c <file>] [-a] [-F <file>] [-T <file>[,<cycles>]] [-L] <filename>.yo
+ *        yess [-m <memory size>] -t <output>.c <filename>.yo
+ *        yess -X <format> <trace file>
+ *        yess [-e <engine>] [-m <memory size>] [-p <predictor>] [-r <depth>] [-g <geometry>]
+ *             [-i <cache>] [-d <cache>] [-f <prefetcher>] [-D <dram>] [-s <entries>]
+ *             [-u <line sizes>] [-c <file>] [-a] [-F <file>] [-L] [-j <threads>] [-o <directory>]
+ *             [-b <manifest>] <filename>.yo ...
+ *        -e selects how the program is simulated:
+ *           pipeline   - the five stage pipeline, counts clock cycles (default)
+ *           functional - one whole instruction at a time, counts instructions
+ *           threaded   - translates the program into threaded code, counts
+ *                        instructions
+ *           jit        - translates the program into x86-64 code, counts
+ *                        instructions
+ *        -m sets the bytes of memory the program may address (default 4K),
+ *           a K, M or G suffix may be used, e.g. -m 16M or -m 4G
+ *        -p selects how the pipeline predicts conditional jumps and reports
+ *           how often each jump was predicted correctly:
+ *           taken   - always taken (default)
+ *           btfnt   - backward taken, forward not taken
+ *           bimodal - a 2-bit counter per jump
+ *           gshare  - 2-bit counters indexed by the PC xor the global history
+ *           perfect - what the jump does, found by running the program ahead
+ *        -r gives the pipeline a return address stack of 1 to 256 entries,
+ *           so fetch doesn't wait for a ret to read its address, and reports
+ *           how often the stack predicted a ret correctly
+ *        -g sets the geometry of the pipeline as <fetch>,<memory>,<alu>,<latency>:
+ *           the number of fetch stages (1 to 16), the number of memory stages
+ *           (1 to 8), the cycles an OPL takes in the execute stage and the
+ *           cycles a memory access takes (1 to 64).  The default is 1,1,1,1,
+ *           the five stage pipeline.
+ *        -i and -d give the pipeline an L1 instruction or data cache and report
+ *           its hits, misses, evictions and writebacks.  The cache is given as
+ *           <size>,<ways>,<line size>,<replacement>,<write policy>,<miss latency>,
+ *           e.g. -d 4K,2,32,lru,wb,20:
+ *           size, ways and line size are powers of two, the size may have a K
+ *           or M suffix and lines are at least 4 bytes
+ *           replacement is lru, plru (tree pseudo-LRU) or random
+ *           write policy is wb (write-back, allocating on a store miss) or
+ *           wt (write-through, not allocating)
+ *           miss latency is the cycles a miss, a write-through store or the
+ *           write back of a dirty line adds, 0 to 1000
+ *        -f prefetches into the data cache, which -d has to give, and reports
+ *           the accuracy, coverage and timeliness of the prefetches.  The
+ *           prefetcher is given as <prefetcher>[,<degree>], e.g. -f stride,2:
+ *           nextline - the lines after the line each load reads
+ *           stride   - the addresses a load reads next once it has repeated
+ *                      its stride, for each load by its PC
+ *           degree is how many lines ahead, 1 to 8 (default 1)
+ *        -D puts DRAM behind the caches, the lines they fill and write back and
+ *           the stores they write through wait for it instead of the miss
+ *           latency, without a cache every access does.  It reports the row
+ *           buffer hit rate and the average latency of a request.  The DRAM is
+ *           given as <banks>,<row size>,<tCAS>,<tRCD>,<tRP>, e.g. -D 8,2K,11,11,11:
+ *           banks (up to 64) and row size (16 bytes to 64K) are powers of two
+ *           tCAS, tRCD and tRP are the cycles to access the open row, to open a
+ *           row and to close one, 1 to 200
+ *        -s gives the pipeline a store buffer of 1 to 64 entries: a store takes
+ *           the memory latency and is written through the data cache in the
+ *           background, a load of a word in the buffer is forwarded from it.
+ *           A store waits while the buffer is full and a load that only partly
+ *           overlaps a store in it waits for the store.  It reports the
+ *           occupancy of the buffer and how many loads were forwarded
+ *        -u reports the miss ratio curves of fully associative LRU caches of
+ *           every size for the instructions and the data the pipeline reads,
+ *           from one run.  The line sizes are powers of two from 4 to 4096,
+ *           e.g. -u 16,32,64
+ *        -c writes the counters of the pipeline to a file as JSON, - for
+ *           stdout, once the program stops: the clock cycles, the retired
+ *           instructions, by icode, and the CPI, and for each of the F, D, E, M
+ *           and W registers the cycles it was stalled and bubbled by the cause,
+ *           load-use, ret, mispredict, exception, ret-miss (the return address
+ *           stack was wrong), fetch (the fetch stages or the instruction cache),
+ *           execute (a slow OPL) or memory (a slow access).  A batch writes an
+ *           array with the counters of every program it loaded
+ *        -a profiles each instruction of the program and writes the source the
+ *           .yo file has after the '|' with the profile next to each instruction:
+ *           its share of the cycles, the times it retired, the cycles from the
+ *           instruction before it retiring to it retiring, the cycles it was
+ *           held in a stalled pipeline register and the bubbles it caused, by
+ *           the causes -c gives
+ *        -F follows the calls and rets the program makes and reports the cycles
+ *           and instructions of each function, inclusive and exclusive of the
+ *           functions it calls.  The call paths are written to a file, - for
+ *           stdout, in the folded stack format flame graphs are drawn from.
+ *           Functions are named by their labels in the .yo file.  A batch puts
+ *           the name of the program before the paths of each program
+ *        -T traces the pipeline to a binary file: each clock cycle, the
+ *           instruction each of the F, D, E, M and W registers holds and whether
+ *           it was stalled or bubbled, by the causes -c gives.  The cycles are
+ *           written out as they are simulated, so a trace of any length takes
+ *           little memory.  Given a number of cycles, which may have a K, M or G
+ *           suffix, the file only keeps the last of them, e.g. -T run.trc,1M,
+ *           otherwise it keeps every cycle.  Only one program can be traced
+ *        -X exports a trace file to stdout as a pipeline diagram:
+ *           konata - the log of the Konata pipeline viewer
+ *           chrome - Chrome trace events, for chrome://tracing or Perfetto,
+ *                    a track per register with a microsecond per cycle
+ *        -L writes every event the tracepoints of the pipeline stages see to the
+ *           output of the program, with the clock cycle: the instructions
+ *           fetched, where decode got each source, the bubbles, the loads and
+ *           stores, the registers written, the dumps and the halt.  Only
+ *           yess-instrumented (make yess-instrumented) has the tracepoints, they
+ *           are compiled out of yess
+ *        -j sets the number of threads of a batch, 1 to 1024 (default one per core)
+ *        -o writes the output of each program of a batch to
+ *           <directory>/<filename>.dump instead of stdout
+ *        -b adds the programs listed one per line in a manifest to the batch
+ *        -t writes the program translated into C to <output>.c
  */ 
 int main(int argc, char * args[])
 {
-    //Initializes the registers and function pointer array
-    initialize();
-    initializeFuncPtrArray();
+    int opt;
+    unsigned long long memSize = MEMSIZE;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char * outDir = NULL;
+    char ** files = NULL;
+    int count = 0, listed;
+    char * end;
+    long number;
+    bool batch = FALSE;
+    char * translation = NULL;
+    const engineType * engine = findEngine(NULL);
+    int traceFormat = -1;
+    bool logged = FALSE;
+    //the five stage pipeline predicting taken, with every option not named here off
+    configType config = {.predictor = PREDTAKEN, .fetchStages = 1, .memoryStages = 1, .aluLatency = 1,
+                         .memLatency = 1};
 
-    //loads the program into the simulated memory
-    bool loaded = !load(argc, args);
+    while((opt = getopt(argc, args, "e:m:p:r:g:i:d:f:D:s:u:c:aF:T:X:Lj:o:b:t:")) != -1){
+        switch(opt){
+            case 'e':
+                engine = findEngine(optarg);
+                if(engine == NULL){
+                    printf("unknown engine %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'm':
+                memSize = parseSize(optarg);
+                break;
+            case 'p':
+                config.predictor = findPredictor(optarg);
+                if(config.predictor == -1){
+                    printf("unknown predictor %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 'r':
+                config.rasDepth = atoi(optarg);
+                if(config.rasDepth < 1 || config.rasDepth > RASMAXDEPTH){
+                    printf("invalid return address stack depth %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 'g':
+                if(!parseGeometry(optarg, &config)){
+                    printf("invalid pipeline geometry %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'i':
+            case 'd':
+                if(!parseCache(optarg, opt == 'i' ? &config.icache : &config.dcache)){
+                    printf("invalid cache %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 'f':
+                if(!parsePrefetcher(optarg, &config)){
+                    printf("invalid prefetcher %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 'D':
+                if(!parseDram(optarg, &config.dram)){
+                    printf("invalid DRAM %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 's':
+                config.storeBuffer = atoi(optarg);
+                if(config.storeBuffer < 1 || config.storeBuffer > MAXSTOREBUFFER){
+                    printf("invalid store buffer size %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 'u':
+                config.reuseLines = parseLines(optarg);
+                if(config.reuseLines == 0){
+                    printf("invalid line sizes %s\n", optarg);
+                    exit(1);
+                }
+                config.report = TRUE;
+                break;
+            case 'c':
+                config.countersFile = optarg;
+                break;
+            case 'a':
+                config.profile = TRUE;
+                config.report = TRUE;
+                break;
+            case 'F':
+                config.foldedFile = optarg;
+                config.report = TRUE;
+                break;
+            case 'T':
+                if(!parseTrace(optarg, &config)){
+                    printf("invalid trace %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'X':
+                traceFormat = findTraceFormat(optarg);
+                if(traceFormat == -1){
+                    printf("unknown trace format %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'L':
+                if(!logTracepoints()){
+                    printf("the tracepoints are only compiled into yess-instrumented\n");
+                    exit(1);
+                }
+                logged = TRUE;
+                break;
+            case 'j':
+                number = strtol(optarg, &end, 10);
+                if(end == optarg || *end != '\0' || number < 1 || number > MAXTHREADS){
+                    printf("invalid number of threads %s\n", optarg);
+                    exit(1);
+                }
+                threads = number;
+                break;
+            case 'o':
+                outDir = optarg;
+                break;
+            case 'b':
+                listed = count;
+                files = readManifest(optarg, files, &count);
+                if(files == NULL){
+                    printf("unable to read manifest %s\n", optarg);
+                    exit(1);
+                }
+                if(count == listed){
+                    printf("manifest %s is empty\n", optarg);
+                    exit(1);
+                }
+                batch = TRUE;
+                break;
+            case 't':
+                translation = optarg;
+                break;
+            default:
+                printf("usage: yess [-e <engine>] [-m <memory size>] [-p <predictor>] [-r <depth>]\n"
+                       "            [-g <geometry>] [-i <cache>] [-d <cache>] [-f <prefetcher>] [-D <dram>]\n"
+                       "            [-s <entries>] [-u <line sizes>] [-c <file>] [-a] [-F <file>]\n"
+                       "            [-T <file>[,<cycles>]] [-L] [-j <threads>] [-o <directory>] [-b <manifest>]\n"
+                       "            <filename>.yo ...\n"
+                       "       yess [-m <memory size>] -t <output>.c <filename>.yo\n"
+                       "       yess -X <format> <trace file>\n");
+                exit(1);
+        }
+    }
+
+    //export a trace instead of simulating a program
+    if(traceFormat != -1){
+        if(argc - optind != 1){
+            printf("give one trace file to export\n");
+            exit(1);
+        }
+        if(!exportTrace(args[optind], traceFormat, stdout)){
+            printf("unable to read the trace %s\n", args[optind]);
+            exit(1);
+        }
+        exit(0);
+    }
+
+    if(config.prefetcher != PREFNONE && config.dcache.size == 0){
+        printf("a prefetcher needs a data cache\n");
+        exit(1);
+    }
+    if((config.countersFile != NULL || config.profile || config.foldedFile != NULL ||
+        config.traceFile != NULL || logged) && engine != findEngine("pipeline")){
+        printf("the counters, the profile, the call graph and the traces need the pipeline engine\n");
+        exit(1);
+    }
+    if(config.traceFile != NULL && (batch || argc - optind > 1)){
+        printf("only one program can be traced\n");
+        exit(1);
+    }
+
+    machineType * machine = newMachine();
+    if(machine == NULL){
+        printf("Unable to allocate the machine\n");
+        exit(1);
+    }
+    if(!setMemorySize(machine, memSize)){
+        printf("invalid memory size %llu\n", memSize);
+        exit(1);
+    }
+    machine->config = config;
+
+    //simulate every program given in batch mode
+    if(translation == NULL && (batch || argc - optind > 1)){
+        freeMachine(machine);
+        files = realloc(files, (count + argc - optind) * sizeof(char *));
+        for(; optind < argc; optind++) files[count++] = args[optind];
+        exit(runBatch(files, count, threads, memSize, &config, outDir, engine) != 0);
+    }
+
+    //loads the program into the simulated memory, load expects the file
+    //name to follow the program name so skip past the options
+    args[optind - 1] = args[0];
+    bool loaded = !load(machine, argc - optind + 1, args + optind - 1);
 
     //If the load was unsuccessfull, dump the memory and exit
     if(!loaded){
-        dumpMemory();     
+        dumpMemory(machine);     
         exit(0);
     }
     
-    //clock cycle counter
-    int clockCount = 0;
-    bool stop = FALSE;
-
-    //simulate execution of the program through the pipeline
-    while(!stop){
-        stop = writebackStage(&forwarded, &status);
-        memoryStage(&status, &forwarded, &bubble);
-        executeStage(status, &forwarded, &bubble);
-        decodeStage(forwarded, &bubble);
-        fetchStage(forwarded, bubble);
-        clockCount++;
+    //translate the program into C instead of simulating it
+    if(translation != NULL){
+        FILE * out = fopen(translation, "w");
+        if(out == NULL || translateProgram(machine, args[optind], out)){
+            printf("unable to translate %s into %s\n", args[optind], translation);
+            exit(1);
+        }
+        fclose(out);
+        freeMachine(machine);
+        exit(0);
     }
 
-    printf("\nTotal clock cycles = %d\n", clockCount);
+    //simulate execution of the program with the selected engine
+    unsigned long long total = engine->run(machine);
 
+    printf("\nTotal %s = %llu\n", engine->counted, total);
+    reportStatistics(machine);
+    if(config.countersFile != NULL && !saveCounters(machine, args[optind])){
+        printf("unable to write the counters to %s\n", config.countersFile);
+        exit(1);
+    }
+    if(config.foldedFile != NULL && !saveFolded(machine)){
+        printf("unable to write the call graph to %s\n", config.foldedFile);
+        exit(1);
+    }
+    freeMachine(machine);
 }
 
-/* Function Name: initialize
- * Purpose:       Clear the memory and registers in preparation for
- *                running a new program.
+/* Function Name: parseSize
+ * Purpose:       Converts a size given on the command line to a number of bytes
  *
- * Parameters:    -
- * Returns:       -
+ * Parameters:    text - number of bytes, optionally followed by K, M or G
+ * Returns:       the size in bytes, 0 if the text isn't a valid size
  * Modifies:      -
  */
-void initialize()
+unsigned long long parseSize(char * text)
 {
-    clearMemory();
-    clearRegisters();
-    clearFregister();
-    clearDregister();
-    clearEregister();
-    clearMregister();
-    clearWregister();
+    char * end;
+    unsigned long long size = strtoull(text, &end, 0);
+
+    switch(*end){
+        case 'k':
+        case 'K':
+            size <<= 10;
+            end++;
+            break;
+        case 'm':
+        case 'M':
+            size <<= 20;
+            end++;
+            break;
+        case 'g':
+        case 'G':
+            size <<= 30;
+            end++;
+            break;
+    }
+    if(*end != '\0') return 0;
+    return size;
 }
 
+/* Function Name: parseGeometry
+ * Purpose:       Reads the geometry of the pipeline given on the command line
+ *
+ * Parameters:    text - <fetch stages>,<memory stages>,<alu latency>,<memory latency>
+ *                config - gets the geometry
+ * Returns:       TRUE if the geometry is valid, FALSE otherwise
+ * Modifies:      config, only if the geometry is valid
+ */
+bool parseGeometry(char * text, configType * config)
+{
+    int fetch, memory, alu, latency;
+    char extra;
+
+    if(sscanf(text, "%d,%d,%d,%d%c", &fetch, &memory, &alu, &latency, &extra) != 4) return FALSE;
+    if(fetch < 1 || fetch > MAXFETCHSTAGES || memory < 1 || memory > MAXMEMSTAGES) return FALSE;
+    if(alu < 1 || alu > MAXLATENCY || latency < 1 || latency > MAXLATENCY) return FALSE;
 
+    config->fetchStages = fetch;
+    config->memoryStages = memory;
+    config->aluLatency = alu;
+    config->memLatency = latency;
+    return TRUE;
+}
+
+/* Function Name: parseCache
+ * Purpose:       Reads the shape of a cache given on the command line
+ *
+ * Parameters:    text - <size>,<ways>,<line size>,<replacement>,<write policy>,<miss latency>
+ *                config - gets the shape
+ * Returns:       TRUE if the cache is valid, FALSE otherwise
+ * Modifies:      config, only if the cache is valid
+ */
+bool parseCache(char * text, cacheConfigType * config)
+{
+    char size[32], replacement[16], write[16];
+    unsigned long long bytes;
+    cacheConfigType cache;
+    char extra;
+
+    if(sscanf(text, "%31[^,],%d,%d,%15[^,],%15[^,],%d%c", size, &cache.ways, &cache.lineSize,
+              replacement, write, &cache.missLatency, &extra) != 6) return FALSE;
+
+    bytes = parseSize(size);
+    if(bytes == 0 || bytes > (1 << 30)) return FALSE;
+    cache.size = bytes;
+
+    cache.replacement = findReplacement(replacement);
+    if(cache.replacement == -1) return FALSE;
+
+    if(strcmp(write, "wb") == 0) cache.writeBack = TRUE;
+    else if(strcmp(write, "wt") == 0) cache.writeBack = FALSE;
+    else return FALSE;
+
+    if(!validCache(&cache)) return FALSE;
+    *config = cache;
+    return TRUE;
+}
+
+/* Function Name: parseDram
+ * Purpose:       Reads the shape and timing of the DRAM given on the command line
+ *
+ * Parameters:    text - <banks>,<row size>,<tCAS>,<tRCD>,<tRP>
+ *                config - gets the DRAM
+ * Returns:       TRUE if the DRAM is valid, FALSE otherwise
+ * Modifies:      config, only if the DRAM is valid
+ */
+bool parseDram(char * text, dramConfigType * config)
+{
+    char size[32];
+    unsigned long long bytes;
+    dramConfigType dram;
+    char extra;
+
+    if(sscanf(text, "%d,%31[^,],%d,%d,%d%c", &dram.banks, size, &dram.tCAS, &dram.tRCD, &dram.tRP,
+              &extra) != 5) return FALSE;
+
+    bytes = parseSize(size);
+    if(bytes == 0 || bytes > MAXROWSIZE) return FALSE;
+    dram.rowSize = bytes;
+
+    if(!validDram(&dram)) return FALSE;
+    *config = dram;
+    return TRUE;
+}
+
+/* Function Name: parsePrefetcher
+ * Purpose:       Reads the prefetcher given on the command line
+ *
+ * Parameters:    text - <prefetcher>[,<degree>]
+ *                config - gets the prefetcher and its degree
+ * Returns:       TRUE if the prefetcher is valid, FALSE otherwise
+ * Modifies:      config, only if the prefetcher is valid
+ */
+bool parsePrefetcher(char * text, configType * config)
+{
+    char name[16];
+    int prefetcher, degree = 1;
+    char extra;
+
+    int fields = sscanf(text, "%15[^,],%d%c", name, &degree, &extra);
+    if(fields < 1 || fields > 2 || (fields == 1 && strchr(text, ',') != NULL)) return FALSE;
+    prefetcher = findPrefetcher(name);
+    if(prefetcher == -1 || degree < 1 || degree > MAXDEGREE) return FALSE;
+
+    config->prefetcher = prefetcher;
+    config->prefetchDegree = degree;
+    return TRUE;
+}
+
+/* Function Name: parseLines
+ * Purpose:       Reads the line sizes to profile the reuse distances of
+ *
+ * Parameters:    text - line sizes separated by commas
+ * Returns:       bit n set for each line size of 1 << n bytes, 0 if a size isn't
+ *                a power of two from 1 << MINREUSEBITS to 1 << MAXREUSEBITS
+ * Modifies:      -
+ */
+unsigned int parseLines(char * text)
+{
+    unsigned int lines = 0;
+    int size, bits, used;
+
+    while(sscanf(text, "%d%n", &size, &used) == 1){
+        for(bits = MINREUSEBITS; bits <= MAXREUSEBITS && (1 << bits) != size; bits++);
+        if(bits > MAXREUSEBITS) return 0;
+        lines |= 1 << bits;
+        text += used;
+        if(*text == '\0') return lines;
+        if(*text++ != ',') return 0;
+    }
+    return 0;
+}
+
+/* Function Name: parseTrace
+ * Purpose:       Reads the trace given on the command line
+ *
+ * Parameters:    text - <file>[,<cycles>], the comma and cycles are taken off
+ *                config - gets the trace file and the cycles it keeps
+ * Returns:       TRUE if the trace is valid, FALSE otherwise
+ * Modifies:      text, config, only if the trace is valid
+ */
+bool parseTrace(char * text, configType * config)
+{
+    char * comma = strrchr(text, ',');
+    unsigned long long cycles = 0;
+
+    if(comma != NULL){
+        cycles = parseSize(comma + 1);
+        if(cycles == 0) return FALSE;
+        *comma = '\0';
+    }
+    if(*text == '\0') return FALSE;
+
+    config->traceFile = text;
+    config->traceCycles = cycles;
+    return TRUE;
+}
+
+/* Function Name: saveCounters
+ * Purpose:       Writes the counters of the program the pipeline ran to the
+ *                file the configuration gives
+ *
+ * Parameters:    machine - machine that ran the program
+ *                fileName - the program
+ * Returns:       TRUE if they were written, FALSE if the file couldn't be
+ * Modifies:      -
+ */
+bool saveCounters(machineType * machine, char * fileName)
+{
+    bool toStdout = strcmp(machine->config.countersFile, "-") == 0;
+    FILE * out = toStdout ? stdout : fopen(machine->config.countersFile, "w");
+
+    if(out == NULL) return FALSE;
+    writeCounters(machine, fileName, out);
+    fprintf(out, "\n");
+    if(toStdout) return TRUE;
+    return fclose(out) == 0;
+}
+
+/* Function Name: saveFolded
+ * Purpose:       Writes the call paths of the program the pipeline ran to the
+ *                file the configuration gives, as folded stacks
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       TRUE if they were written, FALSE if the file couldn't be
+ * Modifies:      -
+ */
+bool saveFolded(machineType * machine)
+{
+    bool toStdout = strcmp(machine->config.foldedFile, "-") == 0;
+    FILE * out = toStdout ? stdout : fopen(machine->config.foldedFile, "w");
+
+    if(out == NULL) return FALSE;
+    writeFolded(machine, NULL, out);
+    if(toStdout) return TRUE;
+    return fclose(out) == 0;
+}
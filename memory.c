@@ -1,78 +1,159 @@
 #include <stdio.h>
-#include "bool.h"
+#include <stdlib.h>
+#include "machine.h"
 #include "tools.h"
-#include "memory.h"
-#include "registers.h"
 
 
 /*
  * Memory.c - container for memory. 
- * Memory will be stored in memArray[].
- * Memory is organized as 1024 four-byte words.
- * Access to memArray[] will only be permitted
- * via the fetch and store functions.
+ * Each machine's memory is organized as four-byte words grouped into pages
+ * of PAGESIZE bytes.  Pages are reached through a two level table
+ * (pageTable) and are only allocated the first time they are
+ * written, so a large address space costs nothing until it is used.
+ * Reading a page that was never written returns zeros.
+ * Access to the pages will only be permitted
+ * via the findPage and allocatePage functions.
+ * Every write tells the predecode cache which bytes changed.
  */
 
-static unsigned int memArray[MEMSIZE]; //Memory
+//prototypes of functions only called within this file
+static unsigned int * findPage(memoryType * memory, unsigned int address);
+static unsigned int * allocatePage(memoryType * memory, unsigned int address);
+static unsigned int loadWord(memoryType * memory, unsigned int index);
+static void storeWord(memoryType * memory, unsigned int index, unsigned int value);
 
-//MAKE THIS STATIC
-/* Function Name: fetch
- * Purpose:       Used by other functions to retrieve data from memory
+/* Function Name: setMemorySize
+ * Purpose:       Sets the number of bytes of memory the program may address
  *
- * Parameters:    address - address of data to retrieve
- *                memError - bool for memory errors
- * Returns:       unsigned int representing data
+ * Parameters:    machine - machine whose memory is used
+ *                size - size of memory in bytes, a multiple of 4 no larger
+ *                       than MAXMEMSIZE
+ * Returns:       TRUE if the size was valid, FALSE otherwise
+ * Modifies:      memLimit
+ */
+bool setMemorySize(machineType * machine, unsigned long long size)
+{
+    if(size < 4 || size > MAXMEMSIZE || (size % 4) != 0) return FALSE;
+    machine->memory.memLimit = (unsigned int)(size - 1);
+    return TRUE;
+}
+
+/* Function Name: getMemorySize
+ * Purpose:       Returns the number of bytes of memory the program may address
+ *
+ * Parameters:    machine - machine whose memory is used
+ * Returns:       size of memory in bytes
+ * Modifies:      none
+ */
+unsigned long long getMemorySize(machineType * machine)
+{
+    return (unsigned long long)machine->memory.memLimit + 1;
+}
+
+/* Function Name: findPage
+ * Purpose:       Looks up the page holding an address
+ *
+ * Parameters:    memory - memory of the machine
+ *                address - byte address within the page
+ * Returns:       pointer to the words of the page, NULL if it was never written
  * Modifies:      none
  */
-static unsigned int fetch(int address, bool * memError)
+static unsigned int * findPage(memoryType * memory, unsigned int address)
+{
+    unsigned int ** dir = memory->pageTable[address >> (PAGEBITS + PAGEDIRBITS)];
+    if(dir == NULL) return NULL;
+    return dir[(address >> PAGEBITS) & (PAGEDIRSIZE - 1)];
+}
+
+/* Function Name: allocatePage
+ * Purpose:       Looks up the page holding an address, allocating a zeroed
+ *                page (and its directory) if it doesn't exist yet
+ *
+ * Parameters:    memory - memory of the machine
+ *                address - byte address within the page
+ * Returns:       pointer to the words of the page
+ * Modifies:      pageTable
+ */
+static unsigned int * allocatePage(memoryType * memory, unsigned int address)
 {
-    //If the requested address isn't within boundaries...
-    if(address > 4095 || address < 0)
+    unsigned int dirIndex = address >> (PAGEBITS + PAGEDIRBITS);
+    unsigned int pageIndex = (address >> PAGEBITS) & (PAGEDIRSIZE - 1);
+
+    if(memory->pageTable[dirIndex] == NULL)
     {
-        *memError = TRUE;
-        return 0;
+        memory->pageTable[dirIndex] = calloc(PAGEDIRSIZE, sizeof(unsigned int *));
+        if(memory->pageTable[dirIndex] == NULL)
+        {
+            printf("Unable to allocate simulated memory\n");
+            exit(1);
+        }
     }
-    //if it is...
-    else 
+    if(memory->pageTable[dirIndex][pageIndex] == NULL)
     {
-        *memError = FALSE;
-        return memArray[address];
+        memory->pageTable[dirIndex][pageIndex] = calloc(PAGEWORDS, sizeof(unsigned int));
+        if(memory->pageTable[dirIndex][pageIndex] == NULL)
+        {
+            printf("Unable to allocate simulated memory\n");
+            exit(1);
+        }
     }
+    return memory->pageTable[dirIndex][pageIndex];
+}
+
+/* Function Name: isPageAllocated
+ * Purpose:       Determines if the page holding an address has ever been written
+ *
+ * Parameters:    machine - machine whose memory is used
+ *                address - byte address within the page
+ * Returns:       TRUE if the page exists, FALSE if it still reads as zeros
+ * Modifies:      none
+ */
+bool isPageAllocated(machineType * machine, unsigned int address)
+{
+    return findPage(&machine->memory, address) != NULL;
+}
+
+/* Function Name: loadWord
+ * Purpose:       Reads a word from memory without checking the bounds
+ *
+ * Parameters:    memory - memory of the machine
+ *                index - word index (byte address / 4) of the data
+ * Returns:       the word, 0 if its page was never written
+ * Modifies:      none
+ */
+static unsigned int loadWord(memoryType * memory, unsigned int index)
+{
+    unsigned int * page = findPage(memory, index << 2);
+    if(page == NULL) return 0;
+    return page[index & (PAGEWORDS - 1)];
 }
 
-//MAKE THIS STATIC
-/* Function Name: store
- * Purpose:       Used by other methods to store data in memory
+/* Function Name: storeWord
+ * Purpose:       Writes a word to memory without checking the bounds
  *
- * Parameters:    address - address in memory to store data
+ * Parameters:    memory - memory of the machine
+ *                index - word index (byte address / 4) of the data
  *                value - data to be stored
- *                memError - bool for memory errors
  * Returns:       none
- * Modifies:      memArray
+ * Modifies:      pageTable
  */
-static void store(int address, unsigned int value, bool * memError)
+static void storeWord(memoryType * memory, unsigned int index, unsigned int value)
 {
-    //If the address isn't within boundaries
-    if(address > 4095 || address < 0) *memError = TRUE;
-    //If it is
-    else 
-    {
-        *memError = FALSE;
-        memArray[address] = value;
-    }
+    allocatePage(memory, index << 2)[index & (PAGEWORDS - 1)] = value;
 }
 
 /* Function Name: getByte
  * Purpose:       Returns a byte of information from memory
  *
- * Parameters:    address - address of byte to retrieve
+ * Parameters:    machine - machine whose memory is used
+ *                address - address of byte to retrieve
  *                memError - bool for memory errors
  * Returns:       unsigned char representing byte of information
  * Modifies:      none
  */
-unsigned char getByte(int address, bool * memError){
+unsigned char getByte(machineType * machine, unsigned int address, bool * memError){
     //If the address isn't within boundaries
-    if(address > 4095 || address < 0)
+    if(address > machine->memory.memLimit)
     {
         *memError = TRUE;
         return 0;
@@ -81,86 +162,201 @@ unsigned char getByte(int address, bool * memError){
     else
     {
         *memError = FALSE;
-        //unsigned int byteAdd = (((unsigned int) &memArray) + address);
-        unsigned int fromMem = fetch(address/4, memError);        //Get the word
-        char toReturn = getByteNumber((address % 4), fromMem);  //Get the byte from the word
-        return toReturn;
+        //Get the word and shift the byte down from it
+        return (unsigned char)(loadWord(&machine->memory, address / 4) >> ((address % 4) * 8));
     }
 }
 
 /* Function Name: putByte
  * Purpose:       Store a byte of information in memory
  *
- * Parameters:    address - address in memory to store data
+ * Parameters:    machine - machine whose memory is used
+ *                address - address in memory to store data
  *                value - data to be stored
  *                memError - bool for memory errors
  * Returns:       none
- * Modifies:      memArray
+ * Modifies:      pageTable
  */
-void putByte(int address, unsigned char value, bool * memError){
+void putByte(machineType * machine, unsigned int address, unsigned char value, bool * memError){
     //If the address isn't within boundaries
-    if(address >  4095|| address < 0) *memError = TRUE;
+    if(address > machine->memory.memLimit) *memError = TRUE;
     //If it is
     else
     {
         *memError = FALSE;
-        unsigned int word = fetch((address / 4), memError);
+        unsigned int word = loadWord(&machine->memory, address / 4);
         word = putByteNumber((address % 4), value, word);
-        store((address / 4), word, memError);
+        storeWord(&machine->memory, (address / 4), word);
+        invalidatePredecode(machine, address, 1);
     }
 }
 
 /* Function Name: clearMemory
  * Purpose:       Clear the memory
  *
- * Parameters:    none
+ * Parameters:    machine - machine whose memory is used
  * Returns:       none
- * Modifies:      memArray - sets everything to 0
+ * Modifies:      pageTable - releases every page so all of memory reads as 0
+ *                predecode cache - emptied
  */
-void clearMemory(){
-    clearBuffer((char*) &memArray, (MEMSIZE * sizeof(unsigned int)));
+void clearMemory(machineType * machine){
+    int i, j;
+    unsigned int *** pageTable = machine->memory.pageTable;
+    for(i = 0; i < PAGEDIRSIZE; i++)
+    {
+        if(pageTable[i] == NULL) continue;
+        for(j = 0; j < PAGEDIRSIZE; j++) free(pageTable[i][j]);
+        free(pageTable[i]);
+        pageTable[i] = NULL;
+    }
+    clearPredecode(machine);
 }
 
 /* Function Name: getWord
- * Purpose:       Retrieve a word(4 bytes) of data from memory
+ * Purpose:       Retrieve a word(4 bytes) of data from memory.  Aligned words
+ *                are a single load, unaligned words are put together from
+ *                the two words they span.
  *
- * Parameters:    address - first byte of data to retrieve
+ * Parameters:    machine - machine whose memory is used
+ *                address - first byte of data to retrieve
  *                memError - bool for memory errors
  * Returns:       unsigned int representing word of data
  * Modifies:      none
  */
-unsigned int getWord(int address, bool * memError){
-    //Make sure the address is a multiple of 4
-    if((address % 4) != 0 || address < 0 || address > 4095) 
+unsigned int getWord(machineType * machine, unsigned int address, bool * memError){
+    //Make sure all 4 bytes are within boundaries
+    if(address > machine->memory.memLimit - 3) 
     {
         *memError = TRUE;
         return 0;
     }
+    *memError = FALSE;
+
     //If it is a multiple of four
-    else
-    {
-        *memError = FALSE;
-        //unsigned int word = fetch((address / 4), memError);
-        unsigned int word = getByte(address, memError) | (getByte(address+1, memError) << 8) | (getByte(address+2, memError) << 16) |
-                            getByte(address+3, memError) << 24;
-        return word;
-    }
+    if((address % 4) == 0) return loadWord(&machine->memory, address / 4);
+
+    //Otherwise take the high bytes of the first word and the low bytes of the next
+    unsigned int shift = (address % 4) * 8;
+    unsigned int low = loadWord(&machine->memory, address / 4);
+    unsigned int high = loadWord(&machine->memory, address / 4 + 1);
+    return (low >> shift) | (high << (32 - shift));
 }
 
 /* Function Name: putWord
- * Purpose:       Stores a word(4 bytes) of information in memory
+ * Purpose:       Stores a word(4 bytes) of information in memory.  Aligned
+ *                words are a single store, unaligned words are merged into
+ *                the two words they span.
  *
- * Parameters:    address - beginning address in memory to store data
+ * Parameters:    machine - machine whose memory is used
+ *                address - beginning address in memory to store data
  *                value - data to be stored
  *                memError - bool for memory errors
  * Returns:       none
- * Modifies:      memArray
+ * Modifies:      pageTable
  */
-void putWord(int address, unsigned int value, bool * memError){
-    if(address % 4 != 0) *memError = TRUE;
-    else
+void putWord(machineType * machine, unsigned int address, unsigned int value, bool * memError){
+    //Make sure all 4 bytes are within boundaries
+    if(address > machine->memory.memLimit - 3)
     {
-        *memError = FALSE;
-        store((address / 4), value, memError);
+        *memError = TRUE;
+        return;
+    }
+    *memError = FALSE;
+    invalidatePredecode(machine, address, 4);
+
+    //If it is a multiple of four
+    if((address % 4) == 0)
+    {
+        storeWord(&machine->memory, address / 4, value);
+        return;
+    }
+
+    //Otherwise replace the high bytes of the first word and the low bytes of the next
+    unsigned int shift = (address % 4) * 8;
+    unsigned int mask = 0xffffffff << shift;
+    unsigned int low = loadWord(&machine->memory, address / 4);
+    unsigned int high = loadWord(&machine->memory, address / 4 + 1);
+    storeWord(&machine->memory, address / 4, (low & ~mask) | (value << shift));
+    storeWord(&machine->memory, address / 4 + 1, (high & mask) | (value >> (32 - shift)));
+}
+
+/* Function Name: copyIn
+ * Purpose:       Stores a block of bytes in memory
+ *
+ * Parameters:    machine - machine whose memory is used
+ *                address - address in memory of the first byte
+ *                buffer - bytes to be stored
+ *                length - number of bytes to store
+ *                memError - bool for memory errors, nothing is stored if
+ *                           the block doesn't fit in memory
+ * Returns:       none
+ * Modifies:      pageTable
+ */
+void copyIn(machineType * machine, unsigned int address, unsigned char * buffer, unsigned int length,
+    bool * memError){
+    //Make sure the whole block is within boundaries
+    if(length > 0 && (unsigned long long)address + length - 1 > machine->memory.memLimit)
+    {
+        *memError = TRUE;
+        return;
+    }
+    *memError = FALSE;
+    invalidatePredecode(machine, address, length);
+
+    while(length > 0)
+    {
+        //copy up to the end of the page with a single page lookup
+        unsigned int * page = allocatePage(&machine->memory, address);
+        unsigned int offset = address & (PAGESIZE - 1);
+        unsigned int count = PAGESIZE - offset;
+        if(count > length) count = length;
+
+        address += count;
+        length -= count;
+        for(; count > 0; count--, offset++, buffer++)
+            page[offset / 4] = putByteNumber(offset % 4, *buffer, page[offset / 4]);
+    }
+}
+
+/* Function Name: copyOut
+ * Purpose:       Retrieves a block of bytes from memory
+ *
+ * Parameters:    machine - machine whose memory is used
+ *                address - address in memory of the first byte
+ *                buffer - filled with the bytes read
+ *                length - number of bytes to read
+ *                memError - bool for memory errors, nothing is read if
+ *                           the block doesn't fit in memory
+ * Returns:       none
+ * Modifies:      buffer
+ */
+void copyOut(machineType * machine, unsigned int address, unsigned char * buffer, unsigned int length,
+    bool * memError){
+    //Make sure the whole block is within boundaries
+    if(length > 0 && (unsigned long long)address + length - 1 > machine->memory.memLimit)
+    {
+        *memError = TRUE;
+        return;
+    }
+    *memError = FALSE;
+
+    while(length > 0)
+    {
+        //copy up to the end of the page with a single page lookup
+        unsigned int * page = findPage(&machine->memory, address);
+        unsigned int offset = address & (PAGESIZE - 1);
+        unsigned int count = PAGESIZE - offset;
+        if(count > length) count = length;
+
+        address += count;
+        length -= count;
+        if(page == NULL) clearBuffer((char *) buffer, count);
+        else
+        {
+            unsigned int i;
+            for(i = 0; i < count; i++, offset++)
+                buffer[i] = (unsigned char)(page[offset / 4] >> ((offset % 4) * 8));
+        }
+        buffer += count;
     }
 }
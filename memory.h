@@ -1,16 +1,39 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
-//used simulate the memory used by the program, 1024 indices of 4 bytes
-#define MEMSIZE 1024
+//default size of the simulated memory in bytes (1024 words of 4 bytes)
+#define MEMSIZE 4096
+
+//largest memory that can be simulated (the full 32-bit address space)
+#define MAXMEMSIZE 0x100000000ULL
+
+//memory is split into pages of PAGESIZE bytes that are allocated on first write
+#define PAGEBITS 12
+#define PAGESIZE (1 << PAGEBITS)
+#define PAGEWORDS (PAGESIZE / 4)
+
+//pages are found through a two level table, PAGEDIRSIZE entries at each level
+#define PAGEDIRBITS 10
+#define PAGEDIRSIZE (1 << PAGEDIRBITS)
+
+//struct holding the simulated memory of a machine
+typedef struct
+{
+    unsigned int ** pageTable[PAGEDIRSIZE];
+    unsigned int memLimit;    //highest valid byte address
+} memoryType;
 
 //prototypes
-static unsigned int fetch(int address, bool * memError);
-static void store(int address, unsigned int value, bool * memError);
-unsigned char getByte(int address, bool * memError);
-void putByte(int address, unsigned char value, bool * memError);
-void clearMemory();
-unsigned int getWord(int address, bool * memError);
-void putWord(int address, unsigned int value, bool * memError);
+unsigned char getByte(machineType * machine, unsigned int address, bool * memError);
+void putByte(machineType * machine, unsigned int address, unsigned char value, bool * memError);
+void clearMemory(machineType * machine);
+unsigned int getWord(machineType * machine, unsigned int address, bool * memError);
+void putWord(machineType * machine, unsigned int address, unsigned int value, bool * memError);
+void copyIn(machineType * machine, unsigned int address, unsigned char * buffer, unsigned int length,
+    bool * memError);
+void copyOut(machineType * machine, unsigned int address, unsigned char * buffer, unsigned int length,
+    bool * memError);
+bool setMemorySize(machineType * machine, unsigned long long size);
+unsigned long long getMemorySize(machineType * machine);
+bool isPageAllocated(machineType * machine, unsigned int address);
 #endif 
-
@@ -1,180 +1,192 @@
-#include "bool.h"
-#include "status.h"
-#include "forwarding.h"
-#include "bubbling.h"
-#include "memoryStage.h"
+#include "machine.h"
 #include "tools.h"
 #include "instructions.h"
-#include "writebackStage.h"
-#include "registers.h"
+#include "opcodes.h"
 
-//M register holds the input for the memory stage
-//It is only accessible from this file. (static)
-static mregister M;
+//A machine's M registers hold the input for the memory stages, there are
+//config.memoryStages of them and memory is only accessed in the last one.
+//They are only accessed from this file, the stages read cur->M and write next->M
+//and next->W, the execute stage writes next->M[0].
 
 //prototypes
-bool W_stall(statusType status);
-bool setReadSig();
-bool setWriteSig();
-unsigned int selectMemAddress();
+bool W_stall(machineType * machine);
 
 /* Function Name: memoryStage
- * Purpose:       Simulate the memory stage of pipeline execution
+ * Purpose:       Simulate the memory stages of pipeline execution
  *
- * Parameters:    status - pointer to a struct with status information for the memory and writeback stages
- *                forwarded - pointer to a struct containing values used for forwarding
- *                bubble - pointer to a struct containing values used for bubbling/stalling
+ * Parameters:    machine - machine being simulated
+ *                signals - gets the status and value read by the last stage
  * Returns:       -
- * Modifies:      Values in the status, forwarded, and bubble structs
+ * Modifies:      next M and W registers, signals->m_stat, signals->m_valM,
+ *                signals->m_retMiss, signals->m_busy
  */
-void memoryStage(statusType *status, forwardType *forwarded, bubbleType *bubble){
+void memoryStage(machineType * machine, signalType * signals){
+    int last = machine->config.memoryStages - 1;
+    mregister * M = &machine->cur->M[last];
+    int i;
+
+    //the descriptor's address selector indexes this array
+    const opcodeType * op = &opcodeTable[OPCODE(M->icode, 0)];
+    unsigned int addrs[3];
+    addrs[ADDRNONE] = 0;
+    addrs[ADDRVALE] = M->valE;
+    addrs[ADDRVALA] = M->valA;
 
     //gets the needed address in memory
-	unsigned int memAddress = selectMemAddress();
+	unsigned int memAddress = addrs[op->memAddr];
+
+    //an access takes memLatency cycles and the cycles the data cache adds, worked out
+    //when it reaches the last stage, the instructions before it wait in their stages.
+    //With a store buffer stores and the loads it forwards to don't go to the cache, and
+    //an access the buffer blocks waits without starting
+    bool access = (op->memRead || op->memWrite) && M->stat == SAOK;
+    bool blocked = access && M->cycles == 0 && storeBlocks(machine, memAddress, op->memWrite);
+    unsigned int latency = M->latency;
+    if(access && M->cycles == 0 && !blocked){
+        reuseData(machine, memAddress);
+        if((op->memWrite && machine->config.storeBuffer > 0) || (op->memRead && forwardStore(machine, memAddress)))
+            latency = machine->config.memLatency;
+        else latency = machine->config.memLatency + dataDelay(machine, memAddress, op->memWrite);
+        if(op->memRead && machine->config.prefetcher != PREFNONE) trainPrefetcher(machine, M->pc, memAddress);
+    }
+    signals->m_busy = blocked || (access && (M->cycles + 1 < latency || !dataReady(machine)));
+    if(signals->m_busy){
+        signals->m_stat = SAOK;
+        signals->m_valM = 0;
+        signals->m_retMiss = FALSE;
+        for(i = 0; i <= last; i++) machine->next->M[i] = machine->cur->M[i];
+        if(!blocked) machine->next->M[last].cycles++;
+        machine->next->M[last].latency = latency;
+        countStall(machine, STAGEM, CAUSEMEMORY);
+        if(W_stall(machine)){
+            machine->next->W = machine->cur->W;
+            countStall(machine, STAGEW, CAUSEEXCEPTION);
+        }else{
+            updateWregister(machine, SAOK, INOP, 0, 0, RNONE, RNONE, NOPC, FALSE);
+            countBubble(machine, STAGEW, CAUSEMEMORY);
+            TRACEPOINT(TPBUBBLE, machine, NOPC, STAGEW, CAUSEMEMORY);
+        }
+        return;
+    }
 
-	unsigned int m_stat = M.stat;
+	unsigned int m_stat = M->stat;
 	bool memError = FALSE;
-	unsigned int m_valM = M.valA;
+	unsigned int m_valM = M->valA;
 
     //checks if memory will be read from
-	if(setReadSig())
+	if(op->memRead)
 	{
         //reads the value from memory and checks for a memory address error
-		m_valM = getWord(memAddress, &memError);
+		m_valM = getWord(machine, memAddress, &memError);
 		if(memError) m_stat = SADR;
+        else TRACEPOINT(TPREAD, machine, M->pc, memAddress, m_valM);
 	}
     //checks if memory will be written to
-	else if(setWriteSig())
+	else if(op->memWrite)
 	{
         //writes the value of m_valM to memory and checks for a memory address error
-		putWord(memAddress, m_valM, &memError);
+		putWord(machine, memAddress, m_valM, &memError);
 		if(memError) m_stat = SADR;
+        else{
+            TRACEPOINT(TPWRITE, machine, M->pc, memAddress, m_valM);
+            if(machine->config.storeBuffer > 0) bufferStore(machine, memAddress);
+        }
 	}
 
-    //sets the appropriate value in the status struct
-    status->m_stat = m_stat;
-
-    //sets the appropriate values in the forwarded struct
-    forwarded->M_valE = M.valE;
-    forwarded->m_valM = m_valM;
-    forwarded->M_dstM = M.dstM;
-    forwarded->M_dstE = M.dstE;
-    forwarded->M_Cnd = M.Cnd;
-    forwarded->M_icode = M.icode;
-    forwarded->M_valA = M.valA;
-
-    //sets the appropriate value in the bubble struct
-    bubble->M_icode = M.icode;
+    //a ret predicted by the return address stack is checked against the address it read,
+    //the instructions fetched after a wrong prediction are squashed and the condition
+    //codes they set are put back
+    bool retHit = M->predTaken && m_valM == M->predPC;
+    if(M->icode == IRET && m_stat == SAOK && machine->config.rasDepth > 0)
+        resolveReturn(machine, M->predTaken, retHit);
+
+    //sets the appropriate values in the signals for forwarding and bubbling
+    signals->m_stat = m_stat;
+    signals->m_valM = m_valM;
+    signals->m_retMiss = (M->icode == IRET && m_stat == SAOK && M->predTaken && !retHit);
+    if(signals->m_retMiss) setFlags(machine, M->cc);
+
+    //the instructions in the earlier memory stages move on a stage
+    for(i = last; i > 0; i--){
+        if(signals->m_retMiss) updateMregister(machine, i, SAOK, INOP, 0, 0, 0, RNONE, RNONE, NOPC, FALSE, 0, 0);
+        else machine->next->M[i] = machine->cur->M[i - 1];
+    }
 
     //checks if the W register should be stalled and updates the W register accordingly
-	if(!W_stall(*status)) updateWregister(m_stat, M.icode, M.valE, m_valM, M.dstE, M.dstM);
-}
-
-/* Function Name: selectMemAddress
- * Purpose:       Returns the the appropriate value representing the needed address in memory
- *
- * Parameters:    -
- * Returns:       The address in memory required
- * Modifies:      -
- */
-unsigned int selectMemAddress()
-{
-    //returns the appropriate address based on the icode
-	switch(M.icode)
-	{
-		case IRMMOVL:
-		case IMRMOVL:
-		case IPUSHL:
-		case ICALL:
-		    return M.valE;
-		case IPOPL:
-		case IRET:
-		  	return  M.valA;
+	if(W_stall(machine)){
+        machine->next->W = machine->cur->W;
+        countStall(machine, STAGEW, CAUSEEXCEPTION);
     }
-
-    //if a memory address is not needed, return 0
-	return 0;
-}
-
-/* Function Name: setReadSig
- * Purpose:       Determines if memory will be read from in this stage
- *
- * Parameters:    -
- * Returns:       TRUE if memory is read from, FALSE otherwise
- * Modifies:      -
- */
-bool setReadSig()
-{
-    //readsig is based on icode
-	if(M.icode == IMRMOVL || M.icode == IPOPL || M.icode == IRET) return TRUE;
-	else return FALSE;
-}
-
-/* Function Name: setWriteSig
- * Purpose:       Determines if memory will be written to in this stage
- *
- * Parameters:    -
- * Returns:       TRUE if memory will be written to, FALSE otherwise
- * Modifies:      -
- */
-bool setWriteSig()
-{
-    //writesig is based on icode
-	if(M.icode == IRMMOVL || M.icode == IPUSHL || M.icode == ICALL) return TRUE;
-	else return FALSE;
+	else updateWregister(machine, m_stat, M->icode, M->valE, m_valM, M->dstE, M->dstM, M->pc, M->predTaken);
 }
 
 /* Function Name: getMregister
- * Purpose:       Returns a copy of the M register
+ * Purpose:       Returns a copy of the M register of the last memory stage
  *
- * Parameters:    none
+ * Parameters:    machine - machine being simulated
  * Returns:       mregister
  * Modifies:      none
  */
-mregister getMregister(){
-    return M;
+mregister getMregister(machineType * machine){
+    return machine->cur->M[machine->config.memoryStages - 1];
 }
 
 /* Function Name: clearMregister
- * Purpose:       Clears the M register
+ * Purpose:       Clears the M registers
  *
- * Parameters:    none
+ * Parameters:    machine - machine being simulated
  * Returns:       none
  * Modifies:      M
  */
-void clearMregister(){
-    clearBuffer((char *) &M, sizeof(M));
-    M.stat = SAOK;
-    M.icode = INOP;
+void clearMregister(machineType * machine){
+    int i;
+
+    clearBuffer((char *) machine->cur->M, sizeof(machine->cur->M));
+    for(i = 0; i < MAXMEMSTAGES; i++){
+        machine->cur->M[i].stat = SAOK;
+        machine->cur->M[i].icode = INOP;
+        machine->cur->M[i].pc = NOPC;
+    }
 }
 
 /* Function Name: updateMregister
  * Purpose:       Passes the values from the e stage to the Memory register
  *
- * Parameters:    All the values that correspond to the fields in the M register
+ * Parameters:    machine - machine being simulated
+ *                stage - memory stage of the register, 0 for the one the e stage writes
+ *                All the values that correspond to the fields in the M register
  * Returns:       -
- * Modifies:      M register
+ * Modifies:      next M register
  */
-void updateMregister(unsigned int stat, unsigned int icode, unsigned int Cnd, unsigned int valE,
-                    unsigned int valA, unsigned int dstE, unsigned int dstM){
-    M.stat = stat;
-    M.icode = icode;
-    M.Cnd = Cnd;
-    M.valE = valE;
-    M.valA = valA;
-    M.dstE = dstE;
-    M.dstM = dstM;
+void updateMregister(machineType * machine, int stage, unsigned int stat, unsigned int icode, unsigned int Cnd,
+                    unsigned int valE, unsigned int valA, unsigned int dstE, unsigned int dstM,
+                    unsigned int pc, unsigned int predTaken, unsigned int predPC, unsigned int cc){
+    mregister * M = &machine->next->M[stage];
+
+    M->stat = stat;
+    M->icode = icode;
+    M->Cnd = Cnd;
+    M->valE = valE;
+    M->valA = valA;
+    M->dstE = dstE;
+    M->dstM = dstM;
+    M->pc = pc;
+    M->predTaken = predTaken;
+    M->predPC = predPC;
+    M->cc = cc;
+    M->cycles = 0;
+    M->latency = 0;
 }
 
 /* Function Name: W_stall
  * Purpose:       Determines if the W register should be stalled
  *
- * Parameters:    status - struct containing value for W status
+ * Parameters:    machine - machine being simulated
  * Returns:       TRUE if register should be stalled, FALSE otherwise
  * Modifies:      -
  */
-bool W_stall(statusType status){
+bool W_stall(machineType * machine){
     //stall register if W_stat is SINS, SADR, or SHLT
-    if(status.W_stat != SAOK) return TRUE;
+    if(machine->cur->W.stat != SAOK) return TRUE;
     return FALSE;
 }
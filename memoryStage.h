@@ -4,13 +4,22 @@
 //struct representing the M register
 typedef struct
 {
-    unsigned int stat, icode, Cnd, valE, valA, dstE, dstM;
+    unsigned int valE, valA;
+    unsigned int pc;
+    unsigned char stat, icode, Cnd, dstE, dstM;
+    unsigned char predTaken;
+    unsigned int predPC;      //where fetch went on after a predicted ret
+    unsigned char cc;         //condition codes when a predicted ret left the execute stage
+    unsigned int cycles;      //cycles spent on the access in the last memory stage
+    unsigned int latency;     //cycles the access takes, known from its first cycle there
+    predictorCheckpointType checkpoint; //predictor after a predicted ret was fetched
 } mregister;
 
 //prototypes for functions called from files other than memoryStage
-mregister getMregister();
-void mememoryStage(statusType *status, forwardType *forwarded, bubbleType *bubble);
-void clearMregister();
-void updateMregister(unsigned int stat, unsigned int icode, unsigned int Cnd,
-    unsigned int valE, unsigned int valA, unsigned int dstE, unsigned int dstM);
+mregister getMregister(machineType * machine);
+void memoryStage(machineType * machine, signalType * signals);
+void clearMregister(machineType * machine);
+void updateMregister(machineType * machine, int stage, unsigned int stat, unsigned int icode, unsigned int Cnd,
+    unsigned int valE, unsigned int valA, unsigned int dstE, unsigned int dstM, unsigned int pc, unsigned int predTaken,
+    unsigned int predPC, unsigned int cc);
 #endif
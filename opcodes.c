@@ -0,0 +1,53 @@
+#include "bool.h"
+#include "instructions.h"
+#include "opcodes.h"
+
+/*
+ * Opcodes.c - the opcode descriptor table.
+ * The function code doesn't change what an instruction needs, so each
+ * instruction is written once and ROW repeats it for all 16 of its
+ * function codes.  Adding an instruction only means filling in its row.
+ */
+
+#define ROW(...) {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, \
+                 {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, \
+                 {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, \
+                 {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}, {__VA_ARGS__}
+
+#define INVALID ROW(SINS, 1, FALSE, 0, SELNONE, SELNONE, SELNONE, SELNONE, FALSE, FALSE, FALSE, FALSE, ADDRNONE)
+
+const opcodeType opcodeTable[256] =
+{
+    //   stat  len regids valC srcA     srcB     dstE     dstM     useValP predValC memRead memWrite memAddr
+    ROW(SHLT, 1,  FALSE, 0,   SELNONE, SELNONE, SELNONE, SELNONE, FALSE,  FALSE,   FALSE,  FALSE,   ADDRNONE), //IHALT
+    ROW(SAOK, 1,  FALSE, 0,   SELNONE, SELNONE, SELNONE, SELNONE, FALSE,  FALSE,   FALSE,  FALSE,   ADDRNONE), //INOP
+    ROW(SAOK, 2,  TRUE,  0,   SELRA,   SELNONE, SELRB,   SELNONE, FALSE,  FALSE,   FALSE,  FALSE,   ADDRNONE), //IRRMOVL, ICMOVXX
+    ROW(SAOK, 6,  TRUE,  2,   SELNONE, SELNONE, SELRB,   SELNONE, FALSE,  FALSE,   FALSE,  FALSE,   ADDRNONE), //IIRMOVL
+    ROW(SAOK, 6,  TRUE,  2,   SELRA,   SELRB,   SELNONE, SELNONE, FALSE,  FALSE,   FALSE,  TRUE,    ADDRVALE), //IRMMOVL
+    ROW(SAOK, 6,  TRUE,  2,   SELNONE, SELRB,   SELNONE, SELRA,   FALSE,  FALSE,   TRUE,   FALSE,   ADDRVALE), //IMRMOVL
+    ROW(SAOK, 2,  TRUE,  0,   SELRA,   SELRB,   SELRB,   SELNONE, FALSE,  FALSE,   FALSE,  FALSE,   ADDRNONE), //IOPL
+    ROW(SAOK, 5,  FALSE, 1,   SELNONE, SELNONE, SELNONE, SELNONE, TRUE,   TRUE,    FALSE,  FALSE,   ADDRNONE), //IJXX
+    ROW(SAOK, 5,  FALSE, 1,   SELNONE, SELESP,  SELESP,  SELNONE, TRUE,   TRUE,    FALSE,  TRUE,    ADDRVALE), //ICALL
+    ROW(SAOK, 1,  FALSE, 0,   SELESP,  SELESP,  SELESP,  SELNONE, FALSE,  FALSE,   TRUE,   FALSE,   ADDRVALA), //IRET
+    ROW(SAOK, 2,  TRUE,  0,   SELRA,   SELESP,  SELESP,  SELNONE, FALSE,  FALSE,   FALSE,  TRUE,    ADDRVALE), //IPUSHL
+    ROW(SAOK, 2,  TRUE,  0,   SELESP,  SELESP,  SELESP,  SELRA,   FALSE,  FALSE,   TRUE,   FALSE,   ADDRVALA), //IPOPL
+    ROW(SAOK, 5,  FALSE, 1,   SELNONE, SELNONE, SELNONE, SELNONE, FALSE,  FALSE,   FALSE,  FALSE,   ADDRNONE), //IDUMP
+    INVALID,                                                                                                     //0xD
+    INVALID,                                                                                                     //0xE
+    INVALID                                                                                                      //0xF
+};
+
+/* Bit cc of conditionMask[ifun] is set if a jump or conditional move with
+ * that function code is taken when the condition codes are cc (ZF in bit
+ * 2, SF in bit 1 and OF in bit 0, the same as the CC register).
+ */
+const unsigned char conditionMask[16] =
+{
+    [JMP] = 0xff,             //always
+    [JLE] = 0xf6,             //(SF ^ OF) | ZF
+    [JL] = 0x66,              //SF ^ OF
+    [JE] = 0xf0,              //ZF
+    [JNE] = 0x0f,             //!ZF
+    [JGE] = 0x99,             //!(SF ^ OF)
+    [JG] = 0x09               //!(SF ^ OF) & !ZF
+};
@@ -0,0 +1,76 @@
+#ifndef OPCODES_H
+#define OPCODES_H
+
+/* Describes every opcode byte (icode in the high nibble, ifun in the low
+ * nibble) so the stages can look up what an instruction needs instead of
+ * testing its icode.
+ */
+
+//register selectors, index the array {RNONE, rA, rB, ESP}
+#define SELNONE 0
+#define SELRA 1
+#define SELRB 2
+#define SELESP 3
+
+//memory address selectors, index the array {0, valE, valA}
+#define ADDRNONE 0
+#define ADDRVALE 1
+#define ADDRVALA 2
+
+//index of the descriptor for an instruction
+#define OPCODE(icode, ifun) (((icode) << 4) | (ifun))
+
+//struct describing one opcode byte
+typedef struct
+{
+    unsigned char stat;       //status of the instruction, SAOK, SHLT or SINS
+    unsigned char length;     //number of bytes in the instruction
+    unsigned char regids;     //TRUE if a register byte follows the opcode
+    unsigned char valC;       //offset of the 4 byte constant, 0 if there isn't one
+    unsigned char srcA;       //register selectors
+    unsigned char srcB;
+    unsigned char dstE;
+    unsigned char dstM;
+    unsigned char useValP;    //TRUE if valA is valP instead of a register
+    unsigned char predValC;   //TRUE if the next PC is predicted to be valC
+    unsigned char memRead;    //TRUE if the memory stage reads memory
+    unsigned char memWrite;   //TRUE if the memory stage writes memory
+    unsigned char memAddr;    //memory address selector
+} opcodeType;
+
+extern const opcodeType opcodeTable[256];
+
+//TRUE if a jump or conditional move is taken, indexed by ifun and the CC register
+#define CONDITION(ifun, cc) ((conditionMask[ifun] >> (cc)) & 1)
+extern const unsigned char conditionMask[16];
+
+/* Performs an opl the same way the execute stage's alu does, on a CC
+ * register held in cc.  Add and subtract set OF, and and xor leave it alone.
+ */
+#define OPL(ifun, aluA, aluB, result, cc)                                                \
+    do {                                                                                 \
+        unsigned int a = (aluA), b = (aluB), of = cc & 1;                                \
+        switch(ifun){                                                                    \
+            case ADDL:                                                                   \
+                result = b + a;                                                          \
+                of = ((int) result <= 0 && (int) a > 0 && (int) b > 0) ||                \
+                     ((int) result >= 0 && (int) a < 0 && (int) b < 0);                  \
+                break;                                                                   \
+            case SUBL:                                                                   \
+                result = b - a;                                                          \
+                of = ((int) result <= 0 && (int) a < 0 && (int) b > 0) ||                \
+                     ((int) result >= 0 && (int) a > 0 && (int) b < 0);                  \
+                break;                                                                   \
+            case ANDL:                                                                   \
+                result = a & b;                                                          \
+                break;                                                                   \
+            case XORL:                                                                   \
+                result = a ^ b;                                                          \
+                break;                                                                   \
+            default:                                                                     \
+                result = 0;                                                              \
+        }                                                                                \
+        cc = ((result == 0) << ZF) | (((int) result < 0) << SF) | (of << OF);            \
+    } while(0)
+
+#endif
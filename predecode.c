@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include "machine.h"
+#include "tools.h"
+
+/*
+ * Predecode.c - cache of instructions the fetch stage has already decoded.
+ * Each machine has its own cache, direct mapped on the PC.  Every store to
+ * memory calls invalidatePredecode so an instruction that is overwritten
+ * (self modifying code) is decoded again the next time it is fetched.  codeLines marks the
+ * memory lines that hold a cached instruction so stores to data don't have
+ * to search the cache.
+ */
+
+/* Function Name: lookupPredecode
+ * Purpose:       Finds the decoded instruction at an address
+ *
+ * Parameters:    machine - machine whose cache is used
+ *                pc - address of the instruction
+ * Returns:       pointer to the decoded instruction, NULL if it isn't cached
+ * Modifies:      none
+ */
+predecodeType * lookupPredecode(machineType * machine, unsigned int pc)
+{
+    predecodeType * entry = &machine->predecode.entries[pc & (PREDECODESIZE - 1)];
+    if(entry->valid && entry->pc == pc) return entry;
+    return NULL;
+}
+
+/* Function Name: insertPredecode
+ * Purpose:       Adds a decoded instruction to the cache, replacing whatever
+ *                instruction was in its slot
+ *
+ * Parameters:    machine - machine whose cache is used
+ *                inst - the decoded instruction, inst->pc and inst->valP
+ *                       give the bytes it was decoded from
+ * Returns:       pointer to the cached copy of the instruction
+ * Modifies:      machine->predecode
+ */
+predecodeType * insertPredecode(machineType * machine, predecodeType * inst)
+{
+    predecodeType * entry = &machine->predecode.entries[inst->pc & (PREDECODESIZE - 1)];
+    unsigned int line;
+
+    *entry = *inst;
+    entry->valid = TRUE;
+
+    //mark every line the instruction's bytes fall in
+    for(line = inst->pc >> PREDECODELINEBITS; line <= (inst->valP - 1) >> PREDECODELINEBITS; line++)
+        machine->predecode.codeLines[line & (PREDECODELINES - 1)] = 1;
+    return entry;
+}
+
+/* Function Name: invalidatePredecode
+ * Purpose:       Drops any cached instruction that overlaps bytes being written
+ *
+ * Parameters:    machine - machine whose cache is used
+ *                address - first byte written
+ *                length - number of bytes written
+ * Returns:       none
+ * Modifies:      machine->predecode
+ */
+void invalidatePredecode(machineType * machine, unsigned int address, unsigned int length)
+{
+    unsigned int line;
+    unsigned int pc;
+    bool code = FALSE;
+
+    if(length == 0) return;
+
+    //nothing to do if no cached instruction lies in the lines written
+    for(line = address >> PREDECODELINEBITS; line <= (address + length - 1) >> PREDECODELINEBITS; line++)
+    {
+        if(machine->predecode.codeLines[line & (PREDECODELINES - 1)])
+        {
+            code = TRUE;
+            break;
+        }
+    }
+    if(!code) return;
+
+    //an instruction overlaps the write if it starts in the bytes written or
+    //starts less than MAXINSTLEN bytes before them and runs into them
+    for(pc = address - (MAXINSTLEN - 1); pc != address + length; pc++)
+    {
+        predecodeType * entry = &machine->predecode.entries[pc & (PREDECODESIZE - 1)];
+        if(entry->valid && entry->pc == pc &&
+           (pc - address < length || address - pc < entry->valP - pc))
+            entry->valid = FALSE;
+    }
+}
+
+/* Function Name: clearPredecode
+ * Purpose:       Empties the cache
+ *
+ * Parameters:    machine - machine whose cache is used
+ * Returns:       none
+ * Modifies:      machine->predecode
+ */
+void clearPredecode(machineType * machine)
+{
+    clearBuffer((char *) &machine->predecode, sizeof(machine->predecode));
+}
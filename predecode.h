@@ -0,0 +1,42 @@
+#ifndef PREDECODE_H
+#define PREDECODE_H
+
+//number of decoded instructions kept, indexed by the low bits of the PC
+#define PREDECODESIZE 4096
+
+//stores are checked against the cache in lines of 1 << PREDECODELINEBITS bytes
+#define PREDECODELINEBITS 5
+#define PREDECODELINES 4096
+
+//longest instruction in bytes
+#define MAXINSTLEN 6
+
+//struct representing an instruction that has already been fetched and decoded
+typedef struct
+{
+    unsigned int pc;
+    bool valid;
+    unsigned int stat;
+    unsigned int icode;
+    unsigned int ifun;
+    unsigned int rA;
+    unsigned int rB;
+    unsigned int valC;
+    unsigned int valP;
+} predecodeType;
+
+//struct holding the predecode cache of a machine
+typedef struct
+{
+    predecodeType entries[PREDECODESIZE];
+
+    //nonzero if a cached instruction may overlap the line (hashed on the line number)
+    unsigned char codeLines[PREDECODELINES];
+} predecodeCacheType;
+
+//prototypes
+predecodeType * lookupPredecode(machineType * machine, unsigned int pc);
+predecodeType * insertPredecode(machineType * machine, predecodeType * inst);
+void invalidatePredecode(machineType * machine, unsigned int address, unsigned int length);
+void clearPredecode(machineType * machine);
+#endif
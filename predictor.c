@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "tools.h"
+#include "instructions.h"
+#include "functional.h"
+
+/*
+ * Predictor.c - predicts conditional jumps for the fetch stage.  The
+ * predictor of a machine is chosen by machine->config.predictor, the fetch
+ * stage asks it about every conditional jump that goes on to the decode
+ * stage and the execute stage tells it what the jump did.  The counters and
+ * history are trained when a jump is resolved, not when it is predicted.
+ *
+ * The perfect predictor runs a functional copy of the program alongside the
+ * pipeline.  The copy runs ahead to the next conditional jump on the right
+ * path and keeps whether it is taken.  A fetched jump at that address gets
+ * the answer and moves on to the next one.  A jump fetched down a wrong path,
+ * after a halt or a mispredicted ret, is mostly at another address and is
+ * predicted taken without moving on.  One at that address does move on, and
+ * the fetch stage moves back when the wrong path is squashed.
+ *
+ * With a return address stack (machine->config.rasDepth) the fetch stage
+ * predicts where a ret goes instead of waiting for it to read its address.
+ * The memory stage checks the prediction when the address is read.
+ */
+
+//names of the predictors on the command line, indexed by PRED...
+static const char * names[PREDICTORS] = {"taken", "btfnt", "bimodal", "gshare", "perfect"};
+
+//prototypes of functions only called within this file
+static bool startOracle(machineType * machine);
+static bool askOracle(machineType * machine, unsigned int pc);
+static bool runOracle(machineType * machine);
+static unsigned char * findCounter(machineType * machine, unsigned int pc);
+static branchStatType * findStat(predictorType * predictor, unsigned int pc);
+static int comparePCs(const void * first, const void * second);
+//end prototypes
+
+/* Function Name: findPredictor
+ * Purpose:       Looks up a branch predictor by name
+ *
+ * Parameters:    name - name of the predictor
+ * Returns:       PRED... of the predictor, -1 if there isn't one with that name
+ * Modifies:      -
+ */
+int findPredictor(char * name)
+{
+    int i;
+
+    for(i = 0; i < PREDICTORS; i++)
+        if(strcmp(names[i], name) == 0) return i;
+    return -1;
+}
+
+/* Function Name: clearPredictor
+ * Purpose:       Forgets everything the predictor learned and its statistics
+ *
+ * Parameters:    machine - machine whose predictor is cleared
+ * Returns:       -
+ * Modifies:      machine->predictor
+ */
+void clearPredictor(machineType * machine)
+{
+    predictorType * predictor = &machine->predictor;
+
+    //weakly taken, so an untrained counter predicts what PREDTAKEN does
+    memset(predictor->counters, WEAKTAKEN, sizeof(predictor->counters));
+    predictor->history = 0;
+
+    free(predictor->stats);
+    predictor->stats = NULL;
+    predictor->statSize = 0;
+    predictor->statCount = 0;
+
+    if(predictor->oracle != NULL){
+        if(predictor->oracle->out != stdout) fclose(predictor->oracle->out);
+        freeMachine(predictor->oracle);
+    }
+    predictor->oracle = NULL;
+    predictor->oracleStopped = TRUE;
+
+    memset(&predictor->returns, 0, sizeof(predictor->returns));
+}
+
+/* Function Name: startPredictor
+ * Purpose:       Gets the predictor ready for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->predictor
+ */
+void startPredictor(machineType * machine)
+{
+    //without its copy the perfect predictor predicts taken
+    if(machine->config.predictor == PREDPERFECT && !startOracle(machine))
+        fprintf(stderr, "Unable to copy the program for the perfect predictor\n");
+}
+
+/* Function Name: predictBranch
+ * Purpose:       Predicts whether a conditional jump is taken
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the jump
+ *                valC - its target
+ * Returns:       TRUE if the jump is predicted taken
+ * Modifies:      the copy of the perfect predictor
+ */
+bool predictBranch(machineType * machine, unsigned int pc, unsigned int valC)
+{
+    switch(machine->config.predictor){
+        case PREDBTFNT:
+            return valC <= pc;
+        case PREDBIMODAL:
+        case PREDGSHARE:
+            return *findCounter(machine, pc) >= WEAKTAKEN;
+        case PREDPERFECT:
+            return askOracle(machine, pc);
+        default:
+            return TRUE;
+    }
+}
+
+/* Function Name: resolveBranch
+ * Purpose:       Trains the predictor with what a conditional jump did and
+ *                counts whether it was predicted correctly
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the jump
+ *                predicted - TRUE if the jump was predicted taken
+ *                taken - TRUE if the jump was taken
+ * Returns:       -
+ * Modifies:      machine->predictor
+ */
+void resolveBranch(machineType * machine, unsigned int pc, bool predicted, bool taken)
+{
+    predictorType * predictor = &machine->predictor;
+    unsigned char * counter = findCounter(machine, pc);
+    branchStatType * stat;
+
+    if(taken && *counter < STRONGTAKEN) (*counter)++;
+    else if(!taken && *counter > 0) (*counter)--;
+    predictor->history = ((predictor->history << 1) | taken) & (PREDTABLESIZE - 1);
+
+    stat = findStat(predictor, pc);
+    if(stat == NULL) return;
+    stat->count++;
+    if(predicted == taken) stat->correct++;
+}
+
+/* Function Name: pushReturn
+ * Purpose:       Pushes the return address of a call onto the return address
+ *                stack, dropping the oldest address if the stack is full
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the instruction after the call
+ * Returns:       -
+ * Modifies:      machine->predictor.returns
+ */
+void pushReturn(machineType * machine, unsigned int address)
+{
+    returnStackType * returns = &machine->predictor.returns;
+
+    returns->top = (returns->top + 1) % machine->config.rasDepth;
+    returns->addresses[returns->top] = address;
+    if(returns->count == machine->config.rasDepth) returns->overflows++;
+    else returns->count++;
+}
+
+/* Function Name: popReturn
+ * Purpose:       Pops the predicted address of a ret off the return address stack
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - gets the predicted address
+ * Returns:       TRUE if there was an address to pop, FALSE if the stack is empty
+ * Modifies:      machine->predictor.returns, address
+ */
+bool popReturn(machineType * machine, unsigned int * address)
+{
+    returnStackType * returns = &machine->predictor.returns;
+
+    if(returns->count == 0) return FALSE;
+    *address = returns->addresses[returns->top];
+    returns->top = (returns->top + machine->config.rasDepth - 1) % machine->config.rasDepth;
+    returns->count--;
+    return TRUE;
+}
+
+/* Function Name: resolveReturn
+ * Purpose:       Counts whether a ret was predicted and if so whether correctly
+ *
+ * Parameters:    machine - machine being simulated
+ *                predicted - TRUE if the fetch stage predicted the ret
+ *                hit - TRUE if the prediction was the address the ret read
+ * Returns:       -
+ * Modifies:      machine->predictor.returns
+ */
+void resolveReturn(machineType * machine, bool predicted, bool hit)
+{
+    returnStackType * returns = &machine->predictor.returns;
+
+    if(!predicted) returns->empty++;
+    else if(hit) returns->hits++;
+    else returns->misses++;
+}
+
+/* Function Name: savePredictor
+ * Purpose:       Takes a checkpoint of the return address stack and the
+ *                perfect predictor for an instruction going on to decode
+ *
+ * Parameters:    machine - machine being simulated
+ *                checkpoint - gets them as they are after the instruction
+ * Returns:       -
+ * Modifies:      checkpoint
+ */
+void savePredictor(machineType * machine, predictorCheckpointType * checkpoint)
+{
+    returnStackType * returns = &machine->predictor.returns;
+
+    checkpoint->top = returns->top;
+    checkpoint->count = returns->count;
+    checkpoint->address = returns->addresses[returns->top];
+    checkpoint->stopped = returns->stopped;
+    checkpoint->oracleFetched = machine->predictor.oracleFetched;
+}
+
+/* Function Name: restorePredictor
+ * Purpose:       Puts the return address stack and the perfect predictor back
+ *                as they were after a mispredicted instruction, undoing the
+ *                calls, rets and jumps fetched after it
+ *
+ * Parameters:    machine - machine being simulated
+ *                checkpoint - them after the mispredicted instruction
+ * Returns:       -
+ * Modifies:      machine->predictor
+ */
+void restorePredictor(machineType * machine, predictorCheckpointType * checkpoint)
+{
+    returnStackType * returns = &machine->predictor.returns;
+
+    returns->top = checkpoint->top;
+    returns->count = checkpoint->count;
+    returns->addresses[returns->top] = checkpoint->address;
+    returns->stopped = checkpoint->stopped;
+    machine->predictor.oracleFetched = checkpoint->oracleFetched;
+}
+
+/* Function Name: reportPredictor
+ * Purpose:       Writes how many conditional jumps the predictor got right,
+ *                in total and for each jump, and how the return address
+ *                stack did if there is one
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      the order of the statistics
+ */
+void reportPredictor(machineType * machine)
+{
+    predictorType * predictor = &machine->predictor;
+    unsigned long long count = 0, correct = 0;
+    unsigned int i;
+
+    //move the entries in use to the front, in order of PC
+    if(predictor->stats != NULL)
+        qsort(predictor->stats, predictor->statSize, sizeof(branchStatType), comparePCs);
+    for(i = 0; i < predictor->statCount; i++){
+        count += predictor->stats[i].count;
+        correct += predictor->stats[i].correct;
+    }
+
+    fprintf(machine->out, "\nBranch predictor = %s\n", names[machine->config.predictor]);
+    fprintf(machine->out, "Conditional jumps = %llu mispredicted = %llu accuracy = %.2f%%\n",
+            count, count - correct, count == 0 ? 100.0 : 100.0 * correct / count);
+    for(i = 0; i < predictor->statCount; i++){
+        branchStatType * stat = &predictor->stats[i];
+        fprintf(machine->out, "%08x: jumps = %u mispredicted = %u accuracy = %.2f%%\n", stat->pc, stat->count,
+                stat->count - stat->correct, 100.0 * stat->correct / stat->count);
+    }
+
+    if(machine->config.rasDepth > 0){
+        returnStackType * returns = &predictor->returns;
+        fprintf(machine->out, "\nReturn address stack depth = %d\n", machine->config.rasDepth);
+        fprintf(machine->out, "Returns = %llu hits = %llu misses = %llu empty = %llu overflows = %llu\n",
+                returns->hits + returns->misses + returns->empty, returns->hits, returns->misses,
+                returns->empty, returns->overflows);
+    }
+
+    //the hash is out of order now
+    free(predictor->stats);
+    predictor->stats = NULL;
+    predictor->statSize = 0;
+    predictor->statCount = 0;
+}
+
+/* Function Name: startOracle
+ * Purpose:       Makes the functional copy of the program for the perfect
+ *                predictor, with its own memory and its dumps discarded
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       TRUE if the copy was made, FALSE otherwise
+ * Modifies:      machine->predictor
+ */
+static bool startOracle(machineType * machine)
+{
+    predictorType * predictor = &machine->predictor;
+    unsigned long long size = getMemorySize(machine);
+    unsigned long long address;
+    unsigned char * page = malloc(PAGESIZE);
+    machineType * oracle = newMachine();
+    FILE * out = fopen("/dev/null", "w");
+    bool memError = FALSE;
+
+    if(page == NULL || oracle == NULL || out == NULL){
+        free(page);
+        if(oracle != NULL) freeMachine(oracle);
+        if(out != NULL) fclose(out);
+        return FALSE;
+    }
+
+    setMemorySize(oracle, size);
+    for(address = 0; address < size; address += PAGESIZE){
+        if(!isPageAllocated(machine, address)) continue;
+        copyOut(machine, address, page, PAGESIZE, &memError);
+        copyIn(oracle, address, page, PAGESIZE, &memError);
+    }
+    free(page);
+
+    oracle->out = out;
+    predictor->oracle = oracle;
+    predictor->oraclePC = 0;
+    predictor->oracleStopped = FALSE;
+    predictor->oracleRun = 0;
+    predictor->oracleFetched = 0;
+    return TRUE;
+}
+
+/* Function Name: askOracle
+ * Purpose:       Returns whether a conditional jump is taken, if it is the
+ *                next one on the right path
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the jump
+ * Returns:       TRUE if the jump is taken, or if it isn't the next jump on the
+ *                right path or the copy couldn't find one
+ * Modifies:      the copy of the program
+ */
+static bool askOracle(machineType * machine, unsigned int pc)
+{
+    predictorType * predictor = &machine->predictor;
+    oracleJumpType * jump;
+
+    if(predictor->oracleFetched == predictor->oracleRun && !runOracle(machine)) return TRUE;
+    jump = &predictor->oracleJumps[predictor->oracleFetched % ORACLEJUMPS];
+    if(jump->pc != pc) return TRUE;
+    predictor->oracleFetched++;
+    return jump->taken;
+}
+
+/* Function Name: runOracle
+ * Purpose:       Runs the copy of the program past the next conditional jump
+ *                and keeps whether it was taken
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       TRUE if the copy found a jump, FALSE if it stopped first
+ * Modifies:      the copy of the program
+ */
+static bool runOracle(machineType * machine)
+{
+    predictorType * predictor = &machine->predictor;
+    machineType * oracle = predictor->oracle;
+    int steps = 0;
+
+    while(!predictor->oracleStopped){
+        predecodeType * inst = lookupPredecode(oracle, predictor->oraclePC);
+        if(inst == NULL) inst = decodeInstruction(oracle, predictor->oraclePC);
+
+        //the copy is at the jump, so its condition codes are the ones the jump sees
+        if(inst->stat == SAOK && inst->icode == IJXX && inst->ifun != JMP){
+            oracleJumpType * jump = &predictor->oracleJumps[predictor->oracleRun % ORACLEJUMPS];
+            jump->pc = predictor->oraclePC;
+            jump->taken = testCondition(oracle, inst->ifun);
+            predictor->oracleRun++;
+            predictor->oracleStopped = stepFunctional(oracle, &predictor->oraclePC);
+            return TRUE;
+        }
+        if(++steps > ORACLELIMIT) predictor->oracleStopped = TRUE;
+        else predictor->oracleStopped = stepFunctional(oracle, &predictor->oraclePC);
+    }
+    return FALSE;
+}
+
+/* Function Name: findCounter
+ * Purpose:       Finds the 2-bit counter of a jump
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the jump
+ * Returns:       pointer to the counter
+ * Modifies:      -
+ */
+static unsigned char * findCounter(machineType * machine, unsigned int pc)
+{
+    predictorType * predictor = &machine->predictor;
+
+    if(machine->config.predictor == PREDGSHARE) pc ^= predictor->history;
+    return &predictor->counters[pc & (PREDTABLESIZE - 1)];
+}
+
+/* Function Name: findStat
+ * Purpose:       Finds the statistics of a jump, adding them if it's new
+ *
+ * Parameters:    predictor - predictor of the machine
+ *                pc - address of the jump
+ * Returns:       pointer to the statistics, NULL if they couldn't be allocated
+ * Modifies:      predictor->stats
+ */
+static branchStatType * findStat(predictorType * predictor, unsigned int pc)
+{
+    unsigned int i;
+
+    //grow the hash when it gets half full
+    if(predictor->statCount * 2 >= predictor->statSize){
+        unsigned int size = predictor->statSize == 0 ? 64 : predictor->statSize * 2;
+        branchStatType * old = predictor->stats;
+        branchStatType * stats = calloc(size, sizeof(branchStatType));
+        if(stats == NULL) return NULL;
+
+        for(i = 0; i < predictor->statSize; i++){
+            unsigned int j = old[i].pc & (size - 1);
+            if(old[i].count == 0) continue;
+            while(stats[j].count != 0) j = (j + 1) & (size - 1);
+            stats[j] = old[i];
+        }
+        free(old);
+        predictor->stats = stats;
+        predictor->statSize = size;
+    }
+
+    i = pc & (predictor->statSize - 1);
+    while(predictor->stats[i].count != 0 && predictor->stats[i].pc != pc) i = (i + 1) & (predictor->statSize - 1);
+    if(predictor->stats[i].count == 0){
+        predictor->stats[i].pc = pc;
+        predictor->statCount++;
+    }
+    return &predictor->stats[i];
+}
+
+/* Function Name: comparePCs
+ * Purpose:       Orders statistics by PC for qsort, free entries last
+ *
+ * Parameters:    first, second - pointers to the statistics
+ * Returns:       negative, zero or positive as first goes before, with or
+ *                after second
+ * Modifies:      -
+ */
+static int comparePCs(const void * first, const void * second)
+{
+    const branchStatType * a = first;
+    const branchStatType * b = second;
+
+    if((a->count == 0) != (b->count == 0)) return a->count == 0 ? 1 : -1;
+    return (a->pc > b->pc) - (a->pc < b->pc);
+}
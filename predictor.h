@@ -0,0 +1,109 @@
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+//branch predictors the fetch stage can use for conditional jumps
+#define PREDTAKEN 0           //always taken
+#define PREDBTFNT 1           //backward taken, forward not taken
+#define PREDBIMODAL 2         //a 2-bit counter per PC
+#define PREDGSHARE 3          //2-bit counters indexed by the PC xor the global history
+#define PREDPERFECT 4         //asks a functional copy of the program
+#define PREDICTORS 5
+
+//number of 2-bit counters, indexed by the low bits of the PC
+#define PREDTABLEBITS 12
+#define PREDTABLESIZE (1 << PREDTABLEBITS)
+
+//a counter of at least WEAKTAKEN predicts taken
+#define WEAKTAKEN 2
+#define STRONGTAKEN 3
+
+//instructions the perfect predictor runs ahead looking for a jump before it gives up
+#define ORACLELIMIT 1000000
+
+//conditional jumps the perfect predictor keeps once it has run to them, more than
+//can be in the pipeline at once
+#define ORACLEJUMPS 64
+
+//deepest return address stack that can be asked for
+#define RASMAXDEPTH 256
+
+//how often a conditional jump was predicted correctly
+typedef struct
+{
+    unsigned int pc;
+    unsigned int count;       //0 if the entry is free
+    unsigned int correct;
+} branchStatType;
+
+//a conditional jump the copy of the perfect predictor ran to
+typedef struct
+{
+    unsigned int pc;
+    bool taken;
+} oracleJumpType;
+
+//return address stack of the fetch stage, a call pushes its valP and a ret
+//pops its prediction.  Pushing onto a full stack drops the oldest address.
+typedef struct
+{
+    unsigned int addresses[RASMAXDEPTH];
+    int top;                  //index of the newest address
+    int count;                //addresses on the stack
+    bool stopped;             //TRUE once a halt or an error went on to decode, nothing after it runs
+
+    //rets predicted correctly, predicted wrongly, not predicted because the
+    //stack was empty, and addresses dropped
+    unsigned long long hits, misses, empty, overflows;
+} returnStackType;
+
+//the return address stack and the jumps the perfect predictor answered when an
+//instruction was fetched, carried with it through the pipeline registers so they can
+//be put back when the instructions fetched after a mispredicted jump or ret are
+//squashed.  A wrong path that pops and then pushes writes over the address at the
+//top of the stack, so that is kept too
+typedef struct
+{
+    int top;
+    int count;
+    unsigned int address;     //at top
+    bool stopped;
+    unsigned long long oracleFetched;
+} predictorCheckpointType;
+
+//state of the branch predictor of a machine
+typedef struct
+{
+    unsigned char counters[PREDTABLESIZE];
+    unsigned int history;     //outcomes of the last PREDTABLEBITS jumps, newest in bit 0
+
+    //statistics, an open hash on the PC of the jump
+    branchStatType * stats;
+    unsigned int statSize;
+    unsigned int statCount;
+
+    //the functional copy used by PREDPERFECT, run ahead to the conditional jumps on
+    //the right path.  The jumps it ran to are kept in order until the fetch stage
+    //gets to them, a jump that isn't the next of them is on a wrong path
+    machineType * oracle;
+    unsigned int oraclePC;
+    bool oracleStopped;
+    oracleJumpType oracleJumps[ORACLEJUMPS];
+    unsigned long long oracleRun;      //jumps the copy ran to
+    unsigned long long oracleFetched;  //jumps of them the fetch stage got to
+
+    returnStackType returns;
+} predictorType;
+
+//prototypes
+int findPredictor(char * name);
+void clearPredictor(machineType * machine);
+void startPredictor(machineType * machine);
+bool predictBranch(machineType * machine, unsigned int pc, unsigned int valC);
+void resolveBranch(machineType * machine, unsigned int pc, bool predicted, bool taken);
+void pushReturn(machineType * machine, unsigned int address);
+bool popReturn(machineType * machine, unsigned int * address);
+void resolveReturn(machineType * machine, bool predicted, bool hit);
+void savePredictor(machineType * machine, predictorCheckpointType * checkpoint);
+void restorePredictor(machineType * machine, predictorCheckpointType * checkpoint);
+void reportPredictor(machineType * machine);
+#endif
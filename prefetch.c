@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <string.h>
+#include "machine.h"
+
+/*
+ * Prefetch.c - prefetches lines into the data cache ahead of the loads of
+ * the memory stage.  Every load trains the prefetcher with its PC and
+ * address after its own access.  The next-line prefetcher asks for the
+ * lines after the one the load read.  The stride prefetcher keeps the last
+ * address and stride of each load in a table indexed by its PC, and once a
+ * load has repeated its stride twice it asks for the addresses the next
+ * loads will read.  prefetchLine fills the lines in the cache, where a line
+ * isn't ready until the fill is done.
+ */
+
+//names of the prefetchers on the command line, indexed by PREF...
+static const char * names[PREFETCHERS] = {"none", "nextline", "stride"};
+
+/* Function Name: findPrefetcher
+ * Purpose:       Looks up a prefetcher by name
+ *
+ * Parameters:    name - name of the prefetcher
+ * Returns:       PREF... of the prefetcher, -1 if there isn't one with that name
+ * Modifies:      -
+ */
+int findPrefetcher(char * name)
+{
+    int i;
+
+    for(i = 0; i < PREFETCHERS; i++)
+        if(strcmp(names[i], name) == 0) return i;
+    return -1;
+}
+
+/* Function Name: startPrefetcher
+ * Purpose:       Forgets every stride for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->prefetcher
+ */
+void startPrefetcher(machineType * machine)
+{
+    memset(&machine->prefetcher, 0, sizeof(machine->prefetcher));
+}
+
+/* Function Name: trainPrefetcher
+ * Purpose:       Shows the prefetcher a load and prefetches the lines it
+ *                expects to be read next
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the load
+ *                address - address it read
+ * Returns:       -
+ * Modifies:      machine->prefetcher, machine->dcache
+ */
+void trainPrefetcher(machineType * machine, unsigned int pc, unsigned int address)
+{
+    strideEntryType * entry = &machine->prefetcher.table[pc & (PREFTABLE - 1)];
+    unsigned int lineSize = machine->config.dcache.lineSize;
+    int degree = machine->config.prefetchDegree;
+    int stride, step, i;
+
+    switch(machine->config.prefetcher){
+        case PREFNEXTLINE:
+            for(i = 1; i <= degree; i++) prefetchLine(machine, (address & ~(lineSize - 1)) + i * lineSize);
+            break;
+        case PREFSTRIDE:
+            if(!entry->valid || entry->pc != pc){
+                entry->valid = TRUE;
+                entry->pc = pc;
+                entry->stride = 0;
+                entry->confidence = 0;
+            }else{
+                stride = address - entry->last;
+                if(stride != 0 && stride == entry->stride){
+                    if(entry->confidence < 3) entry->confidence++;
+                }else{
+                    entry->stride = stride;
+                    entry->confidence = 0;
+                }
+            }
+            entry->last = address;
+
+            //a stride shorter than a line asks for the next lines in its direction
+            if(entry->confidence >= 2){
+                step = entry->stride;
+                if(step > -(int) lineSize && step < (int) lineSize){
+                    step = step > 0 ? lineSize : -lineSize;
+                    address &= ~(lineSize - 1);
+                }
+                for(i = 1; i <= degree; i++) prefetchLine(machine, address + i * step);
+            }
+            break;
+    }
+}
+
+/* Function Name: reportPrefetcher
+ * Purpose:       Writes the counters of the prefetcher, if the machine has one
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportPrefetcher(machineType * machine)
+{
+    prefetcherType * prefetcher = &machine->prefetcher;
+    unsigned long long misses = machine->dcache.misses;
+
+    if(machine->config.prefetcher == PREFNONE) return;
+    fprintf(machine->out, "\nPrefetcher = %s degree = %d\n", names[machine->config.prefetcher],
+            machine->config.prefetchDegree);
+    fprintf(machine->out, "Prefetches = %llu already cached = %llu useful = %llu late = %llu useless = %llu "
+            "late cycles = %llu\n", prefetcher->issued, prefetcher->redundant, prefetcher->useful,
+            prefetcher->late, prefetcher->useless, prefetcher->lateCycles);
+
+    //accuracy is of the lines prefetched, coverage of the misses there would have been
+    //and timeliness of the useful prefetches
+    fprintf(machine->out, "Accuracy = %.2f%% coverage = %.2f%% timeliness = %.2f%%\n",
+            prefetcher->issued == 0 ? 0.0 : 100.0 * prefetcher->useful / prefetcher->issued,
+            prefetcher->useful + misses == 0 ? 0.0 : 100.0 * prefetcher->useful / (prefetcher->useful + misses),
+            prefetcher->useful == 0 ? 0.0 : 100.0 * (prefetcher->useful - prefetcher->late) / prefetcher->useful);
+}
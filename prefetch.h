@@ -0,0 +1,42 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+//prefetchers the data cache can have
+#define PREFNONE 0            //no prefetching
+#define PREFNEXTLINE 1        //the lines after the line each load reads
+#define PREFSTRIDE 2          //the addresses a load with a steady stride reads next
+#define PREFETCHERS 3
+
+//most lines prefetched ahead of a load
+#define MAXDEGREE 8
+
+//entries of the stride table, a power of two indexed by the PC of the load
+#define PREFTABLE 64
+
+//stride a load was last seen with
+typedef struct
+{
+    unsigned int pc;
+    unsigned int last;        //address it read last
+    int stride;
+    int confidence;           //times in a row the stride repeated, up to 3
+    bool valid;
+} strideEntryType;
+
+//state of the prefetcher of a machine
+typedef struct
+{
+    strideEntryType table[PREFTABLE];
+
+    unsigned long long issued, redundant;     //prefetches that filled a line, or found it there
+    unsigned long long useful, late, useless; //prefetched lines a load used, used before they were
+                                              //filled, or that were evicted unused
+    unsigned long long lateCycles;            //cycles loads waited for late prefetches
+} prefetcherType;
+
+//prototypes
+int findPrefetcher(char * name);
+void startPrefetcher(machineType * machine);
+void trainPrefetcher(machineType * machine, unsigned int pc, unsigned int address);
+void reportPrefetcher(machineType * machine);
+#endif
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "machine.h"
+#include "instructions.h"
+
+/*
+ * Profile.c - attributes the clock cycles, stalls and bubbles of the
+ * pipeline to the instructions of the program and writes them next to the
+ * source the .yo file carries after the '|'.
+ *
+ * An instruction is charged the cycles from the instruction before it
+ * retiring to it retiring, so the cycles of every instruction add up to
+ * the cycles of the program.  It is charged the cycles it was held in a
+ * stalled pipeline register, and the bubbles it caused: a load the bubbles
+ * of its load-use hazards, a jump those of its misprediction, a ret those
+ * fetch waited for it, an access or an OPL those it took longer than a
+ * cycle and an instruction fetch those it waited for the fetch stages or
+ * the instruction cache.
+ */
+
+//prototypes of functions only called within this file
+static pcProfileType * findEntry(machineType * machine, unsigned int pc, bool add);
+static unsigned int findCauser(machineType * machine, int cause);
+//end prototypes
+
+/* Function Name: addSourceLine
+ * Purpose:       Keeps a line of the .yo file being loaded, if the
+ *                configuration asks for a profile or a call graph
+ *
+ * Parameters:    machine - machine the program is loaded into
+ *                hasAddress - TRUE if the line has an address
+ *                address - the address
+ *                code - TRUE if bytes were loaded at the address
+ *                text - the assembly after the '|', up to the end of the line
+ * Returns:       -
+ * Modifies:      machine->profile
+ */
+void addSourceLine(machineType * machine, bool hasAddress, unsigned int address, bool code, char * text)
+{
+    profileType * profile = &machine->profile;
+    sourceLineType * line;
+    int length = strcspn(text, "\r\n");
+
+    if(!machine->config.profile && machine->config.foldedFile == NULL) return;
+    if(profile->lineCount == profile->lineSize){
+        int size = profile->lineSize == 0 ? 64 : profile->lineSize * 2;
+        sourceLineType * lines = realloc(profile->lines, size * sizeof(sourceLineType));
+        if(lines == NULL) return;
+        profile->lines = lines;
+        profile->lineSize = size;
+    }
+
+    line = &profile->lines[profile->lineCount];
+    line->text = malloc(length + 1);
+    if(line->text == NULL) return;
+    memcpy(line->text, text, length);
+    line->text[length] = '\0';
+    line->hasAddress = hasAddress;
+    line->address = address;
+    line->code = code;
+    profile->lineCount++;
+}
+
+/* Function Name: findLabel
+ * Purpose:       Looks for a label at an address in the source of the program
+ *
+ * Parameters:    machine - machine holding the program
+ *                address - the address
+ *                name - gets the label
+ *                size - bytes name can hold
+ * Returns:       TRUE if a line at the address starts with a label, FALSE otherwise
+ * Modifies:      name
+ */
+bool findLabel(machineType * machine, unsigned int address, char * name, int size)
+{
+    profileType * profile = &machine->profile;
+    int i, length;
+    char * text;
+
+    for(i = 0; i < profile->lineCount; i++){
+        if(!profile->lines[i].hasAddress || profile->lines[i].address != address) continue;
+        text = profile->lines[i].text;
+        while(isspace((int) *text)) text++;
+        for(length = 0; isalnum((int) text[length]) || text[length] == '_' || text[length] == '.'; length++);
+        if(length == 0 || text[length] != ':') continue;
+        snprintf(name, size, "%.*s", length, text);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Function Name: startProfile
+ * Purpose:       Forgets the profile of any program run before, the source
+ *                of the loaded program is kept
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->profile
+ */
+void startProfile(machineType * machine)
+{
+    profileType * profile = &machine->profile;
+
+    free(profile->entries);
+    profile->entries = NULL;
+    profile->size = 0;
+    profile->count = 0;
+    profile->retiredAt = 0;
+}
+
+/* Function Name: clearProfile
+ * Purpose:       Releases the profile and the source of the program
+ *
+ * Parameters:    machine - machine to clear
+ * Returns:       -
+ * Modifies:      machine->profile
+ */
+void clearProfile(machineType * machine)
+{
+    profileType * profile = &machine->profile;
+    int i;
+
+    startProfile(machine);
+    for(i = 0; i < profile->lineCount; i++) free(profile->lines[i].text);
+    free(profile->lines);
+    profile->lines = NULL;
+    profile->lineCount = 0;
+    profile->lineSize = 0;
+}
+
+/* Function Name: profileRetired
+ * Purpose:       Charges an instruction that reached writeback with the
+ *                cycles since the one before it did
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the instruction
+ * Returns:       -
+ * Modifies:      machine->profile
+ */
+void profileRetired(machineType * machine, unsigned int pc)
+{
+    pcProfileType * entry = findEntry(machine, pc, TRUE);
+
+    //it retires in the cycle being simulated, machine->cycles counts the ones before it
+    if(entry != NULL){
+        entry->count++;
+        entry->cycles += machine->cycles + 1 - machine->profile.retiredAt;
+    }
+    machine->profile.retiredAt = machine->cycles + 1;
+}
+
+/* Function Name: profileStall
+ * Purpose:       Charges the instruction in a stalled pipeline register with
+ *                the cycle it is held there
+ *
+ * Parameters:    machine - machine being simulated
+ *                stage - STAGE... of the register
+ * Returns:       -
+ * Modifies:      machine->profile
+ */
+void profileStall(machineType * machine, int stage)
+{
+    pipelineType * cur = machine->cur;
+    unsigned int pc = NOPC;
+    pcProfileType * entry;
+
+    //fetch has already put the address it holds in the next F register
+    switch(stage){
+        case STAGEF: pc = machine->next->F.predPC; break;
+        case STAGED: pc = cur->D.pc; break;
+        case STAGEE: pc = cur->E.pc; break;
+        case STAGEM: pc = cur->M[machine->config.memoryStages - 1].pc; break;
+        case STAGEW: pc = cur->W.pc; break;
+    }
+    if(pc == NOPC) return;
+    entry = findEntry(machine, pc, TRUE);
+    if(entry != NULL) entry->stalled++;
+}
+
+/* Function Name: profileBubble
+ * Purpose:       Charges a bubble to the instruction that caused it
+ *
+ * Parameters:    machine - machine being simulated
+ *                cause - CAUSE... of the bubble
+ * Returns:       -
+ * Modifies:      machine->profile
+ */
+void profileBubble(machineType * machine, int cause)
+{
+    unsigned int pc = findCauser(machine, cause);
+    pcProfileType * entry;
+
+    if(pc == NOPC) return;
+    entry = findEntry(machine, pc, TRUE);
+    if(entry != NULL) entry->caused[cause]++;
+}
+
+/* Function Name: reportProfile
+ * Purpose:       Writes the source of the program with the profile of each
+ *                instruction next to it, if the configuration asks for it
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportProfile(machineType * machine)
+{
+    profileType * profile = &machine->profile;
+    unsigned long long cycles = machine->cycles;
+    int i, cause;
+    bool first;
+
+    if(!machine->config.profile) return;
+    fprintf(machine->out, "\nProfile = cycles from the instruction before retiring, cycles stalled and bubbles "
+            "caused\n");
+    fprintf(machine->out, "Percent     Count    Cycles   Stalled   Bubbles Address | Source\n");
+    for(i = 0; i < profile->lineCount; i++){
+        sourceLineType * line = &profile->lines[i];
+        pcProfileType * entry = line->code ? findEntry(machine, line->address, FALSE) : NULL;
+        unsigned long long bubbles = 0;
+        char address[16] = "";
+
+        if(line->hasAddress) snprintf(address, sizeof(address), "0x%03x:", line->address);
+        if(entry == NULL){
+            fprintf(machine->out, "%47s %-6s | %s\n", "", address, line->text);
+            continue;
+        }
+        for(cause = 0; cause < CAUSES; cause++) bubbles += entry->caused[cause];
+        fprintf(machine->out, "%6.2f%% %9llu %9llu %9llu %9llu %-6s | %s",
+                cycles == 0 ? 0.0 : 100.0 * entry->cycles / cycles, entry->count, entry->cycles, entry->stalled,
+                bubbles, address, line->text);
+
+        //the bubbles by cause, like a comment after the instruction
+        first = TRUE;
+        for(cause = 0; cause < CAUSES; cause++){
+            if(entry->caused[cause] == 0) continue;
+            fprintf(machine->out, "%s%s %llu", first ? "   # " : ", ", causeName(cause), entry->caused[cause]);
+            first = FALSE;
+        }
+        fprintf(machine->out, "\n");
+    }
+}
+
+/* Function Name: findEntry
+ * Purpose:       Finds the profile of an instruction
+ *
+ * Parameters:    machine - machine being simulated
+ *                pc - address of the instruction
+ *                add - TRUE to add the instruction if it's new
+ * Returns:       pointer to the profile, NULL if it isn't there or couldn't be allocated
+ * Modifies:      machine->profile when adding
+ */
+static pcProfileType * findEntry(machineType * machine, unsigned int pc, bool add)
+{
+    profileType * profile = &machine->profile;
+    unsigned int i;
+
+    //grow the hash when it gets half full
+    if(add && profile->count * 2 >= profile->size){
+        unsigned int size = profile->size == 0 ? 64 : profile->size * 2;
+        pcProfileType * old = profile->entries;
+        pcProfileType * entries = calloc(size, sizeof(pcProfileType));
+        if(entries == NULL) return NULL;
+
+        for(i = 0; i < profile->size; i++){
+            unsigned int j = old[i].pc & (size - 1);
+            if(!old[i].used) continue;
+            while(entries[j].used) j = (j + 1) & (size - 1);
+            entries[j] = old[i];
+        }
+        free(old);
+        profile->entries = entries;
+        profile->size = size;
+    }
+    if(profile->size == 0) return NULL;
+
+    i = pc & (profile->size - 1);
+    while(profile->entries[i].used && profile->entries[i].pc != pc) i = (i + 1) & (profile->size - 1);
+    if(!profile->entries[i].used){
+        if(!add) return NULL;
+        profile->entries[i].pc = pc;
+        profile->entries[i].used = TRUE;
+        profile->count++;
+    }
+    return &profile->entries[i];
+}
+
+/* Function Name: findCauser
+ * Purpose:       Finds the instruction that caused a bubble
+ *
+ * Parameters:    machine - machine being simulated
+ *                cause - CAUSE... of the bubble
+ * Returns:       address of the instruction, NOPC if there isn't one
+ * Modifies:      -
+ */
+static unsigned int findCauser(machineType * machine, int cause)
+{
+    pipelineType * cur = machine->cur;
+    int i, last = machine->config.memoryStages - 1;
+
+    switch(cause){
+        case CAUSELOADUSE:
+        case CAUSEMISPREDICT:
+        case CAUSEEXECUTE:
+            return cur->E.pc;
+        case CAUSERETMISS:
+        case CAUSEMEMORY:
+            return cur->M[last].pc;
+        case CAUSEFETCH:
+            return machine->next->F.predPC;
+        case CAUSERET:
+            if(cur->D.icode == IRET && !cur->D.predTaken) return cur->D.pc;
+            if(cur->E.icode == IRET && !cur->E.predTaken) return cur->E.pc;
+            for(i = 0; i <= last; i++)
+                if(cur->M[i].icode == IRET && !cur->M[i].predTaken) return cur->M[i].pc;
+            break;
+        case CAUSEEXCEPTION:
+            if(cur->W.stat != SAOK) return cur->W.pc;
+            for(i = last; i >= 0; i--)
+                if(cur->M[i].stat != SAOK || (i == last && machine->signals.m_stat != SAOK)) return cur->M[i].pc;
+            break;
+    }
+    return NOPC;
+}
@@ -0,0 +1,47 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+//what the pipeline did with an instruction of the program, by the address it was fetched from
+typedef struct
+{
+    unsigned int pc;
+    bool used;
+    unsigned long long count;             //times it retired
+    unsigned long long cycles;            //cycles from the instruction before it retiring to it retiring
+    unsigned long long stalled;           //cycles it was held in a stalled pipeline register
+    unsigned long long caused[CAUSES];    //bubbles it put in the pipeline, by CAUSE...
+} pcProfileType;
+
+//a line of the .yo file the program was loaded from, kept for the profile and to name functions
+typedef struct
+{
+    unsigned int address;
+    bool hasAddress;
+    bool code;                //TRUE if bytes were loaded at the address
+    char * text;              //assembly after the '|'
+} sourceLineType;
+
+//per-PC profile of a machine and the source of its program
+typedef struct
+{
+    pcProfileType * entries;  //hash by PC, grown when half full
+    unsigned int size;
+    unsigned int count;
+
+    sourceLineType * lines;
+    int lineCount;
+    int lineSize;
+
+    unsigned long long retiredAt;         //clock cycles when the last instruction retired
+} profileType;
+
+//prototypes
+void addSourceLine(machineType * machine, bool hasAddress, unsigned int address, bool code, char * text);
+bool findLabel(machineType * machine, unsigned int address, char * name, int size);
+void startProfile(machineType * machine);
+void clearProfile(machineType * machine);
+void profileRetired(machineType * machine, unsigned int pc);
+void profileStall(machineType * machine, int stage);
+void profileBubble(machineType * machine, int cause);
+void reportProfile(machineType * machine);
+#endif
@@ -1,93 +1,159 @@
-#include "bool.h"
 #include <stdio.h>
+#include "machine.h"
 #include "tools.h"
-#include "registers.h"
-#include "memory.h"
+#include "instructions.h"
 
-//'registers' are only accessible through get/setRegister() in registers.c
-static unsigned int registers[REGSIZE];
-
-//unsigned int representing the Condition Code register
-static unsigned int CC;
+//a machine's 'registers' are only accessible through get/setRegister() in registers.c
+//and its Condition Code register through get/setCC() and get/setFlags().  An opl only
+//records its operands and result with recordOpl(), the flags are worked out the
+//first time they are read after it.
 
 /* Function Name: getRegister
  * Purpose:       Returns a desired register
  *
- * Parameters:    regNum - signed int indicating register to return
+ * Parameters:    machine - machine whose registers are used
+ *                regNum - signed int indicating register to return
  * Returns:       Desired register, represented as an unsigned int
  * Modifies:      none
  */
-unsigned int getRegister(int regNum)
+unsigned int getRegister(machineType * machine, int regNum)
 {
     if(regNum > 7 || regNum < 0) return 0; //Error checking
-    else return registers[regNum]; //return register
+    else return machine->registers[regNum]; //return register
 }
 
 /* Function Name: setRegister
  * Purpose:       Sets a register to a desired value
  *
- * Parameters:    regNum - signed int indicating register to modify
+ * Parameters:    machine - machine whose registers are used
+ *                regNum - signed int indicating register to modify
  *                regValue - value to place in register
  * Returns:       none
  * Modifies:      Register indicated by regNum
  */
-void setRegister(int regNum, unsigned int regValue)
+void setRegister(machineType * machine, int regNum, unsigned int regValue)
 {
     if(regNum > 7 || regNum < 0) {} //Error checking, do nothing
-    else registers[regNum] = regValue; //Set register to value
+    else machine->registers[regNum] = regValue; //Set register to value
 }
 
 /* Function Name: clearRegisters
- * Purpose:       Clears F, D, W, E and M registers
+ * Purpose:       Clears the program registers and the condition codes
  *
- * Parameters:    none
+ * Parameters:    machine - machine whose registers are used
  * Returns:       none
- * Modifies:      F, D, W, E and M registers
+ * Modifies:      registers and CC
  */
-void clearRegisters()
+void clearRegisters(machineType * machine)
 {
    //clears the registers
-   clearFregister();
-   clearDregister();
-   clearWregister();
-   clearEregister();
-   clearMregister();
+   clearBuffer((char *) machine->registers, sizeof(machine->registers));
+   machine->CC = 0;
+   machine->lazyCC.pending = FALSE;
 }
 
 /* Function Name: setCC
  * Purpose:       Sets/clears a flag in the condition code register
  *
- * Parameters:    bitNumber - flag to set/clear
+ * Parameters:    machine - machine whose registers are used
+ *                bitNumber - flag to set/clear
  *                value - 1(set) or 0(clear)
  * Returns:       none
  * Modifies:      CC
  */
-void setCC(unsigned int bitNumber, unsigned int value)
+void setCC(machineType * machine, unsigned int bitNumber, unsigned int value)
 {
     //error checking of bitNumber
     if(bitNumber == ZF || bitNumber == SF || bitNumber == OF){
         //error checking of value
         if(value == 0 || value == 1){
-           CC =  assignOneBit(bitNumber, value, CC); //set or clear flag
+           machine->CC =  assignOneBit(bitNumber, value, getFlags(machine)); //set or clear flag
         }
-        else printf("Invalid value passed to setCC"); //for value errors
+        else fprintf(machine->out, "Invalid value passed to setCC"); //for value errors
     }
-    else printf("Invalid bitNumber passed to setCC"); //for bitNumber errors
+    else fprintf(machine->out, "Invalid bitNumber passed to setCC"); //for bitNumber errors
 }
 
 /* Function Name: getCC
  * Purpose:       Used for checking a flag in the condition code register
  *
- * Parameters:    bitNumber - flag to check
+ * Parameters:    machine - machine whose registers are used
+ *                bitNumber - flag to check
  * Returns:       unsigned int with value of flag, -1 if invalid bitNumber passed
  * Modifies:      none
  */
-unsigned int getCC(unsigned int bitNumber)
+unsigned int getCC(machineType * machine, unsigned int bitNumber)
 {
     //error checking
     if(bitNumber == ZF || bitNumber == SF || bitNumber == OF){
-        return getBits(bitNumber, bitNumber, CC); //returns value of desired flag
+        return getBits(bitNumber, bitNumber, getFlags(machine)); //returns value of desired flag
     }
-    printf("Invalid bitNumber passed to getCC"); //for errors
+    fprintf(machine->out, "Invalid bitNumber passed to getCC"); //for errors
     return -1; //invalid return option
 }
+
+/* Function Name: getFlags
+ * Purpose:       Returns the whole condition code register, working out the
+ *                flags of the last opl if that hasn't been done yet
+ *
+ * Parameters:    machine - machine whose registers are used
+ * Returns:       CC, ZF in bit 2, SF in bit 1 and OF in bit 0
+ * Modifies:      CC, lazyCC
+ */
+unsigned int getFlags(machineType * machine)
+{
+    lazyCCType * last = &machine->lazyCC;
+
+    if(last->pending){
+        int a = last->aluA, b = last->aluB, result = last->result;
+        unsigned int of = machine->CC & 1; //and and xor leave OF alone
+
+        if(last->ifun == ADDL)
+            of = (result <= 0 && a > 0 && b > 0) || (result >= 0 && a < 0 && b < 0);
+        else if(last->ifun == SUBL)
+            of = (result <= 0 && a < 0 && b > 0) || (result >= 0 && a > 0 && b < 0);
+
+        machine->CC = ((result == 0) << ZF) | ((result < 0) << SF) | (of << OF);
+        last->pending = FALSE;
+    }
+    return machine->CC;
+}
+
+/* Function Name: setFlags
+ * Purpose:       Sets the whole condition code register
+ *
+ * Parameters:    machine - machine whose registers are used
+ *                flags - ZF in bit 2, SF in bit 1 and OF in bit 0
+ * Returns:       none
+ * Modifies:      CC, lazyCC
+ */
+void setFlags(machineType * machine, unsigned int flags)
+{
+    machine->CC = flags & ((1 << ZF) | (1 << SF) | (1 << OF));
+    machine->lazyCC.pending = FALSE;
+}
+
+/* Function Name: recordOpl
+ * Purpose:       Records an opl in place of setting the condition codes
+ *
+ * Parameters:    machine - machine whose registers are used
+ *                ifun - function code of the opl
+ *                aluA, aluB - its operands, aluA is subtracted from aluB
+ *                result - its result
+ * Returns:       none
+ * Modifies:      lazyCC, CC if an opl that keeps OF follows one that sets it
+ */
+void recordOpl(machineType * machine, unsigned int ifun, unsigned int aluA, unsigned int aluB,
+    unsigned int result)
+{
+    lazyCCType * last = &machine->lazyCC;
+
+    //OF comes from the opl before this one, which has to be worked out now
+    if(ifun != ADDL && ifun != SUBL && last->pending) getFlags(machine);
+
+    last->aluA = aluA;
+    last->aluB = aluB;
+    last->result = result;
+    last->ifun = ifun;
+    last->pending = TRUE;
+}
@@ -16,12 +16,25 @@
 #define OF     0x0        //overflow flag is bit 0 of CC
 #define RNONE  0xf        //no register needed
 
+//the last opl, the condition codes it sets are only worked out when they are read
+typedef struct
+{
+    unsigned int aluA;
+    unsigned int aluB;
+    unsigned int result;
+    unsigned char ifun;
+    bool pending;             //TRUE if CC doesn't hold the condition codes of this opl yet
+} lazyCCType;
 
 //prototypes
-unsigned int getRegister(int regNum);
-void setRegister(int regNum, unsigned int regValue);
-void clearRegisters();
-void setCC(unsigned int bitNumber, unsigned int value);
-unsigned int getCC(unsigned int bitNumber);
+unsigned int getRegister(machineType * machine, int regNum);
+void setRegister(machineType * machine, int regNum, unsigned int regValue);
+void clearRegisters(machineType * machine);
+void setCC(machineType * machine, unsigned int bitNumber, unsigned int value);
+unsigned int getCC(machineType * machine, unsigned int bitNumber);
+unsigned int getFlags(machineType * machine);
+void setFlags(machineType * machine, unsigned int flags);
+void recordOpl(machineType * machine, unsigned int ifun, unsigned int aluA, unsigned int aluB,
+    unsigned int result);
 #endif
 
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+
+/*
+ * Reuse.c - profiles the LRU stack distances of the instructions the fetch
+ * stage reads and the words the memory stage reads and writes, for every
+ * line size asked for.  The distance of an access is the number of other
+ * lines touched since the last access of its line, so a fully associative
+ * LRU cache of n lines hits exactly the accesses with a distance below n and
+ * one run gives the miss ratio of every cache size.
+ *
+ * Each access of a line is given the next time and a line owns the time of
+ * its last access only.  The distance is the number of owned times after the
+ * one the line owns, counted with a Fenwick tree.  When the times run out the
+ * owned ones are renumbered from 0, which keeps the tree as small as the
+ * number of lines however long the program runs.
+ */
+
+//size of the tables of a stream when it starts
+#define REUSESTART 1024
+
+//prototypes of functions only called within this file
+static bool startStream(reuseStreamType * stream);
+static void clearStream(reuseStreamType * stream);
+static void recordLine(reuseStreamType * stream, unsigned int line);
+static unsigned int findSlot(reuseStreamType * stream, unsigned int key);
+static bool growTable(reuseStreamType * stream);
+static bool renumberTimes(reuseStreamType * stream);
+static void addTime(reuseStreamType * stream, unsigned int time, int count);
+static unsigned int countTimes(reuseStreamType * stream, unsigned int time);
+static void reportStream(machineType * machine, const char * name, reuseStreamType * stream, int bits);
+//end prototypes
+
+/* Function Name: clearReuse
+ * Purpose:       Releases the reuse distance profiles of a machine
+ *
+ * Parameters:    machine - machine whose profiles are released
+ * Returns:       -
+ * Modifies:      machine->reuse
+ */
+void clearReuse(machineType * machine)
+{
+    int bits;
+
+    for(bits = 0; bits <= MAXREUSEBITS; bits++){
+        clearStream(&machine->reuse.fetches[bits]);
+        clearStream(&machine->reuse.data[bits]);
+    }
+}
+
+/* Function Name: startReuse
+ * Purpose:       Starts empty profiles for the line sizes in the configuration
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       TRUE if the profiles could be allocated, FALSE otherwise
+ * Modifies:      machine->reuse
+ */
+bool startReuse(machineType * machine)
+{
+    int bits;
+
+    clearReuse(machine);
+    for(bits = MINREUSEBITS; bits <= MAXREUSEBITS; bits++){
+        if(!(machine->config.reuseLines & (1 << bits))) continue;
+        if(!startStream(&machine->reuse.fetches[bits]) || !startStream(&machine->reuse.data[bits]))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Function Name: reuseFetch
+ * Purpose:       Profiles the lines an instruction is read from
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the instruction
+ *                bytes - length of the instruction
+ * Returns:       -
+ * Modifies:      machine->reuse
+ */
+void reuseFetch(machineType * machine, unsigned int address, unsigned int bytes)
+{
+    int bits;
+
+    if(machine->config.reuseLines == 0) return;
+    for(bits = MINREUSEBITS; bits <= MAXREUSEBITS; bits++){
+        if(!(machine->config.reuseLines & (1 << bits))) continue;
+        recordLine(&machine->reuse.fetches[bits], address >> bits);
+        if(((address + bytes - 1) >> bits) != (address >> bits))
+            recordLine(&machine->reuse.fetches[bits], (address + bytes - 1) >> bits);
+    }
+}
+
+/* Function Name: reuseData
+ * Purpose:       Profiles the lines a word is read from or written to
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word
+ * Returns:       -
+ * Modifies:      machine->reuse
+ */
+void reuseData(machineType * machine, unsigned int address)
+{
+    int bits;
+
+    if(machine->config.reuseLines == 0) return;
+    for(bits = MINREUSEBITS; bits <= MAXREUSEBITS; bits++){
+        if(!(machine->config.reuseLines & (1 << bits))) continue;
+        recordLine(&machine->reuse.data[bits], address >> bits);
+        if(((address + 3) >> bits) != (address >> bits))
+            recordLine(&machine->reuse.data[bits], (address + 3) >> bits);
+    }
+}
+
+/* Function Name: reportReuse
+ * Purpose:       Writes the miss ratio curves of the profiled line sizes
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportReuse(machineType * machine)
+{
+    int bits;
+
+    for(bits = MINREUSEBITS; bits <= MAXREUSEBITS; bits++){
+        if(!(machine->config.reuseLines & (1 << bits))) continue;
+        reportStream(machine, "Instruction", &machine->reuse.fetches[bits], bits);
+        reportStream(machine, "Data", &machine->reuse.data[bits], bits);
+    }
+}
+
+/* Function Name: startStream
+ * Purpose:       Allocates the tables of an empty stream
+ *
+ * Parameters:    stream - stream to start
+ * Returns:       TRUE if the tables could be allocated, FALSE otherwise
+ * Modifies:      stream
+ */
+static bool startStream(reuseStreamType * stream)
+{
+    stream->slots = REUSESTART;
+    stream->shift = 22;
+    stream->keys = calloc(REUSESTART, sizeof(unsigned int));
+    stream->times = calloc(REUSESTART, sizeof(unsigned int));
+    stream->capacity = REUSESTART;
+    stream->owners = calloc(REUSESTART, sizeof(unsigned int));
+    stream->tree = calloc(REUSESTART + 1, sizeof(int));
+    return stream->keys != NULL && stream->times != NULL && stream->owners != NULL && stream->tree != NULL;
+}
+
+/* Function Name: clearStream
+ * Purpose:       Releases the tables of a stream
+ *
+ * Parameters:    stream - stream to release
+ * Returns:       -
+ * Modifies:      stream
+ */
+static void clearStream(reuseStreamType * stream)
+{
+    free(stream->keys);
+    free(stream->times);
+    free(stream->owners);
+    free(stream->tree);
+    memset(stream, 0, sizeof(reuseStreamType));
+}
+
+/* Function Name: recordLine
+ * Purpose:       Counts the distance of an access of a line and gives the
+ *                line the next time
+ *
+ * Parameters:    stream - stream accessed
+ *                line - address >> line bits
+ * Returns:       -
+ * Modifies:      stream
+ */
+static void recordLine(reuseStreamType * stream, unsigned int line)
+{
+    unsigned int key = line + 1;
+    unsigned int slot, distance;
+    int bits;
+
+    if(stream->failed) return;
+    stream->accesses++;
+
+    //the line already owns the latest time, mostly the next instruction of a line
+    if(key == stream->last){
+        stream->distances[0]++;
+        return;
+    }
+    stream->last = key;
+
+    slot = findSlot(stream, key);
+    if(stream->keys[slot] == 0){
+        stream->cold++;
+        if(2 * (stream->lines + 1) > stream->slots){
+            if(!growTable(stream)){
+                stream->failed = TRUE;
+                return;
+            }
+            slot = findSlot(stream, key);
+        }
+        stream->keys[slot] = key;
+        stream->lines++;
+    }else{
+        //the lines touched since own the times after the line's
+        distance = stream->lines - countTimes(stream, stream->times[slot]);
+        for(bits = 0; distance != 0; bits++) distance >>= 1;
+        stream->distances[bits]++;
+        stream->owners[stream->times[slot]] = 0;
+        addTime(stream, stream->times[slot], -1);
+    }
+
+    if(stream->now == stream->capacity && !renumberTimes(stream)){
+        stream->failed = TRUE;
+        return;
+    }
+    stream->owners[stream->now] = key;
+    stream->times[slot] = stream->now;
+    addTime(stream, stream->now, 1);
+    stream->now++;
+}
+
+/* Function Name: findSlot
+ * Purpose:       Finds the slot of a line in the hash table of a stream
+ *
+ * Parameters:    stream - stream to look in
+ *                key - line + 1
+ * Returns:       the slot holding the line, the empty slot it goes in if it isn't there
+ * Modifies:      -
+ */
+static unsigned int findSlot(reuseStreamType * stream, unsigned int key)
+{
+    unsigned int slot = (key * 0x9e3779b1u) >> stream->shift;
+
+    while(stream->keys[slot] != 0 && stream->keys[slot] != key)
+        slot = (slot + 1) & (stream->slots - 1);
+    return slot;
+}
+
+/* Function Name: growTable
+ * Purpose:       Doubles the hash table of a stream
+ *
+ * Parameters:    stream - stream whose table is full
+ * Returns:       TRUE if the table could be grown, FALSE otherwise
+ * Modifies:      stream
+ */
+static bool growTable(reuseStreamType * stream)
+{
+    unsigned int * keys = stream->keys, * times = stream->times;
+    unsigned int slots = stream->slots, i, slot;
+
+    stream->keys = calloc(2 * slots, sizeof(unsigned int));
+    stream->times = calloc(2 * slots, sizeof(unsigned int));
+    if(stream->keys == NULL || stream->times == NULL){
+        free(stream->keys);
+        free(stream->times);
+        stream->keys = keys;
+        stream->times = times;
+        return FALSE;
+    }
+    stream->slots = 2 * slots;
+    stream->shift--;
+    for(i = 0; i < slots; i++){
+        if(keys[i] == 0) continue;
+        slot = findSlot(stream, keys[i]);
+        stream->keys[slot] = keys[i];
+        stream->times[slot] = times[i];
+    }
+    free(keys);
+    free(times);
+    return TRUE;
+}
+
+/* Function Name: renumberTimes
+ * Purpose:       Renumbers the owned times of a stream from 0 when they run
+ *                out, doubling them if at least half are owned
+ *
+ * Parameters:    stream - stream whose times ran out
+ * Returns:       TRUE if there are free times again, FALSE if there couldn't be
+ * Modifies:      stream
+ */
+static bool renumberTimes(reuseStreamType * stream)
+{
+    unsigned int time, owned = 0, next;
+
+    //renumbering keeps the order of the times and so the distances
+    for(time = 0; time < stream->now; time++){
+        if(stream->owners[time] == 0) continue;
+        stream->owners[owned] = stream->owners[time];
+        stream->times[findSlot(stream, stream->owners[time])] = owned;
+        owned++;
+    }
+    stream->now = owned;
+
+    if(2 * owned >= stream->capacity){
+        unsigned int * owners = realloc(stream->owners, 2 * stream->capacity * sizeof(unsigned int));
+        if(owners != NULL) stream->owners = owners;
+        int * tree = owners == NULL ? NULL : realloc(stream->tree, (2 * stream->capacity + 1) * sizeof(int));
+        if(tree != NULL){
+            stream->tree = tree;
+            stream->capacity *= 2;
+        }else if(owned == stream->capacity) return FALSE;
+    }
+    memset(&stream->owners[owned], 0, (stream->capacity - owned) * sizeof(unsigned int));
+
+    //every node of the tree counts the owned times it covers
+    memset(stream->tree, 0, (stream->capacity + 1) * sizeof(int));
+    for(time = 1; time <= stream->capacity; time++){
+        if(time <= owned) stream->tree[time]++;
+        next = time + (time & -time);
+        if(next <= stream->capacity) stream->tree[next] += stream->tree[time];
+    }
+    return TRUE;
+}
+
+/* Function Name: addTime
+ * Purpose:       Changes the count of a time in the Fenwick tree of a stream
+ *
+ * Parameters:    stream - stream whose times are counted
+ *                time - time changed
+ *                count - 1 if the time is owned now, -1 if it isn't any more
+ * Returns:       -
+ * Modifies:      stream->tree
+ */
+static void addTime(reuseStreamType * stream, unsigned int time, int count)
+{
+    for(time++; time <= stream->capacity; time += time & -time)
+        stream->tree[time] += count;
+}
+
+/* Function Name: countTimes
+ * Purpose:       Counts the owned times up to a time
+ *
+ * Parameters:    stream - stream whose times are counted
+ *                time - last time counted
+ * Returns:       number of owned times from 0 to time
+ * Modifies:      -
+ */
+static unsigned int countTimes(reuseStreamType * stream, unsigned int time)
+{
+    unsigned int count = 0;
+
+    for(time++; time > 0; time -= time & -time)
+        count += stream->tree[time];
+    return count;
+}
+
+/* Function Name: reportStream
+ * Purpose:       Writes the miss ratio curve of a stream, from a cache of one
+ *                line to the first that only misses the first access of a line
+ *
+ * Parameters:    machine - machine that ran the program
+ *                name - which stream it is
+ *                stream - the stream
+ *                bits - log2 of its line size
+ * Returns:       -
+ * Modifies:      -
+ */
+static void reportStream(machineType * machine, const char * name, reuseStreamType * stream, int bits)
+{
+    unsigned long long hits = 0, misses;
+    int size;
+
+    fprintf(machine->out, "\n%s miss ratio curve = fully associative LRU %d byte lines\n", name, 1 << bits);
+    if(stream->failed)
+        fprintf(machine->out, "Out of memory, only the first %llu accesses are counted\n", stream->accesses);
+    fprintf(machine->out, "Accesses = %llu lines = %u cold misses = %llu\n", stream->accesses, stream->lines,
+            stream->cold);
+
+    //a cache of 1 << size lines hits the accesses with distances of at most size bits
+    for(size = 0; size < REUSEBUCKETS; size++){
+        hits += stream->distances[size];
+        misses = stream->accesses - hits;
+        fprintf(machine->out, "Size = %llu misses = %llu miss rate = %.2f%%\n", 1ULL << (size + bits), misses,
+                stream->accesses == 0 ? 0.0 : 100.0 * misses / stream->accesses);
+        if(misses == stream->cold) break;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef REUSE_H
+#define REUSE_H
+
+//line sizes the reuse distances can be profiled for, 1 << bits bytes
+#define MINREUSEBITS 2
+#define MAXREUSEBITS 12
+
+//distances are counted by how many bits they have, 0 to 32
+#define REUSEBUCKETS 33
+
+//LRU stack distances of the lines of one size one stream of accesses touches
+typedef struct
+{
+    //hash table of the lines accessed so far
+    unsigned int * keys;      //line + 1 in each slot, 0 for an empty slot
+    unsigned int * times;     //time of the last access of the line in each slot
+    unsigned int slots;       //a power of two
+    unsigned int shift;       //32 - log2 slots
+    unsigned int lines;       //distinct lines accessed so far
+
+    //the time of each access, a line owns the time of its last access only
+    unsigned int * owners;    //line + 1 owning each time, 0 if it was accessed again since
+    int * tree;               //Fenwick tree counting the owned times
+    unsigned int capacity;    //times before the owned ones are renumbered from 0
+    unsigned int now;
+    unsigned int last;        //line + 1 of the previous access
+    bool failed;              //TRUE once the tables couldn't grow, nothing more is counted
+
+    unsigned long long accesses, cold;
+    unsigned long long distances[REUSEBUCKETS]; //accesses whose distance has n bits
+} reuseStreamType;
+
+//the streams of a machine, indexed by log2 of the line size
+typedef struct
+{
+    reuseStreamType fetches[MAXREUSEBITS + 1];
+    reuseStreamType data[MAXREUSEBITS + 1];
+} reuseType;
+
+//prototypes
+void clearReuse(machineType * machine);
+bool startReuse(machineType * machine);
+void reuseFetch(machineType * machine, unsigned int address, unsigned int bytes);
+void reuseData(machineType * machine, unsigned int address);
+void reportReuse(machineType * machine);
+#endif
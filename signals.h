@@ -0,0 +1,28 @@
+#ifndef SIGNALS_H
+#define SIGNALS_H
+
+/* Values a stage works out during a clock cycle that the stages before it
+ * need in the same cycle, for forwarding, stalling and bubbling.  Values
+ * that are just fields of a pipeline register are read from the current
+ * registers instead, they don't change until the end of the cycle.
+ */
+typedef struct
+{
+    //memory stage
+    unsigned int m_valM;
+    unsigned char m_stat;
+    unsigned char m_retMiss;  //TRUE if a predicted ret read a different address
+    unsigned char m_busy;     //TRUE while an access takes more cycles, the earlier stages wait
+
+    //execute stage
+    unsigned int e_valE;
+    unsigned char e_dstE;
+    unsigned char e_Cnd;
+    unsigned char e_busy;     //TRUE if the instruction in execute stays there, the earlier stages wait
+
+    //decode stage
+    unsigned char d_srcA;
+    unsigned char d_srcB;
+    unsigned char d_loadUse;  //TRUE if a source register is still to be read from memory
+} signalType;
+#endif
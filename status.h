@@ -1,7 +0,0 @@
-#ifndef STATUS_H
-#define STATUS_H
-typedef struct{
-    unsigned int m_stat;
-    unsigned int W_stat;
-}statusType;
-#endif
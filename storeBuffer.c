@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <string.h>
+#include "machine.h"
+
+/*
+ * StoreBuffer.c - models the timing of a store buffer between the memory
+ * stage and the data cache.  As with the caches the bytes themselves are
+ * always in memory: a store is written to memory in the memory stage, but
+ * instead of waiting for the data cache it takes memLatency cycles and its
+ * address waits in the buffer.  The buffer writes its oldest store through
+ * the data cache in the background, one at a time.
+ *
+ * A load of the word the youngest overlapping store wrote is forwarded from
+ * the buffer and doesn't go to the cache.  A load that only partly overlaps
+ * a store waits until the store is out of the buffer, as does a store that
+ * finds the buffer full.
+ */
+
+//prototypes of functions only called within this file
+static int findStore(machineType * machine, unsigned int address);
+//end prototypes
+
+/* Function Name: startStoreBuffer
+ * Purpose:       Empties the store buffer for the loaded program
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       -
+ * Modifies:      machine->storeBuffer
+ */
+void startStoreBuffer(machineType * machine)
+{
+    memset(&machine->storeBuffer, 0, sizeof(machine->storeBuffer));
+}
+
+/* Function Name: storeBufferTick
+ * Purpose:       Starts a clock cycle of the store buffer, writing its oldest
+ *                store through the data cache
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       -
+ * Modifies:      machine->storeBuffer, machine->dcache
+ */
+void storeBufferTick(machineType * machine)
+{
+    storeBufferType * buffer = &machine->storeBuffer;
+
+    if(machine->config.storeBuffer == 0) return;
+    buffer->cycles++;
+    buffer->occupied += buffer->count;
+    if(buffer->count == 0) return;
+
+    if(!buffer->retiring){
+        buffer->retiring = TRUE;
+        buffer->remaining = machine->config.memLatency + storeDelay(machine, buffer->addresses[buffer->head]);
+    }
+    if(buffer->remaining > 0) buffer->remaining--;
+    if(buffer->remaining == 0 && storeReady(machine)){
+        buffer->retiring = FALSE;
+        buffer->head = (buffer->head + 1) % MAXSTOREBUFFER;
+        buffer->count--;
+        buffer->retired++;
+    }
+}
+
+/* Function Name: storeBlocks
+ * Purpose:       Checks whether an access has to wait for the store buffer
+ *                before it starts, counting the cycles it waits
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word accessed
+ *                write - TRUE for a store
+ * Returns:       TRUE if it is a store and the buffer is full, or a load that
+ *                only partly overlaps a buffered store
+ * Modifies:      machine->storeBuffer
+ */
+bool storeBlocks(machineType * machine, unsigned int address, bool write)
+{
+    storeBufferType * buffer = &machine->storeBuffer;
+
+    if(machine->config.storeBuffer == 0) return FALSE;
+    if(write){
+        if(buffer->count < machine->config.storeBuffer) return FALSE;
+        buffer->fullCycles++;
+    }else{
+        if(findStore(machine, address) != STOREPARTIAL) return FALSE;
+        buffer->partialCycles++;
+    }
+    return TRUE;
+}
+
+/* Function Name: forwardStore
+ * Purpose:       Checks whether a load is forwarded from the store buffer
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word loaded
+ * Returns:       TRUE if the youngest store that overlaps the word wrote it
+ * Modifies:      machine->storeBuffer
+ */
+bool forwardStore(machineType * machine, unsigned int address)
+{
+    storeBufferType * buffer = &machine->storeBuffer;
+
+    if(machine->config.storeBuffer == 0) return FALSE;
+    buffer->loads++;
+    if(findStore(machine, address) != STOREHIT) return FALSE;
+    buffer->forwarded++;
+    return TRUE;
+}
+
+/* Function Name: bufferStore
+ * Purpose:       Puts a store the memory stage did in the store buffer, which
+ *                storeBlocks made sure isn't full
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word stored
+ * Returns:       -
+ * Modifies:      machine->storeBuffer
+ */
+void bufferStore(machineType * machine, unsigned int address)
+{
+    storeBufferType * buffer = &machine->storeBuffer;
+
+    buffer->addresses[(buffer->head + buffer->count) % MAXSTOREBUFFER] = address;
+    buffer->count++;
+    buffer->stores++;
+    if(buffer->count > buffer->most) buffer->most = buffer->count;
+}
+
+/* Function Name: reportStoreBuffer
+ * Purpose:       Writes the counters of the store buffer, if the machine has one
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       -
+ * Modifies:      -
+ */
+void reportStoreBuffer(machineType * machine)
+{
+    storeBufferType * buffer = &machine->storeBuffer;
+
+    if(machine->config.storeBuffer == 0) return;
+    fprintf(machine->out, "\nStore buffer = %d entries\n", machine->config.storeBuffer);
+    fprintf(machine->out, "Stores = %llu retired = %llu average occupancy = %.2f most = %d full stall cycles = %llu\n",
+            buffer->stores, buffer->retired,
+            buffer->cycles == 0 ? 0.0 : (double) buffer->occupied / buffer->cycles, buffer->most,
+            buffer->fullCycles);
+    fprintf(machine->out, "Loads = %llu forwarded = %llu partial overlap stall cycles = %llu forwarding rate = %.2f%%\n",
+            buffer->loads, buffer->forwarded, buffer->partialCycles,
+            buffer->loads == 0 ? 0.0 : 100.0 * buffer->forwarded / buffer->loads);
+}
+
+/* Function Name: findStore
+ * Purpose:       Looks for the youngest buffered store that overlaps a word
+ *
+ * Parameters:    machine - machine being simulated
+ *                address - address of the word
+ * Returns:       STOREMISS, STOREHIT or STOREPARTIAL
+ * Modifies:      -
+ */
+static int findStore(machineType * machine, unsigned int address)
+{
+    storeBufferType * buffer = &machine->storeBuffer;
+    int i;
+
+    for(i = buffer->count - 1; i >= 0; i--){
+        unsigned int stored = buffer->addresses[(buffer->head + i) % MAXSTOREBUFFER];
+        if(stored == address) return STOREHIT;
+        if(stored - address + 3 < 7) return STOREPARTIAL;
+    }
+    return STOREMISS;
+}
@@ -0,0 +1,34 @@
+#ifndef STOREBUFFER_H
+#define STOREBUFFER_H
+
+//most entries a store buffer can be given
+#define MAXSTOREBUFFER 64
+
+//what a load finds in the store buffer
+#define STOREMISS 0           //no buffered store overlaps the word
+#define STOREHIT 1            //the youngest store that overlaps it wrote the same word
+#define STOREPARTIAL 2        //a store overlaps only part of the word
+
+//stores the memory stage has done that still have to go through the data cache
+typedef struct
+{
+    unsigned int addresses[MAXSTOREBUFFER];   //oldest at head, a ring
+    int head;
+    int count;
+    bool retiring;            //TRUE once the oldest store has started through the cache
+    unsigned int remaining;   //cycles it still takes
+
+    unsigned long long stores, retired, loads, forwarded;
+    unsigned long long fullCycles, partialCycles;
+    unsigned long long cycles, occupied;      //for the average occupancy
+    int most;
+} storeBufferType;
+
+//prototypes
+void startStoreBuffer(machineType * machine);
+void storeBufferTick(machineType * machine);
+bool storeBlocks(machineType * machine, unsigned int address, bool write);
+bool forwardStore(machineType * machine, unsigned int address);
+void bufferStore(machineType * machine, unsigned int address);
+void reportStoreBuffer(machineType * machine);
+#endif
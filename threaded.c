@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "machine.h"
+#include "tools.h"
+#include "instructions.h"
+#include "opcodes.h"
+#include "functional.h"
+#include "threaded.h"
+
+/*
+ * Threaded.c - simulates a program by translating it into threaded code.
+ * The first time a block of instructions is reached it is decoded into
+ * an array of threadedInstTypes, each holding the address of the code that
+ * executes it, and every instruction after that jumps straight to the code
+ * of the next one (computed goto) instead of going through the pipeline.
+ * Blocks end at a jump, call, ret or halt and are linked to the blocks
+ * they go to the first time they are taken.  Common pairs of instructions
+ * are fused into one handler that runs both.
+ *
+ * The program registers and condition codes are kept in local variables
+ * while the program runs and copied back to the machine before anything
+ * outside this file looks at them.  A store into translated code flushes
+ * every translation.
+ */
+
+//register file indices of the registers that don't exist
+#define RZERO 8               //always reads as 0
+#define RSINK 9               //writes to it are dropped
+
+//indices of the handlers
+#define HHALT 0
+#define HNOP 1
+#define HRRMOVL 2
+#define HCMOVXX 3
+#define HIRMOVL 4
+#define HRMMOVL 5
+#define HMRMOVL 6
+#define HOPL 7
+#define HJMP 8
+#define HJXX 9
+#define HCALL 10
+#define HRET 11
+#define HPUSHL 12
+#define HPOPL 13
+#define HDUMP 14
+#define HERROR 15
+#define HFALLTHROUGH 16       //end of a block that was cut at MAXBLOCKLEN
+#define HIRMOVLOPL 17         //fused pairs
+#define HMRMOVLOPL 18
+#define HOPLJXX 19
+#define HANDLERS 20
+
+//runs the next instruction of the block
+#define NEXT()                                                                           \
+    do {                                                                                 \
+        count++;                                                                         \
+        ip++;                                                                            \
+        goto *ip->handler;                                                               \
+    } while(0)
+
+//goes to the block at address, linking it to the instruction the first time
+#define FOLLOW(link, address)                                                            \
+    do {                                                                                 \
+        if(ip->link == NULL) ip->link = findBlock(cache, machine, (address), handlers);  \
+        if(ip->link == NULL){                                                            \
+            pc = (address);                                                              \
+            goto dispatch;                                                               \
+        }                                                                                \
+        ip = ip->link;                                                                   \
+        goto *ip->handler;                                                               \
+    } while(0)
+
+//stops the program after this instruction
+#define STOP(status)                                                                     \
+    do {                                                                                 \
+        count++;                                                                         \
+        stat = (status);                                                                 \
+        goto stop;                                                                       \
+    } while(0)
+
+//checks whether a store overwrote translated code and if so starts again at nextPC
+#define STORED(address, nextPC)                                                          \
+    do {                                                                                 \
+        if(isCode(cache, (address))){                                                    \
+            pc = (nextPC);                                                               \
+            count++;                                                                     \
+            flushThreaded(cache);                                                        \
+            goto dispatch;                                                               \
+        }                                                                                \
+    } while(0)
+
+//copies the registers and condition codes back to the machine
+#define SYNC()                                                                           \
+    do {                                                                                 \
+        for(i = 0; i < REGSIZE; i++) machine->registers[i] = reg[i];                    \
+        setFlags(machine, cc);                                                           \
+    } while(0)
+
+//prototypes of functions only called within this file
+static threadedInstType * findBlock(threadedCacheType * cache, machineType * machine, unsigned int pc,
+                                    void * const * handlers);
+static threadedInstType * translateBlock(threadedCacheType * cache, machineType * machine, unsigned int pc,
+                                         void * const * handlers);
+static bool translateInstruction(threadedInstType * entry, predecodeType * inst, void * const * handlers);
+static void flushThreaded(threadedCacheType * cache);
+static bool isCode(threadedCacheType * cache, unsigned int address);
+//end prototypes
+
+/* Function Name: runThreaded
+ * Purpose:       Simulates the loaded program by translating it into threaded
+ *                code, until it halts or causes an error.
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       number of instructions executed, including the one that
+ *                stopped the program
+ * Modifies:      machine
+ */
+unsigned long long runThreaded(machineType * machine)
+{
+    static void * const handlers[HANDLERS] =
+    {
+        [HHALT] = &&halt,
+        [HNOP] = &&nop,
+        [HRRMOVL] = &&rrmovl,
+        [HCMOVXX] = &&cmovxx,
+        [HIRMOVL] = &&irmovl,
+        [HRMMOVL] = &&rmmovl,
+        [HMRMOVL] = &&mrmovl,
+        [HOPL] = &&opl,
+        [HJMP] = &&jmp,
+        [HJXX] = &&jxx,
+        [HCALL] = &&call,
+        [HRET] = &&ret,
+        [HPUSHL] = &&pushl,
+        [HPOPL] = &&popl,
+        [HDUMP] = &&dump,
+        [HERROR] = &&error,
+        [HFALLTHROUGH] = &&fallthrough,
+        [HIRMOVLOPL] = &&irmovlopl,
+        [HMRMOVLOPL] = &&mrmovlopl,
+        [HOPLJXX] = &&opljxx
+    };
+
+    threadedCacheType * cache = calloc(1, sizeof(threadedCacheType));
+    threadedInstType * ip;
+    unsigned int reg[16] = {0};
+    unsigned int cc = getFlags(machine);
+    unsigned int pc = 0;
+    unsigned int stat, address, valE, valM;
+    bool memError = FALSE;
+    unsigned long long count = 0;
+    int i;
+
+    if(cache == NULL){
+        printf("Unable to allocate the threaded code\n");
+        exit(1);
+    }
+    for(i = 0; i < REGSIZE; i++) reg[i] = machine->registers[i];
+
+dispatch:
+    ip = findBlock(cache, machine, pc, handlers);
+    if(ip == NULL){
+        flushThreaded(cache);
+        ip = findBlock(cache, machine, pc, handlers);
+    }
+    goto *ip->handler;
+
+halt:
+    STOP(SHLT);
+
+error:
+    STOP(ip->stat);
+
+nop:
+    NEXT();
+
+rrmovl:
+    reg[ip->dst] = reg[ip->srcA];
+    NEXT();
+
+cmovxx:
+    if(CONDITION(ip->ifun, cc)) reg[ip->dst] = reg[ip->srcA];
+    NEXT();
+
+irmovl:
+    reg[ip->dst] = ip->valC;
+    NEXT();
+
+rmmovl:
+    address = reg[ip->srcB] + ip->valC;
+    putWord(machine, address, reg[ip->srcA], &memError);
+    if(memError) STOP(SADR);
+    STORED(address, ip->valP);
+    NEXT();
+
+mrmovl:
+    valM = getWord(machine, reg[ip->srcB] + ip->valC, &memError);
+    if(memError) STOP(SADR);
+    reg[ip->dst] = valM;
+    NEXT();
+
+opl:
+    OPL(ip->ifun, reg[ip->srcA], reg[ip->srcB], valE, cc);
+    reg[ip->dst] = valE;
+    NEXT();
+
+jmp:
+    count++;
+    FOLLOW(target, ip->valC);
+
+jxx:
+    count++;
+    if(CONDITION(ip->ifun, cc)) FOLLOW(target, ip->valC);
+    FOLLOW(next, ip->valP);
+
+call:
+    address = reg[ESP] - 4;
+    putWord(machine, address, ip->valP, &memError);
+    if(memError) STOP(SADR);
+    reg[ESP] = address;
+    STORED(address, ip->valC);
+    count++;
+    FOLLOW(target, ip->valC);
+
+ret:
+    address = reg[ESP];
+    valM = getWord(machine, address, &memError);
+    if(memError) STOP(SADR);
+    reg[ESP] = address + 4;
+    count++;
+    pc = valM;
+    goto dispatch;
+
+pushl:
+    address = reg[ESP] - 4;
+    putWord(machine, address, reg[ip->srcA], &memError);
+    if(memError) STOP(SADR);
+    reg[ESP] = address;
+    STORED(address, ip->valP);
+    NEXT();
+
+popl:
+    address = reg[ESP];
+    valM = getWord(machine, address, &memError);
+    if(memError) STOP(SADR);
+    reg[ESP] = address + 4;
+    reg[ip->dst] = valM;
+    NEXT();
+
+dump:
+    SYNC();
+    retire(machine, SAOK, IDUMP, ip->valC);
+    NEXT();
+
+fallthrough:
+    FOLLOW(next, ip->valP);
+
+irmovlopl:
+    reg[ip->dst] = ip->valC;
+    count++;
+    ip++;
+    goto opl;
+
+mrmovlopl:
+    valM = getWord(machine, reg[ip->srcB] + ip->valC, &memError);
+    if(memError) STOP(SADR);
+    reg[ip->dst] = valM;
+    count++;
+    ip++;
+    goto opl;
+
+opljxx:
+    OPL(ip->ifun, reg[ip->srcA], reg[ip->srcB], valE, cc);
+    reg[ip->dst] = valE;
+    count++;
+    ip++;
+    goto jxx;
+
+stop:
+    SYNC();
+    retire(machine, stat, IHALT, 0);
+    free(cache);
+    return count;
+}
+
+/* Function Name: findBlock
+ * Purpose:       Finds the translated block that starts at an address,
+ *                translating it if it hasn't been
+ *
+ * Parameters:    cache - translations of the program
+ *                machine - machine holding the program
+ *                pc - address of the block
+ *                handlers - addresses of the handlers
+ * Returns:       first instruction of the block, NULL if there is no room
+ *                left to translate it
+ * Modifies:      cache
+ */
+static threadedInstType * findBlock(threadedCacheType * cache, machineType * machine, unsigned int pc,
+                                    void * const * handlers)
+{
+    threadedBlockType * block = &cache->blocks[pc & (THREADEDBLOCKS - 1)];
+
+    if(block->code != NULL && block->pc == pc) return block->code;
+    if(cache->used + MAXBLOCKLEN + 1 > THREADEDCODESIZE) return NULL;
+
+    block->pc = pc;
+    block->code = translateBlock(cache, machine, pc, handlers);
+    return block->code;
+}
+
+/* Function Name: translateBlock
+ * Purpose:       Translates the instructions from an address up to the next
+ *                jump, call, ret or halt, at most MAXBLOCKLEN of them, then
+ *                fuses pairs of them
+ *
+ * Parameters:    cache - translations of the program
+ *                machine - machine holding the program
+ *                pc - address of the block
+ *                handlers - addresses of the handlers
+ * Returns:       first instruction of the block
+ * Modifies:      cache
+ */
+static threadedInstType * translateBlock(threadedCacheType * cache, machineType * machine, unsigned int pc,
+                                         void * const * handlers)
+{
+    threadedInstType * start = &cache->code[cache->used];
+    threadedInstType * entry;
+    unsigned int length = 0;
+    unsigned int line;
+    bool end = FALSE;
+
+    while(!end){
+        //the decoded instruction, only decoded again if it isn't in the predecode cache
+        predecodeType * inst = lookupPredecode(machine, pc);
+        if(inst == NULL) inst = decodeInstruction(machine, pc);
+
+        end = translateInstruction(&cache->code[cache->used++], inst, handlers);
+
+        //mark every line the instruction's bytes fall in
+        for(line = inst->pc >> THREADEDLINEBITS; line <= (inst->valP - 1) >> THREADEDLINEBITS; line++)
+            cache->codeLines[line & (THREADEDLINES - 1)] = 1;
+
+        pc = inst->valP;
+        if(!end && ++length == MAXBLOCKLEN){
+            entry = &cache->code[cache->used++];
+            clearBuffer((char *) entry, sizeof(threadedInstType));
+            entry->handler = handlers[HFALLTHROUGH];
+            entry->valP = pc;
+            end = TRUE;
+        }
+    }
+
+    //fuse pairs, the second instruction of a pair keeps its own handler
+    for(entry = start; entry + 1 < &cache->code[cache->used]; entry++){
+        if(entry[0].handler == handlers[HIRMOVL] && entry[1].handler == handlers[HOPL])
+            entry->handler = handlers[HIRMOVLOPL];
+        else if(entry[0].handler == handlers[HMRMOVL] && entry[1].handler == handlers[HOPL])
+            entry->handler = handlers[HMRMOVLOPL];
+        else if(entry[0].handler == handlers[HOPL] && entry[1].handler == handlers[HJXX])
+            entry->handler = handlers[HOPLJXX];
+    }
+    return start;
+}
+
+/* Function Name: translateInstruction
+ * Purpose:       Translates one decoded instruction
+ *
+ * Parameters:    entry - where the translation is stored
+ *                inst - the decoded instruction
+ *                handlers - addresses of the handlers
+ * Returns:       TRUE if the instruction ends a block
+ * Modifies:      entry
+ */
+static bool translateInstruction(threadedInstType * entry, predecodeType * inst, void * const * handlers)
+{
+    const opcodeType * op = &opcodeTable[OPCODE(inst->icode, inst->ifun)];
+
+    //the descriptor's register selectors index this array
+    unsigned int regs[4] = {RNONE, inst->rA, inst->rB, ESP};
+    unsigned int srcA = regs[op->srcA];
+    unsigned int srcB = regs[op->srcB];
+    unsigned int dst = (op->dstM != SELNONE) ? regs[op->dstM] : regs[op->dstE];
+    int handler;
+
+    entry->srcA = (srcA < REGSIZE) ? srcA : RZERO;
+    entry->srcB = (srcB < REGSIZE) ? srcB : RZERO;
+    entry->dst = (dst < REGSIZE) ? dst : RSINK;
+    entry->ifun = inst->ifun;
+    entry->stat = inst->stat;
+    entry->valC = inst->valC;
+    entry->valP = inst->valP;
+    entry->target = NULL;
+    entry->next = NULL;
+
+    if(inst->stat == SHLT) handler = HHALT;
+    else if(inst->stat != SAOK) handler = HERROR;
+    else switch(inst->icode){
+        case INOP:    handler = HNOP; break;
+        case IRRMOVL: handler = (inst->ifun == RRMOVL) ? HRRMOVL : HCMOVXX; break;
+        case IIRMOVL: handler = HIRMOVL; break;
+        case IRMMOVL: handler = HRMMOVL; break;
+        case IMRMOVL: handler = HMRMOVL; break;
+        case IOPL:    handler = HOPL; break;
+        case IJXX:    handler = (inst->ifun == JMP) ? HJMP : HJXX; break;
+        case ICALL:   handler = HCALL; break;
+        case IRET:    handler = HRET; break;
+        case IPUSHL:  handler = HPUSHL; break;
+        case IPOPL:   handler = HPOPL; break;
+        case IDUMP:   handler = HDUMP; break;
+        default:      handler = HERROR; break;
+    }
+    entry->handler = handlers[handler];
+
+    return handler == HHALT || handler == HERROR || handler == HJMP || handler == HJXX ||
+           handler == HCALL || handler == HRET;
+}
+
+/* Function Name: flushThreaded
+ * Purpose:       Drops every translation
+ *
+ * Parameters:    cache - translations of the program
+ * Returns:       -
+ * Modifies:      cache
+ */
+static void flushThreaded(threadedCacheType * cache)
+{
+    cache->used = 0;
+    clearBuffer((char *) cache->blocks, sizeof(cache->blocks));
+    clearBuffer((char *) cache->codeLines, sizeof(cache->codeLines));
+}
+
+/* Function Name: isCode
+ * Purpose:       Checks whether a word written to memory may overlap a
+ *                translated instruction
+ *
+ * Parameters:    cache - translations of the program
+ *                address - first byte of the word
+ * Returns:       TRUE if a translated instruction may lie in the word
+ * Modifies:      -
+ */
+static bool isCode(threadedCacheType * cache, unsigned int address)
+{
+    return cache->codeLines[(address >> THREADEDLINEBITS) & (THREADEDLINES - 1)] ||
+           cache->codeLines[((address + 3) >> THREADEDLINEBITS) & (THREADEDLINES - 1)];
+}
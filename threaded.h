@@ -0,0 +1,54 @@
+#ifndef THREADED_H
+#define THREADED_H
+
+//most instructions translated into one block
+#define MAXBLOCKLEN 32
+
+//number of translated instructions kept before the translations are flushed
+#define THREADEDCODESIZE 16384
+
+//number of blocks that can be found by their address, indexed by the low bits of the PC
+#define THREADEDBLOCKS 4096
+
+//stores are checked against the translations in lines of 1 << THREADEDLINEBITS bytes
+#define THREADEDLINEBITS 5
+#define THREADEDLINES 4096
+
+//an instruction translated into threaded code
+typedef struct threadedInst
+{
+    const void * handler;        //code that executes the instruction
+    unsigned char srcA;          //register file indices, registers that don't
+    unsigned char srcB;          //exist read as 0 and writes to them are dropped
+    unsigned char dst;
+    unsigned char ifun;
+    unsigned char stat;
+    unsigned int valC;
+    unsigned int valP;
+
+    //blocks at valC and valP, filled in the first time they're needed
+    struct threadedInst * target;
+    struct threadedInst * next;
+} threadedInstType;
+
+//the start of a translated block
+typedef struct
+{
+    unsigned int pc;
+    threadedInstType * code;
+} threadedBlockType;
+
+//translations of one program
+typedef struct
+{
+    threadedInstType code[THREADEDCODESIZE];
+    unsigned int used;
+    threadedBlockType blocks[THREADEDBLOCKS];
+
+    //nonzero if a translated instruction may overlap the line (hashed on the line number)
+    unsigned char codeLines[THREADEDLINES];
+} threadedCacheType;
+
+//prototypes
+unsigned long long runThreaded(machineType * machine);
+#endif
@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "instructions.h"
+
+/*
+ * Trace.c - records what every pipeline register holds each clock cycle,
+ * and whether it was stalled or bubbled and why, in a binary trace file.
+ * The cycles are put in a buffer as they are simulated and written out
+ * TRACEBUFFER at a time, so tracing costs a few stores a cycle and the
+ * memory of the buffer however long the program runs.  Given a number of
+ * cycles the file is a ring that keeps only the last of them, otherwise it
+ * keeps every cycle.
+ *
+ * exportTrace reads a trace file back, one cycle at a time, and follows
+ * the instructions through the registers: an instruction in a register
+ * that wasn't stalled came from the register before it, and one in D that
+ * wasn't stalled was just fetched.  It writes the stages of each
+ * instruction as the log the Konata pipeline viewer reads or as Chrome
+ * trace events, one track per register.
+ */
+
+//names of the formats on the command line, indexed by TRACE...
+static const char * formats[TRACEFORMATS] = {"konata", "chrome"};
+
+//an instruction being followed through the registers by exportTrace
+typedef struct
+{
+    unsigned long long id;    //0 for none
+    unsigned int pc;
+    unsigned int icode;
+    unsigned long long since; //cycle it entered the register
+} tracedType;
+
+//prototypes of functions only called within this file
+static void putNumber(unsigned char * bytes, unsigned long long value, int size);
+static unsigned long long getNumber(unsigned char * bytes, int size);
+static void putSlot(unsigned char * slot, unsigned int pc, unsigned int icode, unsigned int stat, unsigned char flags);
+static bool writeHeader(traceType * trace);
+static bool flushTrace(traceType * trace);
+static void slotName(int slot, int slots, char * name);
+static void exportCycle(tracedType * was, tracedType * now, unsigned char * record, unsigned char * held, int slots,
+                        unsigned long long cycle, unsigned long long * ids, unsigned long long * retired,
+                        int format, bool * first, FILE * out);
+static void leaveSlot(tracedType * inst, int slot, int slots, unsigned long long cycle, int format, bool * first,
+                      FILE * out);
+//end prototypes
+
+/* Function Name: startTrace
+ * Purpose:       Creates the trace file the configuration gives, if any
+ *
+ * Parameters:    machine - machine holding the program
+ * Returns:       TRUE if the pipeline is traced or there is no trace, FALSE if
+ *                the file or the buffer couldn't be created
+ * Modifies:      machine->trace
+ */
+bool startTrace(machineType * machine)
+{
+    traceType * trace = &machine->trace;
+
+    memset(trace, 0, sizeof(traceType));
+    if(machine->config.traceFile == NULL) return TRUE;
+
+    trace->slots = machine->config.memoryStages + 4;
+    trace->capacity = machine->config.traceCycles;
+    trace->buffer = malloc(TRACEBUFFER * trace->slots * TRACESLOT);
+    trace->out = fopen(machine->config.traceFile, "wb");
+    if(trace->buffer == NULL || trace->out == NULL || !writeHeader(trace)){
+        if(trace->out != NULL) fclose(trace->out);
+        free(trace->buffer);
+        memset(trace, 0, sizeof(traceType));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Function Name: traceCycle
+ * Purpose:       Records the pipeline registers at the end of a clock cycle,
+ *                before the next ones become current
+ *
+ * Parameters:    machine - machine being simulated
+ * Returns:       -
+ * Modifies:      machine->trace
+ */
+void traceCycle(machineType * machine)
+{
+    traceType * trace = &machine->trace;
+    pipelineType * cur = machine->cur;
+    unsigned char * record = trace->buffer + trace->buffered * trace->slots * TRACESLOT;
+    int i, last = machine->config.memoryStages - 1;
+
+    //a stall of M holds every memory stage, a bubble from the execute stage goes into M[0]
+    putSlot(record, cur->F.predPC, INOP, SAOK, trace->flags[STAGEF]);
+    putSlot(record + TRACESLOT, cur->D.pc, cur->D.icode, cur->D.stat, trace->flags[STAGED]);
+    putSlot(record + 2 * TRACESLOT, cur->E.pc, cur->E.icode, cur->E.stat, trace->flags[STAGEE]);
+    for(i = 0; i <= last; i++)
+        putSlot(record + (3 + i) * TRACESLOT, cur->M[i].pc, cur->M[i].icode, cur->M[i].stat,
+                (i == 0 || (trace->flags[STAGEM] & TRACESTALL)) ? trace->flags[STAGEM] : 0);
+    putSlot(record + (4 + last) * TRACESLOT, cur->W.pc, cur->W.icode, cur->W.stat, trace->flags[STAGEW]);
+    memset(trace->flags, 0, sizeof(trace->flags));
+
+    trace->count++;
+    if(++trace->buffered == TRACEBUFFER && !flushTrace(trace)){
+        fprintf(stderr, "Unable to write the trace\n");
+        fclose(trace->out);
+        trace->out = NULL;
+    }
+}
+
+/* Function Name: endTrace
+ * Purpose:       Writes out the cycles left in the buffer and closes the
+ *                trace file
+ *
+ * Parameters:    machine - machine that ran the program
+ * Returns:       TRUE if the whole trace was written, FALSE otherwise
+ * Modifies:      machine->trace
+ */
+bool endTrace(machineType * machine)
+{
+    traceType * trace = &machine->trace;
+    bool written;
+
+    if(trace->out == NULL){
+        free(trace->buffer);
+        trace->buffer = NULL;
+        return machine->config.traceFile == NULL;
+    }
+    written = flushTrace(trace) && writeHeader(trace);
+    if(fclose(trace->out) != 0) written = FALSE;
+    free(trace->buffer);
+    memset(trace, 0, sizeof(traceType));
+    return written;
+}
+
+/* Function Name: traceFlags
+ * Purpose:       Records that a pipeline register is stalled or bubbled at
+ *                the end of this cycle
+ *
+ * Parameters:    machine - machine being simulated
+ *                stage - STAGE... of the register
+ *                flag - TRACESTALL or TRACEBUBBLE
+ *                cause - CAUSE... of it
+ * Returns:       -
+ * Modifies:      machine->trace
+ */
+void traceFlags(machineType * machine, int stage, int flag, int cause)
+{
+    machine->trace.flags[stage] = flag | cause << TRACECAUSESHIFT;
+}
+
+/* Function Name: findTraceFormat
+ * Purpose:       Looks up a format a trace can be exported to by name
+ *
+ * Parameters:    name - name of the format
+ * Returns:       TRACE... of the format, -1 if there isn't one with that name
+ * Modifies:      -
+ */
+int findTraceFormat(char * name)
+{
+    int i;
+
+    for(i = 0; i < TRACEFORMATS; i++)
+        if(strcmp(formats[i], name) == 0) return i;
+    return -1;
+}
+
+/* Function Name: exportTrace
+ * Purpose:       Writes the instructions of a trace file and the stages they
+ *                went through in a format a pipeline viewer reads
+ *
+ * Parameters:    fileName - the trace file
+ *                format - TRACE... to write
+ *                out - stream to write to
+ * Returns:       TRUE if the trace was exported, FALSE if it couldn't be read
+ * Modifies:      -
+ */
+bool exportTrace(char * fileName, int format, FILE * out)
+{
+    unsigned char header[TRACEHEADER], record[TRACESLOTS * TRACESLOT], held[TRACESLOTS];
+    tracedType insts[2][TRACESLOTS];
+    unsigned long long capacity, count, cycles, cycle, position, ids = 0, retired = 0;
+    int slot, slots, now = 0;
+    bool first = TRUE;
+    char name[8];
+    FILE * in = fopen(fileName, "rb");
+
+    if(in == NULL) return FALSE;
+    if(fread(header, 1, TRACEHEADER, in) != TRACEHEADER || memcmp(header, TRACEMAGIC, 8) != 0){
+        fclose(in);
+        return FALSE;
+    }
+    slots = getNumber(header + 8, 4);
+    capacity = getNumber(header + 16, 8);
+    count = getNumber(header + 24, 8);
+    if(slots < 5 || slots > TRACESLOTS){
+        fclose(in);
+        return FALSE;
+    }
+
+    //a ring that wrapped starts at its oldest cycle
+    cycles = (capacity != 0 && count > capacity) ? capacity : count;
+    position = capacity == 0 ? 0 : (count - cycles) % capacity;
+    fseeko(in, TRACEHEADER + position * slots * TRACESLOT, SEEK_SET);
+
+    if(format == TRACEKONATA) fprintf(out, "Kanata\t0004\nC=\t%llu\n", count - cycles);
+    else{
+        fprintf(out, "{\"traceEvents\": [\n");
+        for(slot = 0; slot < slots; slot++){
+            slotName(slot, slots, name);
+            fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                    "\"args\": {\"name\": \"%s\"}}", first ? "" : ",\n", slot, name);
+            first = FALSE;
+        }
+    }
+
+    memset(insts, 0, sizeof(insts));
+    memset(held, 0, sizeof(held));
+    for(cycle = count - cycles; cycle < count; cycle++){
+        if(capacity != 0 && position++ == capacity){
+            fseeko(in, TRACEHEADER, SEEK_SET);
+            position = 1;
+        }
+        if(fread(record, TRACESLOT, slots, in) != (size_t) slots) break;
+        if(format == TRACEKONATA && cycle > count - cycles) fprintf(out, "C\t1\n");
+        exportCycle(insts[now], insts[1 - now], record, held, slots, cycle, &ids, &retired, format, &first, out);
+        now = 1 - now;
+    }
+
+    //the instructions left behind the one that stopped the program never retire
+    for(slot = 1; slot < slots; slot++){
+        tracedType * inst = &insts[now][slot];
+        if(inst->id == 0) continue;
+        leaveSlot(inst, slot, slots, cycle, format, &first, out);
+        if(format == TRACEKONATA)
+            fprintf(out, "R\t%llu\t%llu\t%d\n", inst->id, slot == slots - 1 ? retired++ : 0, slot != slots - 1);
+    }
+    if(format == TRACECHROME) fprintf(out, "\n]}\n");
+    fclose(in);
+    return TRUE;
+}
+
+/* Function Name: exportCycle
+ * Purpose:       Follows the instructions from one cycle of a trace to the
+ *                next and writes what changed
+ *
+ * Parameters:    was - the instruction in each register the cycle before
+ *                now - gets the instruction in each register this cycle
+ *                record - the cycle read from the trace
+ *                held - TRUE for each register stalled the cycle before, gets
+ *                       those stalled this cycle
+ *                slots - registers in a cycle
+ *                cycle - the cycle
+ *                ids - the last instruction id given out
+ *                retired - instructions retired so far
+ *                format - TRACE... being written
+ *                first - TRUE until an event has been written
+ *                out - stream to write to
+ * Returns:       -
+ * Modifies:      now, held, ids, retired, first
+ */
+static void exportCycle(tracedType * was, tracedType * now, unsigned char * record, unsigned char * held, int slots,
+                        unsigned long long cycle, unsigned long long * ids, unsigned long long * retired,
+                        int format, bool * first, FILE * out)
+{
+    int slot, from;
+    char name[8];
+
+    //oldest first, so the instructions already in the registers when the trace starts
+    //get their ids in program order
+    for(slot = slots - 1; slot >= 0; slot--){
+        unsigned char * bytes = record + slot * TRACESLOT;
+        tracedType * inst = &now[slot];
+        unsigned char flags = bytes[5];
+
+        inst->id = 0;
+        inst->pc = getNumber(bytes, 4);
+        inst->icode = bytes[4] >> 4;
+
+        //stalls and bubbles are instant events on the track of their register
+        if(format == TRACECHROME && flags != 0){
+            fprintf(out, ",\n{\"name\": \"%s %s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %llu, \"pid\": 1, "
+                    "\"tid\": %d}", (flags & TRACESTALL) ? "stall" : "bubble",
+                    causeName(flags >> TRACECAUSESHIFT), cycle, slot);
+            *first = FALSE;
+        }
+        if(slot == 0 || inst->pc == NOPC){
+            held[slot] = flags & TRACESTALL;
+            continue;
+        }
+
+        //the same instruction is still there or came from the register before
+        from = held[slot] ? slot : slot - 1;
+        if(from > 0 && was[from].id != 0 && was[from].pc == inst->pc && was[from].icode == inst->icode){
+            inst->id = was[from].id;
+            inst->since = from == slot ? was[from].since : cycle;
+        }else{
+            inst->id = ++*ids;
+            inst->since = cycle;
+        }
+        held[slot] = flags & TRACESTALL;
+    }
+
+    //the instructions that moved on, retired or were squashed
+    for(slot = 1; slot < slots; slot++){
+        tracedType * inst = &was[slot];
+        if(inst->id == 0) continue;
+        if(now[slot].id == inst->id) continue;
+        leaveSlot(inst, slot, slots, cycle, format, first, out);
+        if(slot + 1 < slots && now[slot + 1].id == inst->id) continue;
+        if(format == TRACEKONATA)
+            fprintf(out, "R\t%llu\t%llu\t%d\n", inst->id, slot == slots - 1 ? (*retired)++ : 0, slot != slots - 1);
+    }
+
+    //the instructions that came into a register, oldest first
+    for(slot = slots - 1; slot >= 1; slot--){
+        tracedType * inst = &now[slot];
+        if(inst->id == 0 || inst->since != cycle || format != TRACEKONATA) continue;
+        slotName(slot, slots, name);
+        if(slot == 1 || was[slot - 1].id != inst->id){
+            fprintf(out, "I\t%llu\t%llu\t0\n", inst->id, inst->id);
+            fprintf(out, "L\t%llu\t0\t0x%03x: %s\n", inst->id, inst->pc, icodeName(inst->icode));
+        }
+        fprintf(out, "S\t%llu\t0\t%s\n", inst->id, name);
+    }
+}
+
+/* Function Name: leaveSlot
+ * Purpose:       Writes that an instruction left a register
+ *
+ * Parameters:    inst - the instruction
+ *                slot - the register
+ *                slots - registers in a cycle
+ *                cycle - cycle it is no longer there
+ *                format - TRACE... being written
+ *                first - TRUE until an event has been written
+ *                out - stream to write to
+ * Returns:       -
+ * Modifies:      first
+ */
+static void leaveSlot(tracedType * inst, int slot, int slots, unsigned long long cycle, int format, bool * first,
+                      FILE * out)
+{
+    char name[8];
+
+    slotName(slot, slots, name);
+    if(format == TRACEKONATA) fprintf(out, "E\t%llu\t0\t%s\n", inst->id, name);
+    else{
+        fprintf(out, "%s{\"name\": \"%s 0x%03x\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %llu, \"dur\": %llu, "
+                "\"pid\": 1, \"tid\": %d, \"args\": {\"id\": %llu}}", *first ? "" : ",\n", icodeName(inst->icode),
+                inst->pc, name, inst->since, cycle - inst->since, slot, inst->id);
+        *first = FALSE;
+    }
+}
+
+/* Function Name: slotName
+ * Purpose:       Names a register of a trace
+ *
+ * Parameters:    slot - index of the register in a cycle
+ *                slots - registers in a cycle
+ *                name - gets the name, room for 8 bytes
+ * Returns:       -
+ * Modifies:      name
+ */
+static void slotName(int slot, int slots, char * name)
+{
+    if(slot < 3) snprintf(name, 8, "%c", "FDE"[slot]);
+    else if(slot == slots - 1) snprintf(name, 8, "W");
+    else if(slots == 5) snprintf(name, 8, "M");
+    else snprintf(name, 8, "M%c", '0' + slot - 3);
+}
+
+/* Function Name: putSlot
+ * Purpose:       Packs what a register holds into a slot of a record
+ *
+ * Parameters:    slot - the slot
+ *                pc, icode, stat - the instruction in the register
+ *                flags - TRACESTALL or TRACEBUBBLE and the cause, 0 for neither
+ * Returns:       -
+ * Modifies:      slot
+ */
+static void putSlot(unsigned char * slot, unsigned int pc, unsigned int icode, unsigned int stat, unsigned char flags)
+{
+    slot[0] = pc;
+    slot[1] = pc >> 8;
+    slot[2] = pc >> 16;
+    slot[3] = pc >> 24;
+    slot[4] = (icode << 4) | (stat & 0xf);
+    slot[5] = flags;
+}
+
+/* Function Name: putNumber
+ * Purpose:       Writes a number little endian
+ *
+ * Parameters:    bytes - where to write it
+ *                value - the number
+ *                size - bytes it takes
+ * Returns:       -
+ * Modifies:      bytes
+ */
+static void putNumber(unsigned char * bytes, unsigned long long value, int size)
+{
+    int i;
+
+    for(i = 0; i < size; i++) bytes[i] = value >> (8 * i);
+}
+
+/* Function Name: getNumber
+ * Purpose:       Reads a number written little endian
+ *
+ * Parameters:    bytes - where it was written
+ *                size - bytes it takes
+ * Returns:       the number
+ * Modifies:      -
+ */
+static unsigned long long getNumber(unsigned char * bytes, int size)
+{
+    unsigned long long value = 0;
+    int i;
+
+    for(i = size - 1; i >= 0; i--) value = (value << 8) | bytes[i];
+    return value;
+}
+
+/* Function Name: writeHeader
+ * Purpose:       Writes the header of a trace file with the cycles traced
+ *
+ * Parameters:    trace - the tracer
+ * Returns:       TRUE if it was written, FALSE otherwise
+ * Modifies:      the file
+ */
+static bool writeHeader(traceType * trace)
+{
+    unsigned char header[TRACEHEADER];
+
+    memset(header, 0, TRACEHEADER);
+    memcpy(header, TRACEMAGIC, 8);
+    putNumber(header + 8, trace->slots, 4);
+    putNumber(header + 16, trace->capacity, 8);
+    putNumber(header + 24, trace->count, 8);
+    return fseeko(trace->out, 0, SEEK_SET) == 0 && fwrite(header, 1, TRACEHEADER, trace->out) == TRACEHEADER;
+}
+
+/* Function Name: flushTrace
+ * Purpose:       Writes the buffered cycles to the trace file, where a ring
+ *                wraps back to its first cycle
+ *
+ * Parameters:    trace - the tracer
+ * Returns:       TRUE if they were written, FALSE otherwise
+ * Modifies:      trace, the file
+ */
+static bool flushTrace(traceType * trace)
+{
+    unsigned long long cycle = trace->count - trace->buffered;
+    int size = trace->slots * TRACESLOT;
+    int done = 0;
+
+    while(done < trace->buffered){
+        unsigned long long position = trace->capacity == 0 ? cycle + done : (cycle + done) % trace->capacity;
+        int cycles = trace->buffered - done;
+
+        if(trace->capacity != 0 && position + cycles > trace->capacity) cycles = trace->capacity - position;
+        if(fseeko(trace->out, TRACEHEADER + position * size, SEEK_SET) != 0) return FALSE;
+        if(fwrite(trace->buffer + done * size, size, cycles, trace->out) != (size_t) cycles) return FALSE;
+        done += cycles;
+    }
+    trace->buffered = 0;
+    return TRUE;
+}
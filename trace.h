@@ -0,0 +1,47 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+//what happened to a pipeline register at the end of a cycle, with the CAUSE... in the bits above
+#define TRACESTALL 1          //it kept its instruction
+#define TRACEBUBBLE 2         //it was given a bubble
+#define TRACECAUSESHIFT 2
+
+//formats a trace can be exported to
+#define TRACEKONATA 0         //the log of the Konata pipeline viewer
+#define TRACECHROME 1         //Chrome trace event JSON, for chrome://tracing or Perfetto
+#define TRACEFORMATS 2
+
+//a trace file is a header and then a record per cycle, each a slot for F, D, E, every
+//M and W.  A slot is the pc, a byte of icode << 4 | stat and a byte of flags, and every
+//number in the file is little endian
+#define TRACEMAGIC "yesstrc1"
+#define TRACEHEADER 32
+#define TRACESLOT 6
+#define TRACESLOTS (MAXMEMSTAGES + 4)
+
+//cycles the tracer buffers before writing them out
+#define TRACEBUFFER 4096
+
+//tracer of a machine
+typedef struct
+{
+    FILE * out;               //NULL when the pipeline isn't traced
+    int slots;
+    unsigned long long capacity;          //cycles the file holds before it wraps, 0 for no limit
+    unsigned long long count;             //cycles traced
+
+    //what happened to each pipeline register this cycle, set as the stages count it
+    unsigned char flags[STAGES];
+
+    unsigned char * buffer;   //the cycles not written out yet
+    int buffered;
+} traceType;
+
+//prototypes
+bool startTrace(machineType * machine);
+void traceCycle(machineType * machine);
+bool endTrace(machineType * machine);
+void traceFlags(machineType * machine, int stage, int flag, int cause);
+int findTraceFormat(char * name);
+bool exportTrace(char * fileName, int format, FILE * out);
+#endif
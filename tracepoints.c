@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include "machine.h"
+#include "instructions.h"
+
+/*
+ * Tracepoints.c - the hooks of the tracepoints in the pipeline stages.  A
+ * tracepoint only costs anything in yess-instrumented, which is built with
+ * TRACEPOINTS defined: there it calls the hook of its event if one is set,
+ * in yess it is compiled out.  The hooks are shared by every machine and
+ * are set before any program is run.
+ *
+ * logTracepoints sets a hook on every event that writes it to the output
+ * of the machine, one line per event with the clock cycle it happened in.
+ */
+
+tracepointType tracepoints[TPEVENTS];
+
+//names of the registers and the stages a hook is passed
+static const char * registerNames[8] = {"%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi"};
+static const char * sourceNames[STAGES + 1] = {"F", "D", "E", "M", "W", "registers"};
+
+//prototypes of functions only called within this file
+static void logEvent(machineType * machine, int event, unsigned int pc, unsigned int a, unsigned int b);
+//end prototypes
+
+/* Function Name: setTracepoint
+ * Purpose:       Sets the hook called at the tracepoints of an event
+ *
+ * Parameters:    event - TP... of the tracepoints
+ *                hook - function to call, NULL for none
+ * Returns:       -
+ * Modifies:      tracepoints
+ */
+void setTracepoint(int event, tracepointType hook)
+{
+    tracepoints[event] = hook;
+}
+
+/* Function Name: logTracepoints
+ * Purpose:       Writes every event the tracepoints see to the output of the
+ *                machine it happened in
+ *
+ * Parameters:    -
+ * Returns:       TRUE if the tracepoints are compiled in, FALSE if this is a
+ *                build without them
+ * Modifies:      tracepoints
+ */
+bool logTracepoints(void)
+{
+    int event;
+
+    for(event = 0; event < TPEVENTS; event++) setTracepoint(event, logEvent);
+#ifdef TRACEPOINTS
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+/* Function Name: logEvent
+ * Purpose:       Hook that writes an event to the output of the machine
+ *
+ * Parameters:    machine - machine being simulated
+ *                event - TP... of the event
+ *                pc, a, b - the numbers the tracepoint passes
+ * Returns:       -
+ * Modifies:      -
+ */
+static void logEvent(machineType * machine, int event, unsigned int pc, unsigned int a, unsigned int b)
+{
+    FILE * out = machine->out;
+
+    //the bubbles the pipeline starts with write nothing the program asked for
+    if(event == TPREGISTER && (a == RNONE || pc == NOPC)) return;
+    fprintf(out, "%llu ", machine->cycles);
+    switch(event){
+        case TPFETCH:
+            fprintf(out, "fetch 0x%03x %s %x\n", pc, icodeName(a), b);
+            break;
+        case TPFORWARD:
+            fprintf(out, "forward 0x%03x %s from %s\n", pc, registerNames[a & 7], sourceNames[b]);
+            break;
+        case TPBUBBLE:
+            fprintf(out, "bubble %s %s\n", sourceNames[a], causeName(b));
+            break;
+        case TPREAD:
+        case TPWRITE:
+            fprintf(out, "%s 0x%03x [0x%x] = 0x%08x\n", event == TPREAD ? "read" : "write", pc, a, b);
+            break;
+        case TPREGISTER:
+            fprintf(out, "register 0x%03x %s = 0x%08x\n", pc, registerNames[a & 7], b);
+            break;
+        case TPDUMP:
+            fprintf(out, "dump 0x%03x %x\n", pc, a);
+            break;
+        case TPHALT:
+            fprintf(out, "halt 0x%03x stat %x\n", pc, a);
+            break;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TRACEPOINTS_H
+#define TRACEPOINTS_H
+
+//events the pipeline stages have a tracepoint at, and what a hook is passed with each
+#define TPFETCH 0             //an instruction goes on to decode: its pc, icode and ifun
+#define TPFORWARD 1           //decode reads a source: pc, the register and the STAGE... it came from
+#define TPBUBBLE 2            //a bubble is put in a register: NOPC, its STAGE... and the CAUSE...
+#define TPREAD 3              //a load reads memory: pc, the address and the word read
+#define TPWRITE 4             //a store writes memory: pc, the address and the word written
+#define TPREGISTER 5          //writeback writes dstE and dstM: pc, the register, RNONE for none, and the value
+#define TPDUMP 6              //a dump reaches writeback: pc and what it dumps
+#define TPHALT 7              //the program stops: pc and its stat
+#define TPEVENTS 8
+
+//the source of a value decode didn't forward from a later stage
+#define TPREGISTERFILE STAGES
+
+//hook called at a tracepoint with the event and the numbers it passes
+typedef void (* tracepointType)(machineType * machine, int event, unsigned int pc, unsigned int a,
+                                unsigned int b);
+
+//hooks of the events, NULL for none, the same for every machine
+extern tracepointType tracepoints[TPEVENTS];
+
+//a tracepoint is only compiled in with TRACEPOINTS defined, the yess-instrumented target,
+//otherwise it and the arguments it would pass are compiled out
+#ifdef TRACEPOINTS
+#define TRACEPOINT(event, machine, pc, a, b) \
+    do{ if(tracepoints[event] != NULL) tracepoints[event](machine, event, pc, a, b); }while(0)
+#else
+#define TRACEPOINT(event, machine, pc, a, b) ((void) 0)
+#endif
+
+//prototypes
+void setTracepoint(int event, tracepointType hook);
+bool logTracepoints(void);
+#endif
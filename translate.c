@@ -0,0 +1,556 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "machine.h"
+#include "tools.h"
+#include "instructions.h"
+#include "translate.h"
+
+/*
+ * Translate.c - translates a loaded program into C ahead of time.  The
+ * blocks of the program are found by following its jumps and calls from
+ * address 0, and each one becomes a C function that runs its instructions
+ * on the registers and condition codes and returns the index of the next
+ * block.  Jumps and calls go to a block known when the program is
+ * translated, a ret looks up its target in a dispatch table of the blocks.
+ *
+ * The C source includes translated.h and is linked with every object of
+ * yess but main.o, so dump instructions and errors are displayed by the
+ * same code as the other engines and compiling it gives a program that
+ * writes the same output as yess -e functional.  A ret to an address that
+ * isn't the start of a block, or a store into translated code, hands the
+ * rest of the program to the functional engine.
+ */
+
+//names used in the comments and code of the translated source
+static const char * regNames[REGSIZE] = {"%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi"};
+static const char * regIndices[REGSIZE] = {"EAX", "ECX", "EDX", "EBX", "ESP", "EBP", "ESI", "EDI"};
+static const char * oplNames[4] = {"addl", "subl", "andl", "xorl"};
+static const char * oplCodes[4] = {"ADDL", "SUBL", "ANDL", "XORL"};
+static const char * jumpNames[7] = {"jmp", "jle", "jl", "je", "jne", "jge", "jg"};
+static const char * jumpCodes[7] = {"JMP", "JLE", "JL", "JE", "JNE", "JGE", "JG"};
+static const char * moveNames[7] = {"rrmovl", "cmovle", "cmovl", "cmove", "cmovne", "cmovge", "cmovg"};
+static const char * moveCodes[7] = {"RRMOVL", "CMOVLE", "CMOVL", "CMOVE", "CMOVNE", "CMOVGE", "CMOVG"};
+
+//prototypes of functions only called within this file
+static bool findBlocks(machineType * machine, blockListType * list);
+static bool addBlock(blockListType * list, unsigned int pc);
+static int blockIndex(blockListType * list, unsigned int pc);
+static int compareAddresses(const void * first, const void * second);
+static predecodeType * nextInstruction(machineType * machine, unsigned int pc, int * n);
+static bool endsBlock(predecodeType * inst, int n);
+static void emitImage(machineType * machine, FILE * out);
+static bool readLine(machineType * machine, unsigned long long * address, unsigned char * line);
+static bool emitCodeLines(machineType * machine, blockListType * list, FILE * out);
+static void emitBlock(machineType * machine, blockListType * list, int index, FILE * out);
+static void emitInstruction(blockListType * list, predecodeType * inst, int n, FILE * out);
+static void describe(predecodeType * inst, FILE * out);
+static const char * source(unsigned int reg);
+static const char * destination(unsigned int reg);
+static void emitCode(const char * names[], unsigned int count, unsigned int ifun, FILE * out);
+//end prototypes
+
+/* Function Name: translateProgram
+ * Purpose:       Writes C source that runs the loaded program with one
+ *                function per block
+ *
+ * Parameters:    machine - machine holding the loaded program
+ *                fileName - name of the program, for the comment at the top
+ *                out - where the source is written
+ * Returns:       TRUE if the program couldn't be translated, FALSE otherwise
+ * Modifies:      predecode cache
+ */
+bool translateProgram(machineType * machine, char * fileName, FILE * out)
+{
+    blockListType list = {NULL, 0, 0};
+    int i;
+
+    if(findBlocks(machine, &list)){
+        free(list.starts);
+        return TRUE;
+    }
+    qsort(list.starts, list.count, sizeof(unsigned int), compareAddresses);
+
+    fprintf(out, "/* %s translated by yess -t, link with every object of yess but main.o */\n", fileName);
+    fprintf(out, "#include <stdio.h>\n#include \"machine.h\"\n#include \"instructions.h\"\n"
+                 "#include \"opcodes.h\"\n#include \"functional.h\"\n\n");
+    fprintf(out, "#define TRANSLINEBITS %d\n", TRANSLINEBITS);
+    if(emitCodeLines(machine, &list, out)){
+        free(list.starts);
+        return TRUE;
+    }
+    fprintf(out, "#include \"translated.h\"\n\n");
+
+    emitImage(machine, out);
+
+    //the dispatch table, indexed the same as starts
+    for(i = 0; i < list.count; i++) fprintf(out, "static int block%d(void);\n", i);
+    fprintf(out, "\nstatic const unsigned int starts[%d] =\n{\n", list.count);
+    for(i = 0; i < list.count; i++)
+        fprintf(out, "    0x%x%s\n", list.starts[i], i + 1 < list.count ? "," : "");
+    fprintf(out, "};\n\nstatic const blockFunction table[%d] =\n{\n", list.count);
+    for(i = 0; i < list.count; i++) fprintf(out, "    block%d%s\n", i, i + 1 < list.count ? "," : "");
+    fprintf(out, "};\n");
+
+    for(i = 0; i < list.count; i++) emitBlock(machine, &list, i, out);
+
+    fprintf(out, "\nint main(void)\n{\n"
+                 "    unsigned int i;\n"
+                 "    bool error = FALSE;\n\n"
+                 "    machine = newMachine();\n"
+                 "    if(machine == NULL){\n"
+                 "        printf(\"Unable to allocate the machine\\n\");\n"
+                 "        return 1;\n"
+                 "    }\n"
+                 "    setMemorySize(machine, 0x%llxULL);\n"
+                 "    for(i = 0; segments[i][1] != 0; i++)\n"
+                 "        copyIn(machine, segments[i][0], (unsigned char *) image + segments[i][2], segments[i][1], &error);\n"
+                 "    cc = getFlags(machine);\n\n"
+                 "    unsigned long long total = runBlocks(table, starts, %d);\n\n"
+                 "    printf(\"\\nTotal instructions = %%llu\\n\", total);\n"
+                 "    freeMachine(machine);\n"
+                 "    return 0;\n}\n", getMemorySize(machine), list.count);
+
+    free(list.starts);
+    return FALSE;
+}
+
+/* Function Name: findBlocks
+ * Purpose:       Finds the start of every block reachable from address 0,
+ *                the targets of jumps and calls, the instructions after them
+ *                and the instructions after blocks cut at TRANSBLOCKLEN
+ *
+ * Parameters:    machine - machine holding the program
+ *                list - empty list of blocks
+ * Returns:       TRUE if the list couldn't be allocated, FALSE otherwise
+ * Modifies:      list
+ */
+static bool findBlocks(machineType * machine, blockListType * list)
+{
+    int i;
+
+    if(addBlock(list, 0)) return TRUE;
+
+    //the list grows while it is walked, every block is visited once
+    for(i = 0; i < list->count; i++){
+        unsigned int pc = list->starts[i];
+        predecodeType * inst;
+        int n = 0;
+
+        do {
+            inst = nextInstruction(machine, pc, &n);
+            pc = inst->valP;
+        } while(!endsBlock(inst, n));
+
+        if(inst->stat != SAOK || inst->icode == IRET) continue;
+        if((inst->icode == IJXX || inst->icode == ICALL) && addBlock(list, inst->valC)) return TRUE;
+
+        //the instruction after a call is where its ret comes back to
+        if((inst->icode != IJXX || inst->ifun != JMP) && addBlock(list, inst->valP)) return TRUE;
+    }
+    return FALSE;
+}
+
+/* Function Name: addBlock
+ * Purpose:       Adds the start of a block to the list if it isn't there yet
+ *
+ * Parameters:    list - list of blocks
+ *                pc - address of the first instruction of the block
+ * Returns:       TRUE if the list couldn't be grown, FALSE otherwise
+ * Modifies:      list
+ */
+static bool addBlock(blockListType * list, unsigned int pc)
+{
+    int i;
+
+    for(i = 0; i < list->count; i++)
+        if(list->starts[i] == pc) return FALSE;
+
+    if(list->count == list->size){
+        int size = list->size == 0 ? 64 : list->size * 2;
+        unsigned int * starts = realloc(list->starts, size * sizeof(unsigned int));
+        if(starts == NULL) return TRUE;
+        list->starts = starts;
+        list->size = size;
+    }
+    list->starts[list->count++] = pc;
+    return FALSE;
+}
+
+/* Function Name: blockIndex
+ * Purpose:       Finds the index of a block in the sorted list
+ *
+ * Parameters:    list - sorted list of blocks
+ *                pc - address of the first instruction of the block
+ * Returns:       index of the block
+ * Modifies:      -
+ */
+static int blockIndex(blockListType * list, unsigned int pc)
+{
+    unsigned int * found = bsearch(&pc, list->starts, list->count, sizeof(unsigned int), compareAddresses);
+    return found - list->starts;
+}
+
+/* Function Name: compareAddresses
+ * Purpose:       Orders two block addresses for qsort and bsearch
+ *
+ * Parameters:    first, second - pointers to the addresses
+ * Returns:       negative, zero or positive as first is below, equal to or
+ *                above second
+ * Modifies:      -
+ */
+static int compareAddresses(const void * first, const void * second)
+{
+    unsigned int a = *(const unsigned int *) first;
+    unsigned int b = *(const unsigned int *) second;
+    return (a > b) - (a < b);
+}
+
+/* Function Name: nextInstruction
+ * Purpose:       Decodes the next instruction of a block
+ *
+ * Parameters:    machine - machine holding the program
+ *                pc - address of the instruction
+ *                n - number of instructions of the block decoded so far
+ * Returns:       the decoded instruction
+ * Modifies:      n, predecode cache
+ */
+static predecodeType * nextInstruction(machineType * machine, unsigned int pc, int * n)
+{
+    predecodeType * inst = lookupPredecode(machine, pc);
+    if(inst == NULL) inst = decodeInstruction(machine, pc);
+    (*n)++;
+    return inst;
+}
+
+/* Function Name: endsBlock
+ * Purpose:       Determines if an instruction is the last of its block
+ *
+ * Parameters:    inst - the decoded instruction
+ *                n - its number in the block, starting at 1
+ * Returns:       TRUE if the block ends with the instruction
+ * Modifies:      -
+ */
+static bool endsBlock(predecodeType * inst, int n)
+{
+    if(inst->stat != SAOK || n == TRANSBLOCKLEN) return TRUE;
+    return inst->icode == IJXX || inst->icode == ICALL || inst->icode == IRET;
+}
+
+/* Function Name: emitCodeLines
+ * Purpose:       Writes the table of the lines of memory holding translated
+ *                instructions, which stores are checked against
+ *
+ * Parameters:    machine - machine holding the program
+ *                list - blocks of the program
+ *                out - where the source is written
+ * Returns:       TRUE if the table couldn't be allocated, FALSE otherwise
+ * Modifies:      predecode cache
+ */
+static bool emitCodeLines(machineType * machine, blockListType * list, FILE * out)
+{
+    unsigned int first = list->starts[0] >> TRANSLINEBITS, last = first;
+    unsigned int line;
+    int i, pass;
+    unsigned char * lines = NULL;
+
+    //the first pass finds the range of lines, the second marks them
+    for(pass = 0; pass < 2; pass++){
+        for(i = 0; i < list->count; i++){
+            unsigned int pc = list->starts[i];
+            predecodeType * inst;
+            int n = 0;
+
+            do {
+                inst = nextInstruction(machine, pc, &n);
+                unsigned int high = (pc + MAXINSTLEN - 1) >> TRANSLINEBITS;
+                for(line = pc >> TRANSLINEBITS; ; line++){
+                    if(pass == 0 && line > last) last = line;
+                    if(pass == 1) lines[line - first] = 1;
+                    if(line == high) break;
+                }
+                pc = inst->valP;
+            } while(!endsBlock(inst, n));
+        }
+        if(pass == 0){
+            lines = calloc(last - first + 1, 1);
+            if(lines == NULL) return TRUE;
+        }
+    }
+
+    fprintf(out, "#define FIRSTLINE 0x%xu\n#define CODELINES %uu\n", first, last - first + 1);
+    fprintf(out, "static const unsigned char codeLines[%u] =\n{", last - first + 1);
+    for(line = 0; line <= last - first; line++)
+        fprintf(out, "%s%d%s", line % 32 == 0 ? "\n    " : "", lines[line], line < last - first ? "," : "");
+    fprintf(out, "\n};\n\n");
+    free(lines);
+    return FALSE;
+}
+
+/* Function Name: emitImage
+ * Purpose:       Writes the loaded memory, the lines of it that aren't zero,
+ *                as the bytes copied into the machine before the program runs
+ *
+ * Parameters:    machine - machine holding the program
+ *                out - where the source is written
+ * Returns:       -
+ * Modifies:      -
+ */
+static void emitImage(machineType * machine, FILE * out)
+{
+    unsigned long long size = getMemorySize(machine);
+    unsigned long long address;
+    unsigned char line[1 << TRANSLINEBITS];
+    unsigned int offset = 0, length = 0, start = 0;
+    unsigned int i;
+
+    //each segment is {address, length, offset into image}, runs of lines that aren't zero
+    fprintf(out, "static const unsigned int segments[][3] =\n{\n");
+    for(address = 0; address < size; address += sizeof(line)){
+        if(readLine(machine, &address, line)){
+            if(length == 0) start = address;
+            length += sizeof(line);
+            continue;
+        }
+        if(length != 0) fprintf(out, "    {0x%x, %u, %u},\n", start, length, offset);
+        offset += length;
+        length = 0;
+    }
+    if(length != 0) fprintf(out, "    {0x%x, %u, %u},\n", start, length, offset);
+    fprintf(out, "    {0, 0, 0}\n};\n\n");
+
+    //then the bytes of the segments
+    fprintf(out, "static const unsigned char image[] =\n{");
+    offset = 0;
+    for(address = 0; address < size; address += sizeof(line)){
+        if(!readLine(machine, &address, line)) continue;
+        for(i = 0; i < sizeof(line); i++, offset++)
+            fprintf(out, "%s0x%02x,", offset % 16 == 0 ? "\n    " : "", line[i]);
+    }
+    fprintf(out, "\n    0\n};\n\n");
+}
+
+/* Function Name: readLine
+ * Purpose:       Reads a line of memory for emitImage, skipping to the last
+ *                line of a page that was never written
+ *
+ * Parameters:    machine - machine holding the program
+ *                address - address of the line
+ *                line - where the 1 << TRANSLINEBITS bytes are read into
+ * Returns:       TRUE if any byte of the line isn't zero
+ * Modifies:      address, line
+ */
+static bool readLine(machineType * machine, unsigned long long * address, unsigned char * line)
+{
+    bool memError = FALSE;
+    int i;
+
+    if(*address % PAGESIZE == 0 && !isPageAllocated(machine, *address)){
+        *address += PAGESIZE - (1 << TRANSLINEBITS);
+        return FALSE;
+    }
+    copyOut(machine, *address, line, 1 << TRANSLINEBITS, &memError);
+    for(i = 0; i < (1 << TRANSLINEBITS); i++)
+        if(line[i] != 0) return TRUE;
+    return FALSE;
+}
+
+/* Function Name: emitBlock
+ * Purpose:       Writes the function running one block
+ *
+ * Parameters:    machine - machine holding the program
+ *                list - sorted blocks of the program
+ *                index - index of the block
+ *                out - where the source is written
+ * Returns:       -
+ * Modifies:      predecode cache
+ */
+static void emitBlock(machineType * machine, blockListType * list, int index, FILE * out)
+{
+    unsigned int pc = list->starts[index];
+    predecodeType * inst;
+    int n = 0;
+
+    fprintf(out, "\n//0x%x\nstatic int block%d(void)\n{\n", pc, index);
+    do {
+        inst = nextInstruction(machine, pc, &n);
+        emitInstruction(list, inst, n, out);
+        pc = inst->valP;
+    } while(!endsBlock(inst, n));
+
+    //a block cut at TRANSBLOCKLEN, or ending with a call, goes on to the next one
+    if(inst->stat == SAOK && inst->icode != IJXX && inst->icode != IRET && inst->icode != ICALL)
+        fprintf(out, "    GOTO(%d, %d);\n", blockIndex(list, inst->valP), n);
+    fprintf(out, "}\n");
+}
+
+/* Function Name: emitInstruction
+ * Purpose:       Writes the C statements of one instruction
+ *
+ * Parameters:    list - sorted blocks of the program
+ *                inst - the decoded instruction
+ *                n - its number in the block, starting at 1
+ *                out - where the source is written
+ * Returns:       -
+ * Modifies:      -
+ */
+static void emitInstruction(blockListType * list, predecodeType * inst, int n, FILE * out)
+{
+    const char * a = source(inst->rA);
+    const char * b = source(inst->rB);
+
+    describe(inst, out);
+    if(inst->stat != SAOK){
+        fprintf(out, "    return stop(%s, %d);\n", inst->stat == SHLT ? "SHLT" : inst->stat == SADR ? "SADR" : "SINS", n);
+        return;
+    }
+
+    switch(inst->icode){
+        case IRRMOVL:
+            if(inst->ifun != RRMOVL){
+                fprintf(out, "    if(CONDITION(");
+                emitCode(moveCodes, 7, inst->ifun, out);
+                fprintf(out, ", cc)) ");
+            } else fprintf(out, "    ");
+            fprintf(out, "r[%s] = r[%s];\n", destination(inst->rB), a);
+            break;
+        case IIRMOVL:
+            fprintf(out, "    r[%s] = 0x%x;\n", destination(inst->rB), inst->valC);
+            break;
+        case IRMMOVL:
+            fprintf(out, "    STORE(r[%s] + 0x%x, r[%s], %d, 0x%x);\n", b, inst->valC, a, n, inst->valP);
+            break;
+        case IMRMOVL:
+            fprintf(out, "    LOAD(r[%s], r[%s] + 0x%x, %d);\n", destination(inst->rA), b, inst->valC, n);
+            break;
+        case IOPL:
+            fprintf(out, "    OPL(");
+            emitCode(oplCodes, 4, inst->ifun, out);
+            fprintf(out, ", r[%s], r[%s], r[%s], cc);\n", a, b, destination(inst->rB));
+            break;
+        case IJXX:
+            if(inst->ifun == JMP){
+                fprintf(out, "    GOTO(%d, %d);\n", blockIndex(list, inst->valC), n);
+                break;
+            }
+            fprintf(out, "    if(CONDITION(");
+            emitCode(jumpCodes, 7, inst->ifun, out);
+            fprintf(out, ", cc)) GOTO(%d, %d);\n", blockIndex(list, inst->valC), n);
+            fprintf(out, "    GOTO(%d, %d);\n", blockIndex(list, inst->valP), n);
+            break;
+        case ICALL:
+            fprintf(out, "    PUSH(0x%x, %d, 0x%x);\n", inst->valP, n, inst->valC);
+            fprintf(out, "    GOTO(%d, %d);\n", blockIndex(list, inst->valC), n);
+            break;
+        case IRET:
+            fprintf(out, "    POP(pc, %d);\n", n);
+            fprintf(out, "    GOTO(BLOCKLOOKUP, %d);\n", n);
+            break;
+        case IPUSHL:
+            fprintf(out, "    PUSH(r[%s], %d, 0x%x);\n", a, n, inst->valP);
+            break;
+        case IPOPL:
+            fprintf(out, "    POP(r[%s], %d);\n", destination(inst->rA), n);
+            break;
+        case IDUMP:
+            fprintf(out, "    syncMachine();\n    retire(machine, SAOK, IDUMP, 0x%x);\n", inst->valC);
+            break;
+    }
+}
+
+/* Function Name: describe
+ * Purpose:       Writes a comment with the address and assembly of an instruction
+ *
+ * Parameters:    inst - the decoded instruction
+ *                out - where the source is written
+ * Returns:       -
+ * Modifies:      -
+ */
+static void describe(predecodeType * inst, FILE * out)
+{
+    const char * a = inst->rA < REGSIZE ? regNames[inst->rA] : "none";
+    const char * b = inst->rB < REGSIZE ? regNames[inst->rB] : "none";
+
+    fprintf(out, "    //0x%03x: ", inst->pc);
+    if(inst->stat != SAOK){
+        fprintf(out, "%s\n", inst->stat == SHLT ? "halt" : inst->stat == SADR ? "invalid address" : "invalid instruction");
+        return;
+    }
+    switch(inst->icode){
+        case INOP:
+            fprintf(out, "nop\n");
+            break;
+        case IRRMOVL:
+            fprintf(out, "%s %s, %s\n", inst->ifun < 7 ? moveNames[inst->ifun] : "cmovxx", a, b);
+            break;
+        case IIRMOVL:
+            fprintf(out, "irmovl $0x%x, %s\n", inst->valC, b);
+            break;
+        case IRMMOVL:
+            fprintf(out, "rmmovl %s, 0x%x(%s)\n", a, inst->valC, b);
+            break;
+        case IMRMOVL:
+            fprintf(out, "mrmovl 0x%x(%s), %s\n", inst->valC, b, a);
+            break;
+        case IOPL:
+            fprintf(out, "%s %s, %s\n", inst->ifun < 4 ? oplNames[inst->ifun] : "opl", a, b);
+            break;
+        case IJXX:
+            fprintf(out, "%s 0x%x\n", inst->ifun < 7 ? jumpNames[inst->ifun] : "jxx", inst->valC);
+            break;
+        case ICALL:
+            fprintf(out, "call 0x%x\n", inst->valC);
+            break;
+        case IRET:
+            fprintf(out, "ret\n");
+            break;
+        case IPUSHL:
+            fprintf(out, "pushl %s\n", a);
+            break;
+        case IPOPL:
+            fprintf(out, "popl %s\n", a);
+            break;
+        case IDUMP:
+            fprintf(out, "dump 0x%x\n", inst->valC);
+            break;
+    }
+}
+
+/* Function Name: source
+ * Purpose:       Names the register file index an instruction reads
+ *
+ * Parameters:    reg - register identifier
+ * Returns:       name of the index, RZERO for a register that doesn't exist
+ * Modifies:      -
+ */
+static const char * source(unsigned int reg)
+{
+    return reg < REGSIZE ? regIndices[reg] : "RZERO";
+}
+
+/* Function Name: destination
+ * Purpose:       Names the register file index an instruction writes
+ *
+ * Parameters:    reg - register identifier
+ * Returns:       name of the index, RSINK for a register that doesn't exist
+ * Modifies:      -
+ */
+static const char * destination(unsigned int reg)
+{
+    return reg < REGSIZE ? regIndices[reg] : "RSINK";
+}
+
+/* Function Name: emitCode
+ * Purpose:       Writes the name of a function code, or its value if it has none
+ *
+ * Parameters:    names - names of the function codes
+ *                count - number of names
+ *                ifun - the function code
+ *                out - where the source is written
+ * Returns:       -
+ * Modifies:      -
+ */
+static void emitCode(const char * names[], unsigned int count, unsigned int ifun, FILE * out)
+{
+    if(ifun < count) fprintf(out, "%s", names[ifun]);
+    else fprintf(out, "0x%x", ifun);
+}
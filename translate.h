@@ -0,0 +1,20 @@
+#ifndef TRANSLATE_H
+#define TRANSLATE_H
+
+//most instructions translated into one block
+#define TRANSBLOCKLEN 64
+
+//stores are checked against the translated code in lines of 1 << TRANSLINEBITS bytes
+#define TRANSLINEBITS 5
+
+//addresses of the blocks of a program, found by following its jumps and calls from address 0
+typedef struct
+{
+    unsigned int * starts;    //sorted once every block has been found
+    int count;
+    int size;
+} blockListType;
+
+//prototypes
+bool translateProgram(machineType * machine, char * fileName, FILE * out);
+#endif
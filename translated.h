@@ -0,0 +1,184 @@
+#ifndef TRANSLATED_H
+#define TRANSLATED_H
+
+/* Runtime of a program translated into C by yess -t.  Only the translated
+ * source includes this file, after machine.h, instructions.h, opcodes.h and
+ * functional.h, so the state below is private to that one program.  Each
+ * block of the program is a function that runs its instructions on r and cc
+ * and returns the index of the next block, the blocks are run one after
+ * another by runBlocks.
+ *
+ * Before any block the translated source defines codeLines, the lines of
+ * 1 << TRANSLINEBITS bytes from line FIRSTLINE on that hold translated
+ * instructions, and CODELINES, the number of entries in codeLines.
+ */
+
+//register file indices of the registers that don't exist
+#define RZERO 8               //always reads as 0
+#define RSINK 9               //writes to it are dropped
+
+//what a block returns instead of the index of the next block
+#define BLOCKSTOP -1          //halt or an error, stat holds the status
+#define BLOCKLOOKUP -2        //continue at pc, only known at run time (ret)
+#define BLOCKFALLBACK -3      //a store wrote into translated code, simulate from pc on
+
+//a translated block
+typedef int (* blockFunction)(void);
+
+//state of the program, the registers and condition codes only reach the machine through syncMachine
+static machineType * machine;
+static unsigned int r[REGSIZE + 2];
+static unsigned int cc;
+static unsigned int pc;
+static unsigned int stat;
+static unsigned long long count;
+static bool memError;
+
+//TRUE if a word stored at address overlaps translated code
+#define WRITTEN(address)                                                                 \
+    ((((address) >> TRANSLINEBITS) - FIRSTLINE < CODELINES &&                            \
+      codeLines[((address) >> TRANSLINEBITS) - FIRSTLINE]) ||                            \
+     ((((address) + 3) >> TRANSLINEBITS) - FIRSTLINE < CODELINES &&                      \
+      codeLines[(((address) + 3) >> TRANSLINEBITS) - FIRSTLINE]))
+
+//reads a word into dst, n is the number of the instruction in its block
+#define LOAD(dst, address, n)                                                            \
+    do {                                                                                 \
+        unsigned int value = getWord(machine, (address), &memError);                     \
+        if(memError) return stop(SADR, n);                                               \
+        dst = value;                                                                     \
+    } while(0)
+
+//stores a word, leaving the translated code for nextPC if it wrote over it
+#define STORE(address, value, n, nextPC)                                                 \
+    do {                                                                                 \
+        unsigned int where = (address);                                                  \
+        putWord(machine, where, (value), &memError);                                     \
+        if(memError) return stop(SADR, n);                                               \
+        if(WRITTEN(where)) return fallback(nextPC, n);                                   \
+    } while(0)
+
+//pushes a word, leaving the translated code for nextPC if it wrote over it
+#define PUSH(value, n, nextPC)                                                           \
+    do {                                                                                 \
+        unsigned int where = r[ESP] - 4;                                                 \
+        putWord(machine, where, (value), &memError);                                     \
+        if(memError) return stop(SADR, n);                                               \
+        r[ESP] = where;                                                                  \
+        if(WRITTEN(where)) return fallback(nextPC, n);                                   \
+    } while(0)
+
+//pops a word into dst
+#define POP(dst, n)                                                                      \
+    do {                                                                                 \
+        unsigned int value = getWord(machine, r[ESP], &memError);                        \
+        if(memError) return stop(SADR, n);                                               \
+        r[ESP] += 4;                                                                     \
+        dst = value;                                                                     \
+    } while(0)
+
+//leaves the block for the block with index next after n instructions
+#define GOTO(next, n)                                                                    \
+    do {                                                                                 \
+        count += (n);                                                                    \
+        return (next);                                                                   \
+    } while(0)
+
+/* Function Name: syncMachine
+ * Purpose:       Copies the registers and condition codes to the machine
+ *
+ * Parameters:    -
+ * Returns:       -
+ * Modifies:      machine
+ */
+static void syncMachine(void)
+{
+    int i;
+
+    for(i = 0; i < REGSIZE; i++) machine->registers[i] = r[i];
+    setFlags(machine, cc);
+}
+
+/* Function Name: stop
+ * Purpose:       Stops the program in the middle of a block
+ *
+ * Parameters:    status - status the program stopped with
+ *                n - instructions of the block run, including the one stopping it
+ * Returns:       BLOCKSTOP
+ * Modifies:      stat, count
+ */
+static int stop(unsigned int status, int n)
+{
+    stat = status;
+    count += n;
+    return BLOCKSTOP;
+}
+
+/* Function Name: fallback
+ * Purpose:       Leaves the translated code after a store changed it
+ *
+ * Parameters:    nextPC - address of the next instruction
+ *                n - instructions of the block run, including the store
+ * Returns:       BLOCKFALLBACK
+ * Modifies:      pc, count
+ */
+static int fallback(unsigned int nextPC, int n)
+{
+    pc = nextPC;
+    count += n;
+    return BLOCKFALLBACK;
+}
+
+/* Function Name: findBlock
+ * Purpose:       Looks up the block starting at an address in the dispatch table
+ *
+ * Parameters:    starts - sorted addresses of the blocks
+ *                blocks - number of blocks
+ *                address - address of the instruction
+ * Returns:       index of the block, BLOCKFALLBACK if no block starts there
+ * Modifies:      -
+ */
+static int findBlock(const unsigned int * starts, int blocks, unsigned int address)
+{
+    int low = 0, high = blocks - 1;
+
+    while(low <= high){
+        int middle = (low + high) / 2;
+        if(starts[middle] == address) return middle;
+        if(starts[middle] < address) low = middle + 1;
+        else high = middle - 1;
+    }
+    return BLOCKFALLBACK;
+}
+
+/* Function Name: runBlocks
+ * Purpose:       Runs the translated program from the block at address 0
+ *                until it stops, finishing it in the functional engine if it
+ *                reaches code that wasn't translated
+ *
+ * Parameters:    table - block functions in the order of starts
+ *                starts - sorted addresses of the blocks
+ *                blocks - number of blocks
+ * Returns:       number of instructions executed, including the one that
+ *                stopped the program
+ * Modifies:      machine
+ */
+static unsigned long long runBlocks(const blockFunction * table, const unsigned int * starts, int blocks)
+{
+    int next = findBlock(starts, blocks, 0);
+
+    for(;;){
+        if(next == BLOCKFALLBACK){
+            syncMachine();
+            return count + runFunctionalFrom(machine, pc);
+        }
+        if(next == BLOCKSTOP){
+            syncMachine();
+            retire(machine, stat, IHALT, 0);
+            return count;
+        }
+        next = table[next]();
+        if(next == BLOCKLOOKUP) next = findBlock(starts, blocks, pc);
+    }
+}
+#endif
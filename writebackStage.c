@@ -1,67 +1,63 @@
 #include <stdio.h>
-#include "bool.h"
-#include "forwarding.h"
-#include "status.h"
-#include "writebackStage.h"
+#include "machine.h"
 #include "tools.h"
 #include "instructions.h"
 #include "dump.h"
-#include "registers.h"
 
-//W register holds the input for the writeback stage
-//It is only accessible from this file. (static)
-static wregister W;
+//A machine's W register holds the input for the writeback stage
+//It is only accessed from this file, the stage reads cur->W.
 
 /* Function Name: writebackStage
  * Purpose:       To simulate the writeback stage in a pipeline machine
  *
- * Parameters:    forward - struct containing values used for forwarding
- *                status - struct containing values for the status of the memory and writeback stages
+ * Parameters:    machine - machine being simulated
  * Returns:       TRUE if status is anything other than SAOK, FALSE otherwise
- * Modifies:      Appropriate values in forward and status structs
+ * Modifies:      program registers
  */
-bool writebackStage(forwardType *forward, statusType *status){
+bool writebackStage(machineType * machine){
+    wregister * W = &machine->cur->W;
 
-    //set appropriate forwarding values
-    forward->W_valE = W.valE;
-    forward->W_dstE = W.dstE;
-    forward->W_dstM = W.dstM;
-    forward->W_valM = W.valM;
-    forward->W_icode = W.icode;
-
-    //set appropriate status value
-    status->W_stat = W.stat;
+    //every instruction reaches writeback once, the bubbles between them aren't counted,
+    //and the calls and rets the program really made are followed here
+    if(W->pc != NOPC){
+        countRetired(machine, W->pc, W->icode);
+        if(machine->config.foldedFile != NULL) retireCall(machine, W->pc, W->icode);
+    }
 
     //check if instruction is a dump
-    if(W.icode == IDUMP){
-        if(W.valE & 0x1) dumpProgramRegisters();
-        if(W.valE & 0x2) dumpProcessorRegisters();
-        if(W.valE & 0x4) dumpMemory();
+    if(W->icode == IDUMP){
+        TRACEPOINT(TPDUMP, machine, W->pc, W->valE, 0);
+        if(W->valE & 0x1) dumpProgramRegisters(machine);
+        if(W->valE & 0x2) dumpProcessorRegisters(machine);
+        if(W->valE & 0x4) dumpMemory(machine);
     }
 
     //only update registers if status is SAOK
-    if(W.stat == SAOK){
-    setRegister(W.dstE, W.valE);
-    setRegister(W.dstM, W.valM);
+    if(W->stat == SAOK){
+    setRegister(machine, W->dstE, W->valE);
+    setRegister(machine, W->dstM, W->valM);
+    TRACEPOINT(TPREGISTER, machine, W->pc, W->dstE, W->valE);
+    TRACEPOINT(TPREGISTER, machine, W->pc, W->dstM, W->valM);
     }
+    else TRACEPOINT(TPHALT, machine, W->pc, W->stat, 0);
     
     //determines next operation based on status
-    switch(W.stat){
+    switch(W->stat){
         case SAOK:
             return FALSE; //continue program operation
         case SHLT:
             return TRUE; //program terminated due to halt
         case SADR:
-            printf("Invalid memory address\n"); 
-            dumpProgramRegisters();
-            dumpProcessorRegisters();
-            dumpMemory();
+            fprintf(machine->out, "Invalid memory address\n"); 
+            dumpProgramRegisters(machine);
+            dumpProcessorRegisters(machine);
+            dumpMemory(machine);
             return TRUE; //invalid memory address, dump everything and terminate
         case SINS:
-            printf("Invalid instruction\n");
-            dumpProgramRegisters();
-            dumpProcessorRegisters();
-            dumpMemory();
+            fprintf(machine->out, "Invalid instruction\n");
+            dumpProgramRegisters(machine);
+            dumpProcessorRegisters(machine);
+            dumpMemory(machine);
             return TRUE; //invalid instruction, dump everything and terminate
     }
 }
@@ -69,40 +65,46 @@ bool writebackStage(forwardType *forward, statusType *status){
 /* Function Name: getWregister
  * Purpose:       Returns a copy of the W register
  *
- * Parameters:    -
+ * Parameters:    machine - machine being simulated
  * Returns:       wregister
  * Modifies:      -
  */
-wregister getWregister(){
-    return W;
+wregister getWregister(machineType * machine){
+    return machine->cur->W;
 }
 
 /* Function Name: clearWregister
  * Purpose:       Clears the W register
  * 
- * Parameters:    -
+ * Parameters:    machine - machine being simulated
  * Returns:       -
  * Modifies:      W
  */
-void clearWregister(){
-    clearBuffer((char *) &W, sizeof(W));
-    W.stat = SAOK;
-    W.icode = INOP;
+void clearWregister(machineType * machine){
+    clearBuffer((char *) &machine->cur->W, sizeof(machine->cur->W));
+    machine->cur->W.stat = SAOK;
+    machine->cur->W.icode = INOP;
+    machine->cur->W.pc = NOPC;
 }
 
 /* Function Name: updateWregister
  * Purpose:       Passes the values from the m stage to the W register
  *
- * Parameters:    All the values that correspond to the W register fields
+ * Parameters:    machine - machine being simulated
+ *                All the values that correspond to the W register fields
  * Returns:       -
- * Modifies:      W register
+ * Modifies:      next W register
  */
-void updateWregister(unsigned int stat, unsigned int icode, unsigned int valE,
-                    unsigned int valM, unsigned int dstE, unsigned int dstM){
-    W.stat = stat;
-    W.icode = icode;
-    W.valE = valE;
-    W.valM = valM;
-    W.dstE = dstE;
-    W.dstM = dstM;
+void updateWregister(machineType * machine, unsigned int stat, unsigned int icode, unsigned int valE,
+                    unsigned int valM, unsigned int dstE, unsigned int dstM, unsigned int pc, unsigned int predTaken){
+    wregister * W = &machine->next->W;
+
+    W->stat = stat;
+    W->icode = icode;
+    W->valE = valE;
+    W->valM = valM;
+    W->dstE = dstE;
+    W->dstM = dstM;
+    W->pc = pc;
+    W->predTaken = predTaken;
 }
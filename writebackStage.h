@@ -3,14 +3,17 @@
 
 //struct representing the W register
 typedef struct {
-    unsigned int stat, icode, valE, valM, dstE, dstM;
+    unsigned int valE, valM;
+    unsigned int pc;          //NOPC for a bubble
+    unsigned char stat, icode, dstE, dstM;
+    unsigned char predTaken;  //TRUE if fetch didn't wait for the ret to read valM
 } wregister;
 
 //prototypes for functions called from files other than writebackStage
-wregister getWregister();
-void clearWregister();
-void updateWregister(unsigned int stat, unsigned int icode, unsigned int valE, 
-    unsigned int valM, unsigned int dstE, unsigned int dstM);
-bool writebackStage(forwardType *forward, statusType* status);
+wregister getWregister(machineType * machine);
+void clearWregister(machineType * machine);
+void updateWregister(machineType * machine, unsigned int stat, unsigned int icode, unsigned int valE, 
+    unsigned int valM, unsigned int dstE, unsigned int dstM, unsigned int pc, unsigned int predTaken);
+bool writebackStage(machineType * machine);
 
 #endif